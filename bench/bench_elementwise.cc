@@ -0,0 +1,75 @@
+#include "kernels/cpu/binary_simd.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// Streams two operands of `n` elements through every vectorized binary
+// kernel and reports the effective bandwidth next to a memcpy of the same
+// footprint. Usage: bench_elementwise [elements]  (default 8M = 32 MB each)
+
+using namespace infini;
+
+template <typename F> static double bestSeconds(F &&f, int repeat = 10)
+{
+    double best = 1e30;
+    for (int r = 0; r < repeat; ++r)
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        f();
+        auto t1 = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double>(t1 - t0).count());
+    }
+    return best;
+}
+
+int main(int argc, char **argv)
+{
+    int64_t n = argc > 1 ? std::atoll(argv[1]) : (8 << 20);
+    size_t bytes = n * sizeof(float);
+    auto *a = static_cast<float *>(std::aligned_alloc(64, bytes));
+    auto *b = static_cast<float *>(std::aligned_alloc(64, bytes));
+    auto *c = static_cast<float *>(std::aligned_alloc(64, bytes));
+    for (int64_t i = 0; i < n; ++i)
+    {
+        a[i] = float(i % 1000 + 1);
+        b[i] = float(i % 7 + 1);
+    }
+    std::memset(c, 0, bytes);
+
+    double copy = bestSeconds([&] { std::memcpy(c, a, bytes); });
+    std::printf("elements %lld, %.1f MB per tensor, detected ISA %s\n",
+                (long long)n, bytes / 1e6, cpuIsaToString(getCpuIsa()));
+    // memcpy moves 2 streams (read + write), a binary op moves 3
+    std::printf("%-8s %-8s %-6s %-4s %10s\n", "isa", "dtype", "op", "pat",
+                "GB/s");
+    std::printf("%-8s %-8s %-6s %-4s %10.2f\n", "-", "-", "memcpy", "-",
+                2.0 * bytes / copy / 1e9);
+
+    const char *patNames[] = {"VV", "VS", "SV"};
+    for (auto isa : {CpuIsa::Scalar, CpuIsa::AVX2, CpuIsa::AVX512})
+    {
+        if (isa > getCpuIsa())
+            continue;
+        for (auto dtype : {DataType::Float32, DataType::UInt32})
+            for (auto type : {OpType::Add, OpType::Sub, OpType::Mul,
+                              OpType::Div})
+                for (auto pattern : {BinaryPattern::VV, BinaryPattern::VS,
+                                     BinaryPattern::SV})
+                {
+                    auto fn = getBinarySimdKernel(type, dtype, pattern, isa);
+                    double t = bestSeconds([&] { fn(a, b, c, n); });
+                    int streams = pattern == BinaryPattern::VV ? 3 : 2;
+                    std::printf("%-8s %-8s %-6s %-4s %10.2f\n",
+                                cpuIsaToString(isa), dtype.toString().c_str(),
+                                OpType(type).toString(),
+                                patNames[(int)pattern],
+                                streams * bytes / t / 1e9);
+                }
+    }
+    std::free(a);
+    std::free(b);
+    std::free(c);
+    return 0;
+}
@@ -0,0 +1,87 @@
+#include "core/graph.h"
+#include "core/plan.h"
+#include "core/runtime.h"
+#include "operators/concat.h"
+#include "operators/matmul.h"
+#include "operators/unary.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+// Runs a multi-head graph (independent MatMul/Relu chains joined by a
+// Concat) with increasing numbers of inter-op threads and reports the
+// latency next to the sequential run, for the graph and for its compiled
+// plan.
+// Usage: bench_executor [heads] [depth] [rows]  (default 8 4 64)
+
+using namespace infini;
+
+template <typename F> static double bestSeconds(F &&f, int repeat = 20)
+{
+    double best = 1e30;
+    for (int r = 0; r < repeat; ++r)
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        f();
+        auto t1 = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double>(t1 - t0).count());
+    }
+    return best;
+}
+
+static Graph buildHeads(Runtime runtime, int heads, int depth, int rows)
+{
+    Graph g = make_ref<GraphObj>(runtime);
+    auto input = g->addTensor({rows, 256}, DataType::Float32);
+    TensorVec outs;
+    for (int h = 0; h < heads; ++h)
+    {
+        Tensor t = input;
+        for (int d = 0; d < depth; ++d)
+        {
+            auto w = g->addTensor({256, 256}, DataType::Float32);
+            t = g->addOp<MatmulObj>(t, w, nullptr)->getOutput();
+            t = g->addOp<ReluObj>(t, nullptr)->getOutput();
+        }
+        outs.emplace_back(t);
+    }
+    g->addOp<ConcatObj>(outs, nullptr, 1);
+    g->dataMalloc();
+    for (auto &t : g->getInputs())
+        t->setData([](void *data, size_t size, DataType)
+                   {
+                       auto ptr = static_cast<float *>(data);
+                       for (size_t i = 0; i < size; ++i)
+                           ptr[i] = float(int(i % 7) - 3) / 64; });
+    return g;
+}
+
+int main(int argc, char **argv)
+{
+    int heads = argc > 1 ? std::atoi(argv[1]) : 8;
+    int depth = argc > 2 ? std::atoi(argv[2]) : 4;
+    int rows = argc > 3 ? std::atoi(argv[3]) : 64;
+    int cores = std::max(1u, std::thread::hardware_concurrency());
+    std::printf("heads %d, depth %d, rows %d, %d cores\n", heads, depth, rows,
+                cores);
+    std::printf("%-10s %12s %10s %12s\n", "inter-op", "latency(us)",
+                "speedup", "plan(us)");
+
+    double base = 0;
+    for (int threads = 1; threads <= std::max(cores, 4); threads *= 2)
+    {
+        auto runtime = make_ref<NativeCpuRuntimeObj>();
+        runtime->setInterOpThreads(threads);
+        Graph g = buildHeads(runtime, heads, depth, rows);
+        runtime->run(g); // warm up
+        double t = bestSeconds([&] { runtime->run(g); });
+        auto plan = g->compile();
+        double tp = bestSeconds([&] { runtime->run(plan); });
+        if (threads == 1)
+            base = t;
+        std::printf("%-10d %12.1f %10.2f %12.1f\n", threads, t * 1e6, base / t,
+                    tp * 1e6);
+    }
+    return 0;
+}
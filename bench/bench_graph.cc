@@ -0,0 +1,72 @@
+#include "core/graph.h"
+#include "core/runtime.h"
+#include "operators/element_wise.h"
+#include "operators/matmul.h"
+#include "operators/unary.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+// Times the graph passes on an unrolled recurrence of `steps` steps,
+// h = relu(h W + x_t), i.e. three operators per step. The operators are
+// added last step first, so topo_sort has to reverse the whole list, and
+// optimize() folds every Add and Relu into its MatMul.
+// Usage: bench_graph [steps]  (default 100000)
+
+using namespace infini;
+
+template <typename F> static double seconds(F &&f)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    f();
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(t1 - t0).count();
+}
+
+int main(int argc, char **argv)
+{
+    int steps = argc > 1 ? std::atoi(argv[1]) : 100000;
+    auto runtime = make_ref<NativeCpuRuntimeObj>();
+    Graph g = make_ref<GraphObj>(runtime);
+    std::printf("steps %d, operators %d\n", steps, 3 * steps);
+    std::printf("%-14s %12s\n", "pass", "time(ms)");
+    auto report = [](const char *pass, double t)
+    { std::printf("%-14s %12.1f\n", pass, t * 1e3); };
+
+    report("build", seconds(
+                        [&]
+                        {
+                            auto w = g->addTensor({16, 16});
+                            TensorVec h{g->addTensor({1, 16})};
+                            TensorVec mm, sum;
+                            for (int s = 0; s < steps; ++s)
+                            {
+                                mm.emplace_back(g->addTensor({1, 16}));
+                                sum.emplace_back(g->addTensor({1, 16}));
+                                h.emplace_back(g->addTensor({1, 16}));
+                            }
+                            for (int s = steps - 1; s >= 0; --s)
+                            {
+                                auto x = g->addTensor({1, 16});
+                                g->addOpWithOutputs<ReluObj>(sum[s], h[s + 1]);
+                                g->addOpWithOutputs<AddObj>(mm[s], x, sum[s]);
+                                g->addOpWithOutputs<MatmulObj>(h[s], w, mm[s]);
+                            }
+                        }));
+    report("topo_sort", seconds([&] { g->topo_sort(); }));
+    report("getTensor", seconds(
+                            [&]
+                            {
+                                size_t found = 0;
+                                for (auto &t : TensorVec(g->getTensors()))
+                                    found += g->getTensor(t->getFuid()) == t;
+                                if (found != g->getTensors().size())
+                                    std::abort();
+                            }));
+    report("checkValid", seconds([&] { g->checkValid(); }));
+    report("optimize", seconds([&] { g->optimize(); }));
+    report("shape_infer", seconds([&] { g->shape_infer(); }));
+    report("dataMalloc", seconds([&] { g->dataMalloc(); }));
+    std::printf("%zu operators after optimize\n", g->getOperators().size());
+    return 0;
+}
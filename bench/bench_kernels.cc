@@ -0,0 +1,439 @@
+#include "core/graph.h"
+#include "core/kernel.h"
+#include "core/plan.h"
+#include "core/runtime.h"
+#include "harness.h"
+#include "operators/concat.h"
+#include "operators/element_wise.h"
+#include "operators/matmul.h"
+#include "operators/transpose.h"
+#include "operators/unary.h"
+#include "utils/cpu_isa.h"
+#include "utils/profiler.h"
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <omp.h>
+#include <sstream>
+#include <thread>
+
+// Micro-benchmarks of every CPU kernel over shapes, data types and OpenMP
+// thread counts. Each case is a single-operator graph run through its
+// compiled plan; the report has percentile latencies, GB/s and GFLOP/s.
+// Usage: bench_kernels [--out FILE] [--filter SUBSTR] [--threads 1,2,4]
+//                      [--min-time SECONDS] [--quick]
+//        bench_kernels --compare BASE.json CURRENT.json [--threshold 0.1]
+// --compare exits with 1 if a case's median got slower than the threshold.
+
+using namespace infini;
+
+namespace
+{
+    using Builder = std::function<Operator(GraphObj &)>;
+
+    struct Config
+    {
+        bench::Options options;
+        std::vector<int> threads;
+        std::string filter;
+        bool quick = false;
+    };
+
+    string shapeString(const Shape &shape)
+    {
+        string s;
+        for (size_t i = 0; i < shape.size(); ++i)
+            s += (i ? "x" : "") + std::to_string(shape[i]);
+        return s.empty() ? "scalar" : s;
+    }
+
+    // Small positive values, so that Div and the casts stay in range.
+    void fill(void *data, size_t size, DataType dtype)
+    {
+        auto bytes = static_cast<uint8_t *>(data);
+        for (size_t i = 0; i < size; ++i)
+        {
+            int v = int(i % 7) + 1;
+            if (dtype == DataType::Float32)
+                reinterpret_cast<float *>(bytes)[i] = v * 0.25f;
+            else if (dtype == DataType::Double)
+                reinterpret_cast<double *>(bytes)[i] = v * 0.25;
+            else if (dtype == DataType::Float16)
+                reinterpret_cast<uint16_t *>(bytes)[i] = 0x3c00 + v; // ~1.0
+            else if (dtype == DataType::BFloat16)
+                reinterpret_cast<uint16_t *>(bytes)[i] = 0x3f80 + v; // ~1.0
+            else
+            {
+                // integers of any width, little-endian
+                auto size = dtype.getSize();
+                std::memset(bytes + i * size, 0, size);
+                bytes[i * size] = uint8_t(v);
+            }
+        }
+    }
+
+    class Suite
+    {
+    public:
+        explicit Suite(const Config &config) : config(config) {}
+
+        void add(const string &name, std::map<string, string> labels,
+                 const Builder &build)
+        {
+            if (!config.filter.empty() &&
+                name.find(config.filter) == string::npos)
+                return;
+            auto runtime = make_ref<NativeCpuRuntimeObj>();
+            runtime->setInterOpThreads(1);
+            Graph g = make_ref<GraphObj>(runtime);
+            auto op = build(*g);
+            g->dataMalloc();
+            for (auto &t : g->getInputs())
+                t->setData(fill);
+
+            labels["op"] = op->getOpType().toString();
+            labels["dtype"] = op->getInputs(0)->getDType().toString();
+            labels["kernel"] = std::get<1>(
+                KernelRegistry::getInstance().getKernelItem(KernelAttrs{
+                    runtime->getDevice(), op->getOpType().underlying()}));
+            double bytes = 0;
+            for (auto &t : op->getInputs())
+                bytes += t->getBytes();
+            for (auto &t : op->getOutputs())
+                bytes += t->getBytes();
+
+            for (int threads : config.threads)
+            {
+                omp_set_num_threads(threads);
+                auto plan = g->compile();
+                bench::Result r;
+                r.name = name + "/t" + std::to_string(threads);
+                r.labels = labels;
+                r.threads = threads;
+                r.bytes = bytes;
+                r.flops = Profiler::countFlops(*op);
+                r.stats = bench::measure([&] { runtime->run(plan); },
+                                         config.options);
+                std::printf("%-44s %10.1f %10.1f %10.1f %9.2f %9.2f\n",
+                            r.name.c_str(), r.stats.p50, r.stats.p90,
+                            r.stats.p99, r.gbps(), r.gflops());
+                std::fflush(stdout);
+                results.emplace_back(std::move(r));
+            }
+        }
+
+        const std::vector<bench::Result> &getResults() const
+        {
+            return results;
+        }
+
+    private:
+        const Config &config;
+        std::vector<bench::Result> results;
+    };
+
+    Operator addBinary(GraphObj &g, const string &type, Tensor a, Tensor b)
+    {
+        if (type == "Add")
+            return g.addOp<AddObj>(a, b, nullptr);
+        if (type == "Sub")
+            return g.addOp<SubObj>(a, b, nullptr);
+        if (type == "Mul")
+            return g.addOp<MulObj>(a, b, nullptr);
+        return g.addOp<DivObj>(a, b, nullptr);
+    }
+
+    void elementwise(Suite &suite, bool quick)
+    {
+        std::vector<Shape> shapes{{64, 64}, {1024, 1024}};
+        if (!quick)
+            shapes.push_back({64, 256, 256});
+        for (auto dtype : {DataType::Float32, DataType::UInt32})
+            for (string type : {"Add", "Sub", "Mul", "Div"})
+                for (auto &shape : shapes)
+                {
+                    // the second operand of each broadcast pattern
+                    Shape row(shape.end() - 1, shape.end()), col = shape;
+                    col.back() = 1;
+                    std::vector<std::pair<string, Shape>> patterns{
+                        {"VV", shape},
+                        {"row", row},
+                        {"col", col},
+                        {"scalar", {1}}};
+                    for (auto &[pattern, other] : patterns)
+                    {
+                        auto name = type + "/" + dtype.toString() + "/" +
+                                    pattern + "/" + shapeString(shape);
+                        suite.add(name,
+                                  {{"shape", shapeString(shape)},
+                                   {"pattern", pattern}},
+                                  [&](GraphObj &g)
+                                  {
+                                      auto a = g.addTensor(shape, dtype);
+                                      auto b = g.addTensor(other, dtype);
+                                      return addBinary(g, type, a, b);
+                                  });
+                    }
+                }
+    }
+
+    void transpose(Suite &suite, bool quick)
+    {
+        std::vector<std::pair<Shape, std::vector<vector<int>>>> cases{
+            {{64, 128, 256},
+             {{0, 1, 2},
+              {0, 2, 1},
+              {1, 0, 2},
+              {1, 2, 0},
+              {2, 0, 1},
+              {2, 1, 0}}},
+            {{8, 32, 32, 64}, {{0, 2, 1, 3}, {0, 2, 3, 1}, {0, 3, 1, 2}}}};
+        if (quick)
+            cases[0].first = {16, 64, 128};
+        for (auto dtype : {DataType::Float32, DataType::Float16})
+            for (auto &[shape, perms] : cases)
+                for (auto &perm : perms)
+                {
+                    auto name = "Transpose/" + dtype.toString() + "/" +
+                                shapeString(shape) + "/" + vecToString(perm);
+                    suite.add(name, {{"shape", shapeString(shape)},
+                                     {"permutation", vecToString(perm)}},
+                              [&](GraphObj &g)
+                              {
+                                  auto x = g.addTensor(shape, dtype);
+                                  return Operator(g.addOp<TransposeObj>(
+                                      x, nullptr, perm));
+                              });
+                }
+    }
+
+    void concat(Suite &suite, bool quick)
+    {
+        Shape shape = quick ? Shape{8, 32, 128} : Shape{16, 64, 256};
+        for (auto dtype : {DataType::Float32, DataType::Float16})
+            for (int axis = 0; axis < int(shape.size()); ++axis)
+            {
+                auto name = "Concat/" + dtype.toString() + "/3x" +
+                            shapeString(shape) + "/axis" +
+                            std::to_string(axis);
+                suite.add(name, {{"shape", "3x" + shapeString(shape)},
+                                 {"axis", std::to_string(axis)}},
+                          [&](GraphObj &g)
+                          {
+                              TensorVec inputs;
+                              for (int i = 0; i < 3; ++i)
+                                  inputs.push_back(g.addTensor(shape, dtype));
+                              return Operator(
+                                  g.addOp<ConcatObj>(inputs, nullptr, axis));
+                          });
+            }
+    }
+
+    void unary(Suite &suite, bool quick)
+    {
+        Shape shape = quick ? Shape{256, 1024} : Shape{1024, 1024};
+        for (auto dtype : {DataType::Float32, DataType::UInt32})
+        {
+            auto suffix = "/" + dtype.toString() + "/" + shapeString(shape);
+            std::map<string, string> labels{{"shape", shapeString(shape)}};
+            suite.add("Relu" + suffix, labels,
+                      [&](GraphObj &g)
+                      {
+                          auto x = g.addTensor(shape, dtype);
+                          return Operator(g.addOp<ReluObj>(x, nullptr));
+                      });
+            suite.add("Clip" + suffix, labels,
+                      [&](GraphObj &g)
+                      {
+                          auto x = g.addTensor(shape, dtype);
+                          return Operator(
+                              g.addOp<ClipObj>(x, nullptr, 2.0f, 5.0f));
+                      });
+        }
+    }
+
+    void cast(Suite &suite, bool quick)
+    {
+        Shape shape = quick ? Shape{256, 1024} : Shape{1024, 1024};
+        // the data types of each cast come from a detached operator
+        auto probe = make_ref<GraphObj>(make_ref<NativeCpuRuntimeObj>());
+        auto scalar = probe->addTensor({1}, DataType::Float32);
+        for (int t = int(CastType::Float2Float16);
+             t <= int(CastType::Float2Float); ++t)
+        {
+            auto type = CastType(t);
+            auto probeOp = make_ref<CastObj>(nullptr, scalar, scalar, type);
+            auto from = probeOp->getInputDataType();
+            auto to = probeOp->getOutputDataType();
+            auto name = "Cast/" + from.toString() + "to" + to.toString() + "/" +
+                        shapeString(shape);
+            suite.add(name, {{"shape", shapeString(shape)}},
+                      [&, from = from, type = type](GraphObj &g)
+                      {
+                          auto x = g.addTensor(shape, from);
+                          return Operator(g.addOp<CastObj>(x, nullptr, type));
+                      });
+        }
+    }
+
+    void matmul(Suite &suite, bool quick)
+    {
+        // {batch, m, n, k}
+        std::vector<std::array<int, 4>> shapes{
+            {1, 64, 64, 64}, {1, 256, 256, 256}, {1, 1, 4096, 1024},
+            {1, 1024, 64, 256}, {8, 128, 128, 128}};
+        if (!quick)
+            shapes.push_back({1, 512, 512, 512});
+        for (auto dtype : {DataType::Float32, DataType::UInt32})
+            for (auto [batch, m, n, k] : shapes)
+            {
+                Shape a{m, k}, b{k, n};
+                if (batch > 1)
+                    a.insert(a.begin(), batch), b.insert(b.begin(), batch);
+                auto mnk = std::to_string(m) + "x" + std::to_string(n) + "x" +
+                           std::to_string(k);
+                if (batch > 1)
+                    mnk = std::to_string(batch) + "*" + mnk;
+                suite.add("MatMul/" + dtype.toString() + "/" + mnk,
+                          {{"shape", mnk}},
+                          [&, a = a, b = b](GraphObj &g)
+                          {
+                              auto x = g.addTensor(a, dtype);
+                              auto w = g.addTensor(b, dtype);
+                              return Operator(
+                                  g.addOp<MatmulObj>(x, w, nullptr));
+                          });
+            }
+    }
+
+    bool readFile(const string &path, string &text)
+    {
+        std::ifstream file(path);
+        if (!file)
+            return false;
+        std::stringstream ss;
+        ss << file.rdbuf();
+        text = ss.str();
+        return true;
+    }
+
+    int compareReports(const string &basePath, const string &currentPath,
+                       double threshold)
+    {
+        string baseText, currentText;
+        if (!readFile(basePath, baseText) ||
+            !readFile(currentPath, currentText))
+        {
+            std::fprintf(stderr, "cannot read %s or %s\n", basePath.c_str(),
+                         currentPath.c_str());
+            return 2;
+        }
+        auto comparisons = bench::compare(bench::fromJson(baseText),
+                                          bench::fromJson(currentText),
+                                          threshold);
+        int regressions = 0, improvements = 0;
+        std::printf("%-44s %10s %10s %8s\n", "case", "base(us)", "now(us)",
+                    "ratio");
+        for (auto &c : comparisons)
+        {
+            regressions += c.regression;
+            improvements += c.improvement;
+            std::printf("%-44s %10.1f %10.1f %8.3f%s\n", c.name.c_str(),
+                        c.base, c.current, c.ratio,
+                        c.regression ? "  REGRESSION"
+                                     : (c.improvement ? "  improved" : ""));
+        }
+        std::printf("%zu cases compared, %d regressions, %d improvements "
+                    "(threshold %.0f%%)\n",
+                    comparisons.size(), regressions, improvements,
+                    threshold * 100);
+        return regressions ? 1 : 0;
+    }
+
+    std::vector<int> parseList(const char *s)
+    {
+        std::vector<int> out;
+        for (std::stringstream ss(s); ss.good();)
+        {
+            string item;
+            std::getline(ss, item, ',');
+            if (!item.empty() && std::atoi(item.c_str()) > 0)
+                out.push_back(std::atoi(item.c_str()));
+        }
+        return out;
+    }
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Config config;
+    string out = "bench_kernels.json";
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--compare" && i + 2 < argc)
+        {
+            double threshold = 0.1;
+            if (i + 4 < argc && string(argv[i + 3]) == "--threshold")
+                threshold = std::atof(argv[i + 4]);
+            return compareReports(argv[i + 1], argv[i + 2], threshold);
+        }
+        else if (arg == "--out" && hasValue)
+            out = argv[++i];
+        else if (arg == "--filter" && hasValue)
+            config.filter = argv[++i];
+        else if (arg == "--threads" && hasValue)
+            config.threads = parseList(argv[++i]);
+        else if (arg == "--min-time" && hasValue)
+            config.options.minSeconds = std::atof(argv[++i]);
+        else if (arg == "--quick")
+            config.quick = true;
+        else
+        {
+            std::fprintf(stderr, "unknown argument %s, see the usage at the "
+                                 "top of bench/bench_kernels.cc\n",
+                         arg.c_str());
+            return 2;
+        }
+    }
+    if (config.quick)
+        config.options.minSeconds = std::min(config.options.minSeconds, 0.05);
+    int cores = std::max(1, omp_get_max_threads());
+    if (config.threads.empty())
+    {
+        config.threads = {1};
+        if (cores > 1)
+            config.threads.push_back(cores);
+    }
+
+    std::printf("%s, %d OpenMP threads available\n",
+                cpuIsaToString(getCpuIsa()), cores);
+    std::printf("%-44s %10s %10s %10s %9s %9s\n", "case", "p50(us)",
+                "p90(us)", "p99(us)", "GB/s", "GFLOP/s");
+    Suite suite(config);
+    elementwise(suite, config.quick);
+    transpose(suite, config.quick);
+    concat(suite, config.quick);
+    unary(suite, config.quick);
+    cast(suite, config.quick);
+    matmul(suite, config.quick);
+
+    std::map<string, string> context{
+        {"isa", cpuIsaToString(getCpuIsa())},
+        {"cores", std::to_string(cores)},
+        {"hardware_threads",
+         std::to_string(std::thread::hardware_concurrency())}};
+    std::ofstream file(out);
+    file << bench::toJson(context, suite.getResults());
+    if (!file)
+    {
+        std::fprintf(stderr, "cannot write %s\n", out.c_str());
+        return 2;
+    }
+    std::printf("%zu results written to %s\n", suite.getResults().size(),
+                out.c_str());
+    return 0;
+}
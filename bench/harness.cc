@@ -0,0 +1,331 @@
+#include "harness.h"
+#include "utils/json.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+
+namespace bench
+{
+    namespace
+    {
+        using infini::jsonEscape;
+
+        std::string number(double v)
+        {
+            char buf[32];
+            std::snprintf(buf, sizeof(buf), "%.6g", std::isfinite(v) ? v : 0.0);
+            return buf;
+        }
+
+        // Just enough JSON for the reports toJson() writes: objects, arrays,
+        // strings, numbers and literals.
+        struct Value
+        {
+            enum Kind
+            {
+                Null,
+                Bool,
+                Number,
+                String,
+                Array,
+                Object
+            } kind = Null;
+            double num = 0;
+            std::string str;
+            std::vector<Value> items;
+            std::vector<std::pair<std::string, Value>> fields;
+
+            const Value *get(const std::string &key) const
+            {
+                for (auto &[k, v] : fields)
+                    if (k == key)
+                        return &v;
+                return nullptr;
+            }
+        };
+
+        class Parser
+        {
+        public:
+            explicit Parser(const std::string &text) : s(text) {}
+
+            Value parse()
+            {
+                Value v = value();
+                skip();
+                if (i != s.size())
+                    fail("trailing characters");
+                return v;
+            }
+
+        private:
+            const std::string &s;
+            size_t i = 0;
+
+            [[noreturn]] void fail(const char *what) const
+            {
+                throw std::runtime_error("JSON: " + std::string(what) +
+                                         " at offset " + std::to_string(i));
+            }
+
+            void skip()
+            {
+                while (i < s.size() && std::isspace((unsigned char)s[i]))
+                    ++i;
+            }
+
+            void expect(char c)
+            {
+                skip();
+                if (i >= s.size() || s[i] != c)
+                    fail("unexpected character");
+                ++i;
+            }
+
+            std::string string()
+            {
+                expect('"');
+                std::string out;
+                while (i < s.size() && s[i] != '"')
+                {
+                    char c = s[i++];
+                    if (c != '\\')
+                    {
+                        out += c;
+                        continue;
+                    }
+                    if (i >= s.size())
+                        fail("unterminated escape");
+                    c = s[i++];
+                    switch (c)
+                    {
+                    case 'n':
+                        out += '\n';
+                        break;
+                    case 't':
+                        out += '\t';
+                        break;
+                    case 'u':
+                        // only control characters are written escaped
+                        if (i + 4 > s.size())
+                            fail("short \\u escape");
+                        out += char(std::strtol(s.substr(i, 4).c_str(),
+                                                nullptr, 16));
+                        i += 4;
+                        break;
+                    default:
+                        out += c;
+                    }
+                }
+                if (i >= s.size())
+                    fail("unterminated string");
+                ++i;
+                return out;
+            }
+
+            Value value()
+            {
+                skip();
+                if (i >= s.size())
+                    fail("unexpected end");
+                Value v;
+                char c = s[i];
+                if (c == '{')
+                {
+                    v.kind = Value::Object;
+                    ++i;
+                    skip();
+                    if (s[i] == '}')
+                        return ++i, v;
+                    do
+                    {
+                        auto key = string();
+                        expect(':');
+                        v.fields.emplace_back(key, value());
+                        skip();
+                    } while (i < s.size() && s[i] == ',' && ++i);
+                    expect('}');
+                }
+                else if (c == '[')
+                {
+                    v.kind = Value::Array;
+                    ++i;
+                    skip();
+                    if (s[i] == ']')
+                        return ++i, v;
+                    do
+                    {
+                        v.items.emplace_back(value());
+                        skip();
+                    } while (i < s.size() && s[i] == ',' && ++i);
+                    expect(']');
+                }
+                else if (c == '"')
+                {
+                    v.kind = Value::String;
+                    v.str = string();
+                }
+                else if (s.compare(i, 4, "true") == 0 ||
+                         s.compare(i, 5, "false") == 0)
+                {
+                    v.kind = Value::Bool;
+                    v.num = s[i] == 't';
+                    i += s[i] == 't' ? 4 : 5;
+                }
+                else if (s.compare(i, 4, "null") == 0)
+                    i += 4;
+                else
+                {
+                    char *end = nullptr;
+                    v.kind = Value::Number;
+                    v.num = std::strtod(s.c_str() + i, &end);
+                    if (end == s.c_str() + i)
+                        fail("invalid value");
+                    i = end - s.c_str();
+                }
+                return v;
+            }
+        };
+
+        double numberOf(const Value &obj, const std::string &key)
+        {
+            auto *v = obj.get(key);
+            return v && v->kind == Value::Number ? v->num : 0;
+        }
+    } // namespace
+
+    double percentile(std::vector<double> sorted, double p)
+    {
+        if (sorted.empty())
+            return 0;
+        std::sort(sorted.begin(), sorted.end());
+        double rank = p / 100 * (sorted.size() - 1);
+        size_t lo = size_t(rank), hi = std::min(lo + 1, sorted.size() - 1);
+        return sorted[lo] + (sorted[hi] - sorted[lo]) * (rank - lo);
+    }
+
+    Stats measure(const std::function<void()> &run, const Options &options)
+    {
+        using clock = std::chrono::steady_clock;
+        for (int i = 0; i < options.warmup; ++i)
+            run();
+        std::vector<double> samples;
+        double elapsed = 0;
+        while (int(samples.size()) < options.maxSamples &&
+               (int(samples.size()) < options.minSamples ||
+                elapsed < options.minSeconds))
+        {
+            auto t0 = clock::now();
+            run();
+            double t = std::chrono::duration<double>(clock::now() - t0).count();
+            samples.push_back(t * 1e6);
+            elapsed += t;
+        }
+
+        Stats stats;
+        std::sort(samples.begin(), samples.end());
+        stats.samples = samples.size();
+        stats.min = samples.front();
+        stats.max = samples.back();
+        for (double s : samples)
+            stats.mean += s / samples.size();
+        stats.p50 = percentile(samples, 50);
+        stats.p90 = percentile(samples, 90);
+        stats.p99 = percentile(samples, 99);
+        return stats;
+    }
+
+    std::string toJson(const std::map<std::string, std::string> &context,
+                       const std::vector<Result> &results)
+    {
+        std::ostringstream os;
+        os << "{\"version\":1,\"context\":{";
+        bool first = true;
+        for (auto &[k, v] : context)
+        {
+            os << (first ? "" : ",") << "\"" << jsonEscape(k) << "\":\""
+               << jsonEscape(v) << "\"";
+            first = false;
+        }
+        os << "},\"results\":[";
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const auto &r = results[i];
+            const auto &s = r.stats;
+            os << (i ? ",\n" : "\n") << "{\"name\":\"" << jsonEscape(r.name)
+               << "\"";
+            for (auto &[k, v] : r.labels)
+                os << ",\"" << jsonEscape(k) << "\":\"" << jsonEscape(v)
+                   << "\"";
+            os << ",\"threads\":" << r.threads
+               << ",\"bytes\":" << number(r.bytes)
+               << ",\"flops\":" << number(r.flops)
+               << ",\"samples\":" << s.samples
+               << ",\"min_us\":" << number(s.min)
+               << ",\"mean_us\":" << number(s.mean)
+               << ",\"p50_us\":" << number(s.p50)
+               << ",\"p90_us\":" << number(s.p90)
+               << ",\"p99_us\":" << number(s.p99)
+               << ",\"max_us\":" << number(s.max)
+               << ",\"gbps\":" << number(r.gbps())
+               << ",\"gflops\":" << number(r.gflops()) << "}";
+        }
+        os << "\n]}\n";
+        return os.str();
+    }
+
+    std::vector<Result> fromJson(const std::string &text)
+    {
+        Value root = Parser(text).parse();
+        auto *list = root.get("results");
+        if (!list || list->kind != Value::Array)
+            throw std::runtime_error("JSON: no \"results\" array");
+        std::vector<Result> results;
+        for (auto &item : list->items)
+        {
+            Result r;
+            for (auto &[k, v] : item.fields)
+                if (v.kind == Value::String)
+                    (k == "name" ? r.name : r.labels[k]) = v.str;
+            r.threads = numberOf(item, "threads");
+            r.bytes = numberOf(item, "bytes");
+            r.flops = numberOf(item, "flops");
+            r.stats.samples = numberOf(item, "samples");
+            r.stats.min = numberOf(item, "min_us");
+            r.stats.mean = numberOf(item, "mean_us");
+            r.stats.p50 = numberOf(item, "p50_us");
+            r.stats.p90 = numberOf(item, "p90_us");
+            r.stats.p99 = numberOf(item, "p99_us");
+            r.stats.max = numberOf(item, "max_us");
+            results.emplace_back(std::move(r));
+        }
+        return results;
+    }
+
+    std::vector<Comparison> compare(const std::vector<Result> &base,
+                                    const std::vector<Result> &current,
+                                    double threshold)
+    {
+        std::map<std::string, const Result *> byName;
+        for (auto &r : base)
+            byName[r.name] = &r;
+        std::vector<Comparison> out;
+        for (auto &r : current)
+        {
+            auto it = byName.find(r.name);
+            if (it == byName.end() || it->second->stats.p50 <= 0)
+                continue;
+            double b = it->second->stats.p50, c = r.stats.p50;
+            double ratio = c / b;
+            out.push_back({r.name, b, c, ratio, ratio > 1 + threshold,
+                           ratio < 1 / (1 + threshold)});
+        }
+        return out;
+    }
+
+} // namespace bench
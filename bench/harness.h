@@ -0,0 +1,85 @@
+#pragma once
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+// A small benchmark harness without external dependencies: adaptive
+// sampling, percentile statistics, JSON reports and the comparison of two
+// reports.
+
+namespace bench
+{
+    struct Options
+    {
+        // each case samples for at least this long...
+        double minSeconds = 0.2;
+        // ...and at least / at most this many times
+        int minSamples = 5, maxSamples = 1000;
+        // untimed runs before sampling
+        int warmup = 2;
+    };
+
+    // Latency statistics of one case, in microseconds.
+    struct Stats
+    {
+        int samples = 0;
+        double min = 0, mean = 0, p50 = 0, p90 = 0, p99 = 0, max = 0;
+    };
+
+    struct Result
+    {
+        // unique key used to match runs, e.g. "Add/Float32/VS/1024x1024/t4"
+        std::string name;
+        // descriptive fields: op, kernel, dtype, shape, ...
+        std::map<std::string, std::string> labels;
+        int threads = 1;
+        // bytes read + written and operations per run
+        double bytes = 0, flops = 0;
+        Stats stats;
+
+        // throughput at the median latency
+        double gbps() const
+        {
+            return stats.p50 > 0 ? bytes / stats.p50 / 1e3 : 0;
+        }
+        double gflops() const
+        {
+            return stats.p50 > 0 ? flops / stats.p50 / 1e3 : 0;
+        }
+    };
+
+    // Times `run` until both the time and sample minimums are met.
+    Stats measure(const std::function<void()> &run, const Options &options);
+
+    // Linear interpolation between the closest ranks, p in [0, 100].
+    double percentile(std::vector<double> sorted, double p);
+
+    /**
+     * @brief JSON report: the run's context (machine, ISA, ...) and every
+     * result with its statistics and throughputs.
+     */
+    std::string toJson(const std::map<std::string, std::string> &context,
+                       const std::vector<Result> &results);
+
+    // Reads the results of a report written by toJson().
+    std::vector<Result> fromJson(const std::string &text);
+
+    struct Comparison
+    {
+        std::string name;
+        double base, current; // median latencies, us
+        double ratio;         // current / base
+        bool regression, improvement;
+    };
+
+    /**
+     * @brief Matches results by name. A case is a regression when its median
+     * got slower by more than `threshold` (0.1 = 10%) and an improvement
+     * when it got faster by as much.
+     */
+    std::vector<Comparison> compare(const std::vector<Result> &base,
+                                    const std::vector<Result> &current,
+                                    double threshold);
+
+} // namespace bench
@@ -6,6 +6,7 @@
 #endif
 #include <cstddef>
 #include <map>
+#include <set>
 #include <unordered_set>
 
 namespace infini {
@@ -14,8 +15,12 @@ namespace infini {
   private:
     Runtime runtime;
 
+    // bytes held by live blocks
     size_t used;
 
+    // end of the highest live block; the arena never needs more than this
+    size_t head;
+
     size_t peak;
 
     size_t alignment;
@@ -23,7 +28,11 @@ namespace infini {
     // pointer to the memory actually allocated
     void *ptr;
 
-    std::map<size_t, size_t>freeBlocks; 
+    // free blocks below `head`, keyed by address, for merging neighbours
+    std::map<size_t, size_t> freeBlocks;
+
+    // the same blocks as (size, address), for the best fit in alloc()
+    std::set<std::pair<size_t, size_t>> freeBySize;
 
   public:
     Allocator(Runtime runtime);
@@ -48,9 +57,18 @@ namespace infini {
 
     void info();
 
+    // function: release the memory and forget every block, for a new plan
+    void reset();
+
+    size_t getPeak() const { return peak; }
+
   private:
     // function: memory alignment, rouned up
     // return: size of the aligned memory block
     size_t getAlignedSize(size_t size);
+
+    // function: add or remove a block in both free-block indexes
+    void insertFreeBlock(size_t addr, size_t size);
+    void eraseFreeBlock(size_t addr, size_t size);
   };
 }
@@ -11,15 +11,20 @@ class BlobObj
 {
   Runtime runtime;
   void *ptr;
+  // Keeps memory the graph's allocator does not manage alive, e.g. the file
+  // mapping weights were loaded into. Empty for allocator memory.
+  Ref<void> owner;
 
 public:
-  BlobObj(Runtime runtime, void *ptr) : runtime(runtime), ptr(ptr) {}
+  BlobObj(Runtime runtime, void *ptr, Ref<void> owner = nullptr)
+      : runtime(runtime), ptr(ptr), owner(std::move(owner)) {}
   BlobObj(BlobObj &other) = delete;
   BlobObj &operator=(BlobObj const &) = delete;
   ~BlobObj() {};
 
   template <typename T>
   T getPtr() const { return reinterpret_cast<T>(ptr); }
+  bool isExternal() const { return owner != nullptr; }
 };
 
 } // namespace infini
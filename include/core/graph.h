@@ -1,6 +1,7 @@
 #pragma once
 #include "core/allocator.h"
 #include "core/operator.h"
+#include "core/plan.h"
 #include "core/tensor.h"
 #include <algorithm>
 #include <cstdint>
@@ -10,11 +11,22 @@ namespace infini
 
     class GraphObj : public Object
     {
+        friend class PlanCache;
+
     protected:
         Runtime runtime;
-        TensorVec tensors;
-        OpVec ops;
+        // Removing leaves a null slot behind, so that removal is O(1); the
+        // slots are dropped by compact() before anything walks the lists.
+        mutable TensorVec tensors;
+        mutable OpVec ops;
         Allocator allocator;
+        std::unordered_map<const OperatorObj *, vector<OperatorObj *>>
+            memoryDeps;
+        // positions in `tensors` by fuid and in `ops` by guid
+        mutable std::unordered_map<UidBaseType, size_t> tensorSlots, opSlots;
+        mutable size_t holes = 0;
+        // the plan getPlan() returns, until something makes it stale
+        ExecutionPlan plan;
 
     public:
         explicit GraphObj(Runtime runtime)
@@ -25,23 +37,23 @@ namespace infini
         Tensor addTensor(Shape dim, DataType dtype = DataType::Float32);
         Tensor addTensor(const Tensor &tensor);
         TensorVec addTensor(const TensorVec &tensors);
-        void removeOperator(Operator op)
+        void removeOperator(Operator op);
+        void removeTensor(Tensor tensor);
+
+        const TensorVec &getTensors() const
         {
-            auto it = std::find(ops.begin(), ops.end(), op);
-            if (it != ops.end())
-                ops.erase(it);
+            compact();
+            return tensors;
         }
-
-        void removeTensor(Tensor tensor)
+        const OpVec &getOperators() const
         {
-            auto it = std::find(tensors.begin(), tensors.end(), tensor);
-            if (it != tensors.end())
-                tensors.erase(it);
+            compact();
+            return ops;
         }
-
-        const TensorVec &getTensors() const { return tensors; }
-        const OpVec &getOperators() const { return ops; }
+        // The tensor with the given fuid, or nullptr.
         Tensor getTensor(int) const;
+        // The operator with the given guid, or nullptr.
+        Operator getOperator(UidBaseType guid) const;
 
         /**
          * @brief Sort the nodes in topological order.
@@ -51,12 +63,54 @@ namespace infini
          */
         bool topo_sort();
 
+        /**
+         * @brief Precomputes the operators reading only constants, composes
+         * Transpose chains, drops operators that copy their input (identity
+         * Transposes, same-type Casts, single-input Concats), folds
+         * Transposes into MatMul, merges duplicate operators and fuses
+         * epilogues and element-wise chains.
+         */
         void optimize();
 
         void shape_infer();
 
+        /**
+         * @brief Gives the graph inputs with the given fuids new shapes and
+         * re-infers only the operators downstream of a changed input, in
+         * topological order, stopping where the shapes stay the same.
+         * Returns the tensors whose size changed, the inputs included, and
+         * the views whose shape changed: the memory plan of dataMalloc() is
+         * stale exactly when the result is not empty.
+         */
+        TensorVec updateInputShapes(
+            const vector<pair<UidBaseType, Shape>> &shapes);
+
         void dataMalloc();
 
+        /**
+         * @brief Operators that must finish before `op` although `op` does
+         * not read their outputs: dataMalloc() placed an output of `op` over
+         * memory they read. Together with the data edges they order every
+         * access to a reused block; valid until the next dataMalloc().
+         */
+        const vector<OperatorObj *> &getMemoryDependencies(
+            const OperatorObj *op) const;
+
+        /**
+         * @brief Binds every operator to its kernel and lets the kernel
+         * prepare its launch over the current data pointers and shapes. Call
+         * after dataMalloc(); the plan is valid while this graph lives and
+         * until its next dataMalloc() or shape change.
+         */
+        ExecutionPlan compile();
+
+        /**
+         * @brief compile() once and reuse the plan: dataMalloc(), a shape
+         * change or an edit of the operators drops it, and the next call
+         * compiles again. RuntimeObj::run(const Graph &) runs this plan.
+         */
+        ExecutionPlan getPlan();
+
         /**
          * @brief Add an operator and create its outputs. Output tensor arguments
          * should be empty Refs (e.g., nullptr).
@@ -86,7 +140,7 @@ namespace infini
         inline TensorVec getInputs() const
         {
             TensorVec ret;
-            for (const auto &t : tensors)
+            for (const auto &t : getTensors())
                 if (!t->getSource())
                     ret.emplace_back(t);
             return ret;
@@ -98,20 +152,95 @@ namespace infini
         inline TensorVec getOutputs() const
         {
             TensorVec ret;
-            for (const auto &t : tensors)
-                if (t->getTargets().empty())
+            for (const auto &t : getTensors())
+                if (!t->hasTargets())
                     ret.emplace_back(t);
             return ret;
         }
 
         bool checkValid() const;
 
+        /**
+         * @brief Replaces the operators of a match, ordered so that every
+         * operator comes before the producers of its inputs, by the
+         * operators of `add` (created with nullptr as their graph), and
+         * makes the readers of every `first` of `replace` read its `second`.
+         * A matched operator other than the first is kept when its outputs
+         * still have other readers. Nothing changes and false is returned
+         * when the first operator would have to stay, when an operator that
+         * stays would share an output with `add`, or when a replaced tensor
+         * is a graph output. Operators whose neighbourhood changed are
+         * appended to `touched`.
+         */
+        bool replaceSubgraph(const OpVec &matched, const OpVec &add,
+                             const vector<pair<Tensor, Tensor>> &replace,
+                             OpVec *touched = nullptr);
+
     private:
         /**
          * @brief Add reverse connections and Op relationship in ctor.
          */
         void addOperatorAndConnect(const Operator &op);
 
+        // Drops the null slots of removed tensors and operators.
+        void compact() const
+        {
+            if (holes > 0)
+                reindex();
+        }
+
+        // Drops the null slots and renumbers both slot maps, after the
+        // lists were reordered or replaced.
+        void reindex() const;
+
+        /**
+         * @brief Makes the readers of `from` read `to` instead, edges
+         * included, and returns them. `from` is left without readers.
+         */
+        OpVec redirectReaders(const Tensor &from, const Tensor &to);
+
+        /**
+         * @brief Runs every operator whose inputs are all constants once,
+         * with its kernel, and keeps its outputs as constants in its place.
+         * Operators writing graph outputs stay. Constants no longer read by
+         * anything are dropped.
+         */
+        void foldConstants();
+
+        /**
+         * @brief Merges operators of the same type and attributes reading
+         * the same inputs, in one pass in topological order so that their
+         * readers can merge too. The readers of a merged operator read the
+         * outputs of the first one; operators writing graph outputs stay.
+         */
+        void eliminateCommonSubexpressions();
+
+        /**
+         * @brief Folds an Add of a bias row and/or a following Relu or Clip
+         * into the MatMul producing their input, when they are the only
+         * readers of the intermediate results.
+         */
+        void fuseMatmulEpilogues();
+
+        /**
+         * @brief Replaces every maximal chain of at least two element-wise,
+         * unary and Clip operators, whose intermediate results have no other
+         * reader, by one FusedElementWiseObj.
+         */
+        void fuseElementWiseChains();
+
+        /**
+         * @brief Disconnects `op` from its inputs, its output tensors and its
+         * neighbours and removes it from the graph. Its outputs stay.
+         */
+        void detachOperator(const Operator &op);
+
+        /**
+         * @brief detachOperator() for many operators at once, in time linear
+         * in the edges they touch however many readers their inputs have.
+         */
+        void detachOperators(const OpVec &dead);
+
         /**
          * @brief If the nodes is sorted in topological order.
          */
@@ -10,6 +10,12 @@ namespace infini
 
     class RuntimeObj;
 
+    /**
+     * @brief An operator bound to its kernel, ready to run: lookups, casts,
+     * shape and stride computations are done, only the work is left.
+     */
+    using KernelLaunch = std::function<void()>;
+
     class Kernel
     {
     public:
@@ -21,6 +27,18 @@ namespace infini
          */
         virtual void compute(const Operator &op,
                              const RuntimeObj *context) const = 0;
+
+        /**
+         * @brief Prepares `op` for repeated execution. The launch captures
+         * raw data pointers and precomputed metadata, so it is valid only as
+         * long as the tensors keep their data and shapes, i.e. until the next
+         * dataMalloc() or shape change. By default it calls compute().
+         */
+        virtual KernelLaunch prepare(const Operator &op,
+                                     const RuntimeObj *context) const
+        {
+            return [this, op, context] { compute(op, context); };
+        }
     };
 
     class KernelRegistry
@@ -63,6 +81,12 @@ namespace infini
         {
             return kernels.at(kernelAttrs);
         }
+        // The record for `kernelAttrs`, or nullptr if none is registered.
+        const KernelRecord *findKernelItem(const KernelAttrs &kernelAttrs) const
+        {
+            auto it = kernels.find(kernelAttrs);
+            return it == kernels.end() ? nullptr : &it->second;
+        }
     };
 
     class CpuKernelWithoutConfig : public Kernel
@@ -0,0 +1,41 @@
+#pragma once
+#include "core/graph.h"
+
+namespace infini
+{
+    /**
+     * @brief A graph imported from an ONNX model, with its named inputs and
+     * outputs in model order. Inputs no node reads are left out.
+     */
+    struct OnnxModel
+    {
+        Graph graph;
+        vector<pair<string, Tensor>> inputs, outputs;
+    };
+
+    /**
+     * @brief Counts the nodes of the model at `path` that importOnnx() has no
+     * operator for, by op type ("domain:op_type" outside the default
+     * domain). Empty when the whole model can be imported.
+     */
+    map<string, int> unsupportedOnnxOps(const string &path);
+
+    /**
+     * @brief Builds a graph from the ONNX model at `path` without a protobuf
+     * dependency. MatMul, Gemm (alpha = beta = 1), Add, Sub, Mul, Div, Relu,
+     * Clip, Cast, Concat and Transpose map to operators; Identity and Cast to
+     * the same type forward their input; Constant nodes and initializers
+     * become weights.
+     *
+     * The file is mapped into memory, and raw or float payloads aligned to
+     * their element size are bound in place; the others are copied. The
+     * weights keep the mapping alive and dataMalloc() leaves them there.
+     * Symbolic input dims take their values from `dimValues`.
+     *
+     * Throws if the model has unsupported operators, listing them with their
+     * counts.
+     */
+    OnnxModel importOnnx(Runtime runtime, const string &path,
+                         const map<string, int> &dimValues = {});
+
+} // namespace infini
@@ -24,6 +24,7 @@ namespace infini
             Relu,
             Sub,
             Transpose,
+            FusedElementWise,
 
         } type;
 
@@ -0,0 +1,54 @@
+#pragma once
+#include "core/kernel.h"
+#include "core/operator.h"
+
+namespace infini
+{
+    /**
+     * @brief A graph compiled for repeated execution by
+     * RuntimeObj::run(const ExecutionPlan &).
+     *
+     * One instruction per operator, in topological order. Every instruction
+     * carries the launch its kernel prepared, so running the plan performs
+     * no kernel lookups, casts or shape computations and touches no Refs.
+     * The launches point into the graph's memory: the plan is valid while
+     * the graph lives and until its next dataMalloc() or shape change.
+     */
+    class ExecutionPlanObj : public Object
+    {
+    public:
+        struct Instruction
+        {
+            KernelLaunch launch;
+            Kernel *kernel;
+            // only for diagnostics
+            const OperatorObj *op;
+            // instructions ordered after this one by data or reused memory
+            vector<size_t> successors;
+            // instructions this one waits for
+            int numPredecessors = 0;
+        };
+
+        /**
+         * @param successors Need not be sorted or unique; predecessor counts
+         * are derived from them.
+         */
+        ExecutionPlanObj(const RuntimeObj *runtime, OpVec ops,
+                         vector<Instruction> instructions);
+
+        const RuntimeObj *getRuntime() const { return runtime; }
+        size_t size() const { return instructions.size(); }
+        const vector<Instruction> &getInstructions() const
+        {
+            return instructions;
+        }
+        string toString() const override;
+
+    private:
+        const RuntimeObj *runtime;
+        // keeps the operators the instructions refer to alive
+        OpVec ops;
+        vector<Instruction> instructions;
+    };
+
+} // namespace infini
@@ -0,0 +1,105 @@
+#pragma once
+#include "core/graph.h"
+#include <mutex>
+
+namespace infini
+{
+    /**
+     * @brief A 64-bit hash of the structure of `graph`: operator types and
+     * attributes, the shape, data type and weight flag of every tensor and
+     * which tensors connect which operators. Tensor data, fuids and object
+     * addresses do not enter it, so graphs built by the same sequence of
+     * calls hash equally in any process.
+     */
+    uint64_t hashGraph(const Graph &graph);
+
+    /**
+     * @brief Process-wide cache of compiled graphs, keyed by their
+     * structure. An entry holds what optimize(), shape_infer() and
+     * dataMalloc() produced for a graph: the operators in planned order, the
+     * final shapes, the offset of every tensor in the memory arena, the
+     * memory dependencies, and the name of the kernel each operator resolved
+     * to.
+     *
+     * Entries are only valid for the runtime configuration they were built
+     * under (device, and whether operators run concurrently), which is part
+     * of the key. So is a digest of the constants optimize() folds
+     * operators over, and an entry carries the folded results.
+     */
+    class PlanCache
+    {
+    public:
+        static PlanCache &getInstance();
+
+        /**
+         * @brief Does what optimize(), shape_infer() and dataMalloc() would
+         * on a freshly built `graph`. On a hit the cached plan is applied
+         * without running them: the graph's tensors are kept (so references
+         * to its inputs and outputs stay valid), its operators are replaced
+         * by the planned ones and the arena is bound in one allocation. On a
+         * miss the passes run and their result is cached. Returns whether it
+         * was a hit.
+         */
+        bool prepare(const Graph &graph);
+
+        /**
+         * @brief Writes every entry to `path`. Files are tied to the layout
+         * of this build (format version, kernel names).
+         */
+        void save(const string &path) const;
+
+        /**
+         * @brief Adds the entries of a file written by save(), keeping the
+         * current entry on a key conflict. Entries whose operators resolve
+         * to other kernels in this process are dropped. Returns the number
+         * of entries added.
+         */
+        size_t load(const string &path);
+
+        size_t size() const;
+        void clear();
+
+    private:
+        struct TensorPlan
+        {
+            int32_t canonical; // id in the canonical form, -1 if created
+            Shape dims;
+            int32_t dtype;
+            int64_t arenaOffset; // -1 if unallocated, external or a view
+            // for a view, the index of the tensor whose data it reads
+            int32_t base;
+            uint64_t offset;
+            vector<int64_t> strides;
+            // the data of a constant optimize() computed, empty otherwise
+            string data;
+        };
+        struct OpPlan
+        {
+            uint16_t type;
+            string attributes;
+            vector<uint32_t> inputs, outputs; // indices into tensors
+            string kernel;
+        };
+        struct CachedPlan
+        {
+            string key;
+            vector<TensorPlan> tensors;
+            vector<OpPlan> ops;
+            vector<pair<uint32_t, uint32_t>> memoryDeps; // op, dependency
+            uint64_t arenaBytes;
+        };
+
+        PlanCache() = default;
+        // `given` are the constants of the graph before optimize()
+        static Ref<CachedPlan>
+        record(GraphObj &g, string key, const TensorVec &canonical,
+               const std::unordered_set<const TensorObj *> &given);
+        static void apply(GraphObj &g, const CachedPlan &plan,
+                          const TensorVec &canonical);
+        static bool resolves(const CachedPlan &plan);
+
+        mutable std::mutex mutex;
+        std::unordered_map<uint64_t, Ref<const CachedPlan>> entries;
+    };
+
+} // namespace infini
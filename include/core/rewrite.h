@@ -0,0 +1,74 @@
+#pragma once
+#include "core/graph.h"
+#include <functional>
+
+namespace infini
+{
+    /**
+     * @brief A tree of operators to look for, rooted at the operator whose
+     * output the match computes. A node names an operator type, optionally
+     * a predicate over the operator (usually on its attributes), and for
+     * some of its inputs the pattern their producer must match; the other
+     * inputs may come from anywhere.
+     *
+     *   // Transpose(Transpose(x)), both swapping the last two axes
+     *   Pattern(OpType::Transpose, swapsLastTwo)
+     *       .input(0, Pattern(OpType::Transpose, swapsLastTwo))
+     */
+    struct Pattern
+    {
+        using Predicate = std::function<bool(const Operator &)>;
+
+        OpType type;
+        Predicate when;
+        vector<pair<int, Pattern>> producers;
+
+        explicit Pattern(OpType type, Predicate when = nullptr)
+            : type(type), when(std::move(when)) {}
+
+        // Requires input `index` to be produced by an operator matching
+        // `producer`.
+        Pattern &input(int index, Pattern producer);
+
+        /**
+         * @brief Whether `op` matches. On success the matched operators are
+         * appended to `matched`, the root first and then the producers depth
+         * first in the order they were declared, so that every operator
+         * comes before the ones producing its inputs.
+         */
+        bool match(const Operator &op, OpVec &matched) const;
+    };
+
+    /**
+     * @brief The replacement for a match, applied by
+     * GraphObj::replaceSubgraph(): the operators to add, created with
+     * nullptr as their graph over tensors of the graph (typically writing
+     * the outputs of matched operators), and the tensors whose readers read
+     * another tensor instead.
+     */
+    struct Rewrite
+    {
+        OpVec add;
+        vector<pair<Tensor, Tensor>> replace;
+    };
+
+    struct RewriteRule
+    {
+        string name;
+        Pattern pattern;
+        // The rewrite of a match, ordered as Pattern::match() orders it, or
+        // nullopt to leave the match as it is.
+        std::function<optional<Rewrite>(GraphObj &, const OpVec &)> rewrite;
+    };
+
+    /**
+     * @brief Applies `rules` until none of them changes the graph. Every
+     * operator is tried once in topological order; after a rewrite only the
+     * operators around the change are tried again, so the cost follows the
+     * number of rewrites rather than the size of the graph. Rules are tried
+     * in order and must not undo each other. Returns the number of rewrites
+     * applied.
+     */
+    size_t applyRewrites(GraphObj &graph, const vector<RewriteRule> &rules);
+
+} // namespace infini
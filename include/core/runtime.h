@@ -10,12 +10,16 @@ namespace infini
   class GraphObj;
   class RuntimeObj;
   class BlobObj;
+  class ThreadPool;
+  class Profiler;
+  class ExecutionPlanObj;
 
   using Tensor = Ref<TensorObj>;
   using Operator = Ref<OperatorObj>;
   using Graph = Ref<GraphObj>;
   using Runtime = Ref<RuntimeObj>;
   using Blob = Ref<BlobObj>;
+  using ExecutionPlan = Ref<ExecutionPlanObj>;
 
   using TensorVec = vector<Tensor>;
   using OpVec = vector<Operator>;
@@ -37,7 +41,10 @@ namespace infini
     RuntimeObj &operator=(RuntimeObj const &) = delete;
     virtual ~RuntimeObj() {}
 
+    // Runs graph->getPlan(), compiling the graph on its first run.
     virtual void run(const Graph &graph) const = 0;
+    // Runs a plan made by GraphObj::compile() for this runtime.
+    virtual void run(const ExecutionPlan &plan) const = 0;
     virtual void *alloc(size_t size) = 0;
     virtual void dealloc(void *ptr) = 0;
 
@@ -46,13 +53,19 @@ namespace infini
       return true;
     }
 
+    Device getDevice() const { return device; }
+
     virtual string toString() const = 0;
+
+    // Operators the runtime may execute at the same time.
+    virtual int getInterOpThreads() const { return 1; }
   };
 
   class NativeCpuRuntimeObj : public RuntimeObj
   {
   public:
-    NativeCpuRuntimeObj() : RuntimeObj(Device::CPU) {}
+    NativeCpuRuntimeObj();
+    ~NativeCpuRuntimeObj() override;
 
     static Ref<NativeCpuRuntimeObj> &getInstance()
     {
@@ -62,8 +75,42 @@ namespace infini
     }
     void dealloc(void *ptr) override;
     void run(const Graph &graph) const override;
+    void run(const ExecutionPlan &plan) const override;
     void *alloc(size_t size) override;
     string toString() const override;
+
+    /**
+     * @brief Number of operators run() may execute at the same time.
+     *
+     * With 1 (the default) operators run one after another in topological
+     * order. With more, run() starts every operator as soon as its
+     * predecessors and the operators it shares memory with have finished,
+     * on a work-stealing pool of this many threads, and gives each operator
+     * an equal share of the OpenMP threads of the calling thread, so that
+     * the operators running at once never oversubscribe them.
+     * The environment variable INFINI_INTER_OP_THREADS sets the initial
+     * value.
+     */
+    void setInterOpThreads(int threads);
+    int getInterOpThreads() const override { return interOpThreads; }
+
+    /**
+     * @brief Records every operator run() executes from now on, see
+     * Profiler. Off by default; setting the environment variable
+     * INFINI_PROFILE to a file name turns it on and writes a Chrome trace
+     * there and a summary to stdout when the runtime is destroyed.
+     */
+    void setProfiling(bool enable);
+    // The records of the runs so far, or nullptr if profiling is off.
+    Profiler *getProfiler() const { return profiler.get(); }
+
+  private:
+    int interOpThreads = 1;
+    std::unique_ptr<ThreadPool> pool;
+    std::unique_ptr<Profiler> profiler;
+    string profilePath;
+
+    void runParallel(const ExecutionPlanObj &plan) const;
   };
 
 } // namespace infini
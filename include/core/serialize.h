@@ -0,0 +1,61 @@
+#pragma once
+#include "core/graph.h"
+#include "utils/byte_stream.h"
+
+namespace infini
+{
+    /**
+     * @brief Binary graph format, version 1. All fields are little-endian;
+     * u8/u16/u32/u64/i32/f32 name their widths and an optional float is a u8
+     * flag followed by an f32.
+     *
+     *   header   "ITGRAPH\0", u32 version, u32 reserved,
+     *            u64 weightOffset, u64 weightBytes
+     *   tensors  u32 count, then per tensor: i32 fuid, i32 dtype, u32 rank,
+     *            i32 dims[rank], u8 isWeight and, for weights, u64 offset
+     *            from weightOffset
+     *   ops      u32 count in topological order, then per op: u16 type,
+     *            u32 nIn, u32 inputs[nIn], u32 nOut, u32 outputs[nOut] (tensor
+     *            indices) and the attributes of its type
+     *   weights  every payload at a 64-byte aligned file offset
+     *
+     * Attributes: Transpose u32 rank, i32 permute[rank]; MatMul u8 transA,
+     * u8 transB, u8 activation, clip min, clip max; Clip min, max; Cast i32
+     * cast type; Concat i32 dim; FusedElementWise u32 count, then per step
+     * u16 type, i32 operand, u8 reversed, min, max.
+     *
+     * Fuids are per process: they are saved for reference, and loaded tensors
+     * get fresh ones.
+     */
+    constexpr uint32_t GRAPH_FILE_VERSION = 1;
+
+    /**
+     * @brief Writes the graph to `path`, with the data of its weights
+     * (tensors marked with setWeight(), which must hold data).
+     */
+    void saveGraph(const Graph &graph, const string &path);
+
+    /**
+     * @brief Reads a graph written by saveGraph(). The file is mapped into
+     * memory and the weights are bound to the mapping without a copy; the
+     * mapping lives as long as any of their blobs, and dataMalloc() leaves
+     * them in place. The mapping is private: writing a weight changes only
+     * this process's copy of the page.
+     */
+    Graph loadGraph(Runtime runtime, const string &path);
+
+    /**
+     * @brief Appends the attributes of `op` in the layout above. Two
+     * operators of one type encode to the same bytes exactly when they
+     * compute the same function of their inputs.
+     */
+    void encodeAttributes(const Operator &op, ByteWriter &w);
+
+    /**
+     * @brief Reads attributes written by encodeAttributes() for an operator
+     * of `type` and adds that operator to `g` with the given tensors.
+     */
+    Operator decodeOperator(ByteReader &r, GraphObj &g, OpType type,
+                            const TensorVec &in, const TensorVec &out);
+
+} // namespace infini
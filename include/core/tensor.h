@@ -27,6 +27,13 @@ namespace infini
 
     private:
         Shape shape;
+        // Element strides of a view, empty for a dense row-major tensor.
+        vector<int64_t> strides;
+        // Bytes from the start of the blob to the first element.
+        size_t offset = 0;
+        // Constant data of the model (weights, biases) rather than an input
+        // fed on every run.
+        bool weight = false;
         size_t _size; // Cache of Π(shape).
         Fuid fuid;    // Cloned tensors share the same id. Tensors constructed from
                       // scratch have a new id.
@@ -48,6 +55,39 @@ namespace infini
             std::function<void(void *, size_t, DataType)> const &generator) const;
 
         void setDataBlob(const Blob &blob);
+        Blob getDataBlob() const { return data; }
+        bool hasData() const { return data != nullptr; }
+        // Whether the data lives outside the graph's arena, e.g. in a mapping.
+        bool hasExternalData() const { return data && data->isExternal(); }
+
+        /**
+         * @brief Makes the tensor a view into `blob`: element i0, i1, ...
+         * lives `offset` bytes plus Σ(ik * strides[k]) elements from its start.
+         */
+        void setView(const Blob &blob, vector<int64_t> strides,
+                     size_t offset = 0);
+
+        // Element strides, the row-major ones for a dense tensor.
+        vector<int64_t> getStrides() const;
+        // Whether the elements are laid out densely in row-major order.
+        bool isContiguous() const;
+        size_t getOffset() const { return offset; }
+
+        bool isWeight() const { return weight; }
+        void setWeight(bool weight_ = true) { weight = weight_; }
+
+        /**
+         * @brief Makes the tensor a constant: a weight with memory of its own
+         * outside the graph's arena, filled by `generator` if given. Unlike
+         * the other weights its data is known before dataMalloc() and kept
+         * by it, so GraphObj::optimize() can fold what depends only on it.
+         */
+        void setConstant(
+            std::function<void(void *, size_t, DataType)> const &generator =
+                nullptr);
+        // A weight whose data outlives dataMalloc(): set by setConstant() or
+        // loaded from a file.
+        bool isConstant() const { return weight && hasExternalData(); }
 
         void printData() const;
         bool equalData(const Tensor &rhs, double relativeError = 1e-6) const;
@@ -66,13 +106,14 @@ namespace infini
             static_assert(std::is_pointer_v<T>,
                           "Raw data pointer has a type of pointer");
             IT_ASSERT(data != nullptr);
-            return data->getPtr<T>();
+            return reinterpret_cast<T>(data->getPtr<uint8_t *>() + offset);
         }
 
         DataType getDType() const { return dtype; }
         Runtime getRuntime() const { return runtime; }
 
         OpVec getTargets() const { return wrefs_to_refs(targets); }
+        bool hasTargets() const { return !targets.empty(); }
         Operator getSource() const { return source.lock(); }
 
     private:
@@ -84,7 +125,7 @@ namespace infini
 
             auto numDims = shape.size();
             auto dimSzVec = vector<int>(numDims, 1);
-            auto ptr = data->getPtr<T *>();
+            auto ptr = getRawDataPtr<T *>();
             dimSzVec[numDims - 1] = shape[numDims - 1];
 
             for (int i = numDims - 1; i != 0; --i)
@@ -0,0 +1,36 @@
+#pragma once
+#include "core/data_type.h"
+#include "core/op_type.h"
+#include "utils/cpu_isa.h"
+
+namespace infini
+{
+    /**
+     * @brief Operand layout of a contiguous binary segment.
+     */
+    enum class BinaryPattern
+    {
+        VV, // c[i] = a[i] op b[i]
+        VS, // c[i] = a[i] op b[0]
+        SV, // c[i] = a[0] op b[i]
+    };
+
+    /**
+     * @brief c[0, n) = a op b for one contiguous segment. `c` may alias a
+     * vector operand.
+     */
+    using BinarySegmentFn = void (*)(const void *a, const void *b, void *c,
+                                     int64_t n);
+
+    /**
+     * @brief Vectorized segment kernel of Add/Sub/Mul/Div for Float32 or
+     * UInt32, or nullptr if there is none.
+     *
+     * @param isa Instruction set to use, the one detected at startup by
+     * default. Levels above the machine's are clamped.
+     */
+    BinarySegmentFn getBinarySimdKernel(OpType op, DataType dtype,
+                                        BinaryPattern pattern,
+                                        CpuIsa isa = getCpuIsa());
+
+} // namespace infini
@@ -0,0 +1,29 @@
+#pragma once
+#include "operators/unary.h"
+#include "utils/cpu_isa.h"
+
+namespace infini
+{
+    /**
+     * @brief y[0, n) = cast(x[0, n)) for one contiguous range.
+     */
+    using CastFn = void (*)(const void *x, void *y, int64_t n);
+
+    /**
+     * @brief Vectorized kernel of a cast, specialized for its (source,
+     * destination) pair. Float16 and BFloat16 round to nearest even, the
+     * other casts follow C++ conversions.
+     *
+     * @param isa Instruction set to use, the one detected at startup by
+     * default. Levels above the machine's are clamped; Float16 needs F16C
+     * besides AVX2 and otherwise falls back to the scalar conversion.
+     */
+    CastFn getCastKernel(CastType type, CpuIsa isa = getCpuIsa());
+
+    // Scalar conversions with round to nearest even, NaN stays NaN.
+    uint16_t floatToHalf(float x);
+    float halfToFloat(uint16_t x);
+    uint16_t floatToBFloat16(float x);
+    float bfloat16ToFloat(uint16_t x);
+
+} // namespace infini
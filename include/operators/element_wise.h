@@ -44,4 +44,51 @@ namespace infini
   DEFINE_ELEMENT_WISE_OBJ(Sub, OpType::Sub)
   DEFINE_ELEMENT_WISE_OBJ(Mul, OpType::Mul)
   DEFINE_ELEMENT_WISE_OBJ(Div, OpType::Div)
+
+  /**
+   * @brief One operator of a chain folded into a FusedElementWiseObj. It
+   * maps the running value v to a new one.
+   */
+  struct FusedStep
+  {
+    // Add, Sub, Mul, Div, Relu or Clip
+    OpType type;
+    // binary steps: index of the other operand among the fused inputs
+    int operand = -1;
+    // binary steps: v is the second operand, i.e. v = operand op v
+    bool reversed = false;
+    // Clip bounds
+    std::optional<float> min, max;
+  };
+
+  /**
+   * @brief A chain of element-wise operators (binary element-wise, unary
+   * and Clip ops) evaluated in one pass. The running value starts as input
+   * 0 and goes through the steps in order; all inputs broadcast to the
+   * output shape.
+   */
+  class FusedElementWiseObj : public OperatorObj
+  {
+  public:
+    /**
+     * @brief Construct a new FusedElementWise object.
+     *
+     * @param graph The computation graph that this operator belongs to.
+     * @param inputs The running value first, then the other operands.
+     * @param output The output tensor.
+     * @param steps The operators of the chain, in evaluation order.
+     */
+    FusedElementWiseObj(GraphObj *graph, TensorVec inputs, Tensor output,
+                        vector<FusedStep> steps);
+    OP_CLONE(FusedElementWiseObj);
+    optional<vector<Shape>> inferShape(const TensorVec &inputs) override;
+
+    std::string toString() const override;
+    const vector<FusedStep> &getSteps() const { return steps; }
+    int numInputs() const override { return inputs.size(); }
+    int numOutputs() const override { return 1; }
+
+  private:
+    vector<FusedStep> steps;
+  };
 }; // namespace infini
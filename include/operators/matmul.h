@@ -3,6 +3,16 @@
 
 namespace infini
 {
+    /**
+     * @brief Activation applied by a MatMul to its output.
+     */
+    enum class MatmulActivation
+    {
+        None,
+        Relu,
+        Clip,
+    };
+
     /**
      * @brief Matrix multiplication.
      *
@@ -15,6 +25,10 @@ namespace infini
         // oppsite to the column-major BLAS.
         bool transA, transB;
 
+        // Epilogue: C = act(A * B + bias), bias being the optional third input.
+        MatmulActivation act;
+        std::optional<float> clipMin, clipMax;
+
         // Auxiliary attributes which are not a part of operator attributes.
         int m, n, k;
 
@@ -37,9 +51,18 @@ namespace infini
          * the constructor, C should be an empty Ref.
          * @param transA If matrix A should be transposed when computing.
          * @param transB If matrix B should be transposed when computing.
+         * @param bias Optional, added to every row of the product. All its
+         * dims but the last are 1 and the last is n.
+         * @param act Activation applied after the bias.
+         * @param clipMin Lower bound of a Clip activation.
+         * @param clipMax Upper bound of a Clip activation.
          */
         MatmulObj(GraphObj *graph, Tensor A, Tensor B, Tensor C,
-                  bool transA = false, bool transB = false);
+                  bool transA = false, bool transB = false,
+                  Tensor bias = nullptr,
+                  MatmulActivation act = MatmulActivation::None,
+                  std::optional<float> clipMin = {},
+                  std::optional<float> clipMax = {});
         OP_CLONE(MatmulObj);
 
         std::string toString() const override;
@@ -52,6 +75,13 @@ namespace infini
         bool getTransB() const { return transB; }
         void setTransA(bool transA) { this->transA = transA; }
         void setTransB(bool transB) { this->transB = transB; }
+        Tensor getBias() const
+        {
+            return inputs.size() > 2 ? inputs[2] : nullptr;
+        }
+        MatmulActivation getActivation() const { return act; }
+        std::optional<float> getClipMin() const { return clipMin; }
+        std::optional<float> getClipMax() const { return clipMax; }
         int getM() const { return m; }
         int getN() const { return n; }
         int getK() const { return k; }
@@ -84,6 +84,10 @@ namespace infini
     std::string toString() const override;
     CastType getType() const { return castType; }
     DataType getOutputDataType() const;
+    DataType getInputDataType() const;
+    // the data types a cast of this type converts between
+    static DataType getOutputDataType(CastType type);
+    static DataType getInputDataType(CastType type);
     int numInputs() const override { return 1; }
     int numOutputs() const override { return 1; }
 
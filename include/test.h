@@ -1,4 +1,45 @@
 #pragma once
 #include "core/common.h"
+#include "core/graph.h"
+#include "core/runtime.h"
 #include "utils/data_generator.h"
 #include "gtest/gtest.h"
+
+namespace infini
+{
+    /**
+     * @brief Builds a graph twice with `build`, which adds operators to an
+     * empty graph and returns the tensors to compare, optimizes the second
+     * copy, runs both on the CPU with every non-constant input filled by
+     * `generator` and expects the same results.
+     *
+     * The optimized copy is built last, so the tensors `build` stores in
+     * captured variables belong to it; it is returned for the structural
+     * checks of the caller.
+     */
+    template <typename Build>
+    Graph expectOptimizeKeepsResults(
+        Build &&build,
+        std::function<void(void *, size_t, DataType)> const &generator =
+            IncrementalGenerator())
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph ref = make_ref<GraphObj>(runtime);
+        Graph g = make_ref<GraphObj>(runtime);
+        TensorVec expected = build(ref);
+        TensorVec results = build(g);
+        g->optimize();
+        for (auto graph : {ref, g})
+        {
+            graph->dataMalloc();
+            for (auto &input : graph->getInputs())
+                if (!input->isConstant())
+                    input->setData(generator);
+            runtime->run(graph);
+        }
+        EXPECT_EQ(results.size(), expected.size());
+        for (size_t i = 0; i < std::min(results.size(), expected.size()); ++i)
+            EXPECT_TRUE(results[i]->equalData(expected[i])) << "result " << i;
+        return g;
+    }
+} // namespace infini
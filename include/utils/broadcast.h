@@ -0,0 +1,147 @@
+#pragma once
+#include "core/common.h"
+#include "core/tensor.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace infini
+{
+    /**
+     * @brief Iteration plan of an elementwise computation whose operands are
+     * broadcast to a common output shape.
+     *
+     * Operand dims are right-aligned to the output, every operand gets an
+     * element stride per output dim (0 where it is broadcast) and adjacent
+     * dims that are laid out contiguously for all operands are collapsed. The
+     * output is then walked row by row: a row is the innermost collapsed dim,
+     * along which every operand is either contiguous (stride 1), a scalar
+     * (stride 0) or strided.
+     */
+    class BroadcastPlan
+    {
+    public:
+        /**
+         * @brief Plan over dense operands.
+         *
+         * @param output Output shape.
+         * @param inputs Operand shapes, each broadcastable to `output`.
+         */
+        BroadcastPlan(const Shape &output, const vector<Shape> &inputs);
+
+        /**
+         * @brief Plan over operands with explicit element strides, aligned to
+         * their own shapes.
+         */
+        BroadcastPlan(const Shape &output, const vector<Shape> &inputs,
+                      const vector<vector<int64_t>> &inputStrides);
+
+        size_t numInputs() const { return strides.size(); }
+        size_t numRows() const { return rows; }
+        int64_t rowLength() const { return shape.back(); }
+        int64_t innerStride(size_t input) const { return strides[input].back(); }
+        // Collapsed output dims, at least one of them.
+        const Shape &getShape() const { return shape; }
+        const vector<int64_t> &getStrides(size_t input) const
+        {
+            return strides[input];
+        }
+
+        /**
+         * @brief Offset of the first element of `row` in every operand.
+         */
+        void rowOffsets(size_t row, int64_t *offsets) const;
+
+        /**
+         * @brief Calls f(outOffset, inOffsets, length) for every contiguous
+         * output segment, in parallel over rows. Rows are split further when
+         * there are fewer rows than threads. Offsets are in elements; along a
+         * segment operand i advances by innerStride(i).
+         */
+        template <typename F>
+        void forEachSegment(F &&f, int64_t grain = 16384) const;
+
+    private:
+        Shape shape;
+        vector<vector<int64_t>> strides;
+        size_t rows;
+
+        void build(const Shape &output, const vector<Shape> &inputs,
+                   const vector<vector<int64_t>> &inputStrides);
+    };
+
+    /**
+     * @brief Copies the `shape`-shaped elements of `src` to `dst`, both
+     * addressed with element strides, in parallel. Elements are `elemSize`
+     * bytes; runs contiguous on both sides are copied with memcpy.
+     */
+    void copyStrided(void *dst, const vector<int64_t> &dstStrides,
+                     const void *src, const vector<int64_t> &srcStrides,
+                     const Shape &shape, size_t elemSize);
+
+    template <typename F>
+    void BroadcastPlan::forEachSegment(F &&f, int64_t grain) const
+    {
+        const int64_t len = rowLength();
+        const size_t nIn = numInputs();
+        int threads = 1;
+#ifdef _OPENMP
+        threads = omp_get_max_threads();
+#endif
+        int64_t total = (int64_t)rows * len;
+        int64_t chunks = (int64_t)rows < threads ? (len + grain - 1) / grain : 1;
+        chunks = std::max<int64_t>(chunks, 1);
+        int64_t units = (int64_t)rows * chunks;
+        int64_t chunkLen = (len + chunks - 1) / chunks;
+
+#pragma omp parallel if (total > grain && units > 1)
+        {
+            int64_t begin = 0, end = units;
+#ifdef _OPENMP
+            int nth = omp_get_num_threads(), tid = omp_get_thread_num();
+            begin = units * tid / nth;
+            end = units * (tid + 1) / nth;
+#endif
+            vector<int64_t> offsets(nIn), cur(nIn);
+            vector<int64_t> index(shape.size(), 0);
+            size_t row = begin / chunks;
+            if (begin < end)
+            {
+                rowOffsets(row, offsets.data());
+                size_t rest = row;
+                for (int d = (int)shape.size() - 2; d >= 0; --d)
+                {
+                    index[d] = rest % shape[d];
+                    rest /= shape[d];
+                }
+            }
+            for (int64_t u = begin; u < end; ++u)
+            {
+                size_t r = u / chunks;
+                if (r != row)
+                {
+                    // advance the outer index by one row
+                    row = r;
+                    for (int d = (int)shape.size() - 2; d >= 0; --d)
+                    {
+                        for (size_t i = 0; i < nIn; ++i)
+                            offsets[i] += strides[i][d];
+                        if (++index[d] < shape[d])
+                            break;
+                        for (size_t i = 0; i < nIn; ++i)
+                            offsets[i] -= strides[i][d] * shape[d];
+                        index[d] = 0;
+                    }
+                }
+                int64_t col = u % chunks * chunkLen;
+                int64_t n = std::min(chunkLen, len - col);
+                if (n <= 0)
+                    continue;
+                for (size_t i = 0; i < nIn; ++i)
+                    cur[i] = offsets[i] + col * strides[i].back();
+                f((int64_t)row * len + col, (const int64_t *)cur.data(), n);
+            }
+        }
+    }
+
+} // namespace infini
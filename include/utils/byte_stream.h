@@ -0,0 +1,94 @@
+#pragma once
+#include "core/common.h"
+#include <cstring>
+
+namespace infini
+{
+    /**
+     * @brief Appends fixed-width values in host (little-endian) byte order,
+     * for the binary files of graphs and plan caches.
+     */
+    class ByteWriter
+    {
+    public:
+        string buf;
+
+        template <typename T>
+        void put(T value)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            buf.append(reinterpret_cast<const char *>(&value), sizeof(T));
+        }
+
+        template <typename T>
+        void patch(size_t pos, T value)
+        {
+            std::memcpy(buf.data() + pos, &value, sizeof(T));
+        }
+
+        void putOptional(std::optional<float> value)
+        {
+            put<uint8_t>(value.has_value());
+            put<float>(value.value_or(0.f));
+        }
+
+        void putString(const string &s)
+        {
+            put<uint64_t>(s.size());
+            buf += s;
+        }
+    };
+
+    /**
+     * @brief Reads what a ByteWriter wrote, checking every read against the
+     * end of the data; `what` names the data in error messages.
+     */
+    class ByteReader
+    {
+    public:
+        ByteReader(const char *data, size_t size, string what)
+            : data(data), size(size), what(std::move(what)) {}
+
+        template <typename T>
+        T get()
+        {
+            IT_ASSERT(pos + sizeof(T) <= size, "Truncated " + what);
+            T value;
+            std::memcpy(&value, data + pos, sizeof(T));
+            pos += sizeof(T);
+            return value;
+        }
+
+        std::optional<float> getOptional()
+        {
+            bool has = get<uint8_t>();
+            float value = get<float>();
+            return has ? std::optional<float>(value) : std::nullopt;
+        }
+
+        string getString()
+        {
+            auto n = get<uint64_t>();
+            IT_ASSERT(n <= size - pos, "Truncated " + what);
+            string s(data + pos, n);
+            pos += n;
+            return s;
+        }
+
+        // a count of items of at least `itemBytes` each that must still fit
+        uint32_t getCount(size_t itemBytes)
+        {
+            auto n = get<uint32_t>();
+            IT_ASSERT(n * itemBytes <= size - pos, "Truncated " + what);
+            return n;
+        }
+
+        bool atEnd() const { return pos == size; }
+
+    private:
+        const char *data;
+        size_t size, pos = 0;
+        string what;
+    };
+
+} // namespace infini
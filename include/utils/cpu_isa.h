@@ -0,0 +1,43 @@
+#pragma once
+#include "core/common.h"
+
+namespace infini
+{
+    /**
+     * @brief Vector instruction set levels the CPU kernels are specialized
+     * for. Each level implies the previous ones.
+     */
+    enum class CpuIsa
+    {
+        Scalar = 0, // baseline of the build, SSE2 on x86-64
+        AVX2,       // AVX2 + FMA
+        AVX512,     // AVX-512 F/BW/DQ/VL
+    };
+
+    struct CpuFeatures
+    {
+        bool avx2 = false;
+        bool fma = false;
+        bool f16c = false;
+        bool avx512f = false;
+        bool avx512bw = false;
+        bool avx512dq = false;
+        bool avx512vl = false;
+    };
+
+    /**
+     * @brief Features reported by CPUID and enabled by the OS (XGETBV),
+     * detected once per process.
+     */
+    const CpuFeatures &getCpuFeatures();
+
+    /**
+     * @brief The best instruction set level of this machine, detected once.
+     * The environment variable INFINI_CPU_ISA=scalar|avx2|avx512 caps it,
+     * which is useful to exercise the fallbacks.
+     */
+    CpuIsa getCpuIsa();
+
+    const char *cpuIsaToString(CpuIsa isa);
+
+} // namespace infini
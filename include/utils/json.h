@@ -0,0 +1,13 @@
+#pragma once
+#include "core/common.h"
+
+namespace infini
+{
+    /**
+     * @brief `s` escaped for use between the quotes of a JSON string:
+     * quotes and backslashes get a backslash, control characters become
+     * \uXXXX.
+     */
+    string jsonEscape(const string &s);
+
+} // namespace infini
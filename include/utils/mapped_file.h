@@ -0,0 +1,22 @@
+#pragma once
+#include "core/common.h"
+#include "core/ref.h"
+
+namespace infini
+{
+    /**
+     * @brief A whole file mapped into memory. The mapping is private and
+     * writable: writes go to this process's copy of a page, never to the
+     * file. It is unmapped when the last copy of `mapping` goes away, so
+     * blobs pointing into it hold a reference.
+     */
+    struct MappedFile
+    {
+        Ref<void> mapping;
+        char *data = nullptr;
+        size_t size = 0;
+    };
+
+    MappedFile mapFile(const string &path);
+
+} // namespace infini
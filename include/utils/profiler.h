@@ -0,0 +1,68 @@
+#pragma once
+#include "core/operator.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+namespace infini
+{
+    /**
+     * @brief One execution of an operator.
+     */
+    struct OpProfile
+    {
+        OpType type;
+        UidBaseType guid;
+        string kernel;
+        // nanoseconds since the profiler was created or cleared
+        int64_t begin, end;
+        // 0 on the calling thread, 1 + worker index on the inter-op pool
+        int thread;
+        size_t inputBytes, outputBytes;
+        double flops;
+    };
+
+    /**
+     * @brief Collects per-operator timings of a runtime. Thread-safe; the
+     * runtime only calls it while profiling is enabled.
+     */
+    class Profiler
+    {
+    public:
+        explicit Profiler(Device device);
+
+        // Nanoseconds on the profiler's clock.
+        int64_t now() const;
+        // Records `op`, which ran from `begin` to `end` on `thread`.
+        void record(const OperatorObj &op, int64_t begin, int64_t end,
+                    int thread);
+
+        vector<OpProfile> getRecords() const;
+        void clear();
+
+        /**
+         * @brief Writes the records as Chrome trace events, for
+         * chrome://tracing or ui.perfetto.dev. Returns false if the file
+         * cannot be written.
+         */
+        bool writeChromeTrace(const string &path) const;
+
+        /**
+         * @brief Per-OpType table of calls, total and mean time, share of
+         * the total, GFLOP/s and GB/s, the most expensive type first.
+         */
+        string summary() const;
+
+        // Analytic floating point (or integer) operations of `op`.
+        static double countFlops(const OperatorObj &op);
+
+    private:
+        Device device;
+        // steady_clock ticks of the start, atomic as clear() may run while
+        // executor threads read it in now()
+        std::atomic<std::chrono::steady_clock::rep> epoch;
+        mutable std::mutex mutex;
+        vector<OpProfile> records;
+    };
+
+} // namespace infini
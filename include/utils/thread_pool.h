@@ -0,0 +1,64 @@
+#pragma once
+#include "core/common.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace infini
+{
+    /**
+     * @brief A fixed set of worker threads with one task deque each.
+     *
+     * A worker pushes the tasks it submits onto its own deque and pops them
+     * LIFO, which keeps producer and consumer on the same core; an idle
+     * worker steals the oldest task of another deque. Tasks submitted from
+     * outside the pool are dealt round-robin. Workers with nothing to do
+     * sleep until the next submit.
+     */
+    class ThreadPool
+    {
+    public:
+        using Task = std::function<void()>;
+
+        explicit ThreadPool(int threads);
+        ~ThreadPool();
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        int size() const { return (int)workers.size(); }
+
+        // Thread-safe, may be called from a task.
+        void submit(Task task);
+
+        /**
+         * @brief Index of the calling worker of this pool, or -1 if the
+         * caller is not one of them.
+         */
+        int workerIndex() const;
+
+    private:
+        struct Queue
+        {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+
+        vector<std::thread> workers;
+        vector<std::unique_ptr<Queue>> queues;
+        std::atomic<size_t> nextQueue{0};
+
+        // tasks pushed and not yet popped; sleeping workers wait on it
+        std::atomic<int64_t> queued{0};
+        std::mutex sleepMutex;
+        std::condition_variable wakeUp;
+        bool stopping = false;
+
+        void workerLoop(int index);
+        bool pop(int index, Task &task);
+        bool steal(int index, Task &task);
+    };
+
+} // namespace infini
@@ -6,13 +6,15 @@ namespace infini
     Allocator::Allocator(Runtime runtime) : runtime(runtime)
     {
         used = 0;
+        head = 0;
         peak = 0;
         ptr = nullptr;
 
-        // 'alignment' defaults to sizeof(uint64_t), because it is the length of
-        // the longest data type currently supported by the DataType field of
-        // the tensor
-        alignment = sizeof(uint64_t);
+        // 'alignment' must be at least sizeof(uint64_t), because it is the
+        // length of the longest data type currently supported by the DataType
+        // field of the tensor. A whole cache line is used so that tensors
+        // never share a line and vector loads never straddle two.
+        alignment = 64;
     }
 
     Allocator::~Allocator()
@@ -23,62 +25,85 @@ namespace infini
         }
     }
 
-    size_t Allocator::alloc(size_t size) {
+    void Allocator::reset()
+    {
+        if (this->ptr != nullptr)
+            runtime->dealloc(this->ptr);
         ptr = nullptr;
+        used = head = peak = 0;
+        freeBlocks.clear();
+        freeBySize.clear();
+    }
+
+    size_t Allocator::alloc(size_t size)
+    {
         IT_ASSERT(this->ptr == nullptr);
         // pad the size to the multiple of alignment
         size = this->getAlignedSize(size);
-    
-        auto it = freeBlocks.lower_bound(size); // lower_bound返回第一个不小于size的元素迭代器
-        if (it != freeBlocks.end()) {
-            size_t blockAddr = it->first;
-            size_t blockSize = it->second;
-    
-            // 从空闲块中移除
-            freeBlocks.erase(it);
-    
+        used += size;
+
+        // best fit among the free blocks: the smallest one large enough,
+        // the lowest address among equal sizes
+        auto best = freeBySize.lower_bound({size, 0});
+        if (best != freeBySize.end())
+        {
+            auto [blockSize, blockAddr] = *best;
+            eraseFreeBlock(blockAddr, blockSize);
             // 如果块比需要的大，则分割并保留剩余部分为空闲
-            if (blockSize > size) {
-                size_t remainingAddr = blockAddr + size;
-                size_t remainingSize = blockSize - size;
-                freeBlocks.emplace(remainingAddr, remainingSize);
-            }
-    
-            used += size; // 更新已用内存
-            peak = std::max(peak, used);
+            if (blockSize > size)
+                insertFreeBlock(blockAddr + size, blockSize - size);
             return blockAddr;
-        } else {
-            size_t addr = used;
-            used += size;
-            peak = std::max(used, peak);
-            return addr;
         }
+
+        // no block is large enough: grow the arena. free() never keeps a
+        // block that touches `head`, so there is nothing to extend.
+        size_t addr = head;
+        head += size;
+        peak = std::max(peak, head);
+        return addr;
     }
-    
-    void Allocator::free(size_t addr, size_t size) {
+
+    void Allocator::free(size_t addr, size_t size)
+    {
         IT_ASSERT(this->ptr == nullptr);
         size = getAlignedSize(size);
-    
+        used -= size;
+
         // 尝试合并相邻的空闲块
-        auto it = freeBlocks.lower_bound(addr); // 找到第一个地址不小于addr的位置
-        if (it != freeBlocks.begin()) {
-            --it; // 检查前一个块是否可以合并
-            if (it->first + it->second == addr) { // 前一块紧邻当前释放的块
-                addr = it->first;
-                size += it->second;
-                freeBlocks.erase(it);
+        auto next = freeBlocks.lower_bound(addr);
+        if (next != freeBlocks.begin())
+        {
+            auto prev = std::prev(next);
+            IT_ASSERT(prev->first + prev->second <= addr, "Double free");
+            if (prev->first + prev->second == addr)
+            {
+                addr = prev->first;
+                size += prev->second;
+                eraseFreeBlock(prev->first, prev->second);
             }
         }
-    
-        it = freeBlocks.lower_bound(addr);
-        if (it != freeBlocks.end() && addr + size == it->first) { // 后一块紧邻当前释放的块
-            size += it->second;
-            freeBlocks.erase(it);
+        if (next != freeBlocks.end() && addr + size == next->first)
+        {
+            size += next->second;
+            eraseFreeBlock(next->first, next->second);
         }
-        // 插入新的合并后的空闲块
+
+        if (addr + size == head)
+            head = addr; // the arena shrinks back instead of keeping a tail block
+        else
+            insertFreeBlock(addr, size);
+    }
+
+    void Allocator::insertFreeBlock(size_t addr, size_t size)
+    {
         freeBlocks.emplace(addr, size);
-    
-        used -= size; // 更新已用内存
+        freeBySize.emplace(size, addr);
+    }
+
+    void Allocator::eraseFreeBlock(size_t addr, size_t size)
+    {
+        freeBlocks.erase(addr);
+        freeBySize.erase({size, addr});
     }
 
     void *Allocator::getPtr()
@@ -1,9 +1,15 @@
 #include "core/graph.h"
+#include "core/kernel.h"
+#include "core/rewrite.h"
+#include "core/serialize.h"
 #include <algorithm>
 #include <numeric>
 #include <queue>
+#include "operators/concat.h"
+#include "operators/element_wise.h"
 #include "operators/matmul.h"
 #include "operators/transpose.h"
+#include "operators/unary.h"
 
 namespace infini
 {
@@ -11,6 +17,8 @@ namespace infini
     void GraphObj::addOperatorAndConnect(const Operator &op)
     {
         sorted = false;
+        plan = nullptr;
+        opSlots[op->getGuid()] = ops.size();
         ops.push_back(op);
         for (auto &input : op->getInputs())
         {
@@ -40,6 +48,7 @@ namespace infini
 
     string GraphObj::toString() const
     {
+        compact();
         std::ostringstream oss;
         oss << "Graph Tensors:\n";
         for (const auto &tensor : tensors)
@@ -63,256 +72,650 @@ namespace infini
 
     bool GraphObj::topo_sort()
     {
+        compact();
         if (this->sorted)
         {
             return true;
         }
+        // Kahn's algorithm over the input slots produced inside the graph,
+        // always taking the earliest ready operator so that an order which
+        // is already topological stays as it is
+        const size_t n = ops.size();
+        vector<size_t> pending(n, 0);
+        std::priority_queue<size_t, vector<size_t>, std::greater<size_t>> ready;
+        for (size_t i = 0; i < n; ++i)
+        {
+            for (auto &input : ops[i]->getInputs())
+                pending[i] += input->getSource() != nullptr;
+            if (pending[i] == 0)
+                ready.push(i);
+        }
         std::vector<Operator> sorted;
-        std::unordered_set<OperatorObj *> flags;
-        sorted.reserve(ops.size());
-        flags.reserve(ops.size());
-        while (sorted.size() < ops.size())
-        {
-            // Any node is move to sorted in this loop.
-            auto modified = false;
-            for (auto const &op : ops)
-            {
-                if (auto const &inputs = op->getInputs();
-                    flags.find(op.get()) == flags.end() &&
-                    std::all_of(inputs.begin(), inputs.end(),
-                                [&flags](auto const &input)
-                                {
-                                    auto ptr = input->getSource().get();
-                                    return !ptr || flags.find(ptr) != flags.end();
-                                }))
+        sorted.reserve(n);
+        while (!ready.empty())
+        {
+            auto &op = ops[ready.top()];
+            ready.pop();
+            sorted.emplace_back(op);
+            for (auto &output : op->getOutputs())
+                for (auto &target : output->getTargets())
+                    if (auto it = opSlots.find(target->getGuid());
+                        it != opSlots.end() && --pending[it->second] == 0)
+                        ready.push(it->second);
+        }
+        if (sorted.size() < n)
+        {
+            return false;
+        }
+        this->ops = std::move(sorted);
+        reindex();
+        return this->sorted = true;
+    }
+
+    namespace
+    {
+        // Transpose swapping the last two axes, as MatMul's transA and
+        // transB do
+        bool swapsLastTwo(const Operator &op)
+        {
+            auto perm = as<TransposeObj>(op)->getPermute();
+            int rank = perm.size();
+            if (rank < 2 || perm[rank - 1] != rank - 2 ||
+                perm[rank - 2] != rank - 1)
+                return false;
+            for (int i = 0; i < rank - 2; ++i)
+                if (perm[i] != i)
+                    return false;
+            return true;
+        }
+
+        // MatMul reading a last-two-axes Transpose in input `i` reads the
+        // Transpose's input with transA (i = 0) or transB (i = 1) flipped
+        RewriteRule foldTransposeIntoMatmul(int i)
+        {
+            auto notTransposed = [i](const Operator &op)
+            {
+                auto matmul = as<MatmulObj>(op);
+                return !(i == 0 ? matmul->getTransA() : matmul->getTransB());
+            };
+            return {i == 0 ? "transpose-into-matmul-a"
+                           : "transpose-into-matmul-b",
+                    Pattern(OpType::MatMul, notTransposed)
+                        .input(i, Pattern(OpType::Transpose, swapsLastTwo)),
+                    [i](GraphObj &, const OpVec &m) -> optional<Rewrite>
+                    {
+                        auto matmul = as<MatmulObj>(m[0]);
+                        Tensor a = matmul->getInputs(0),
+                               b = matmul->getInputs(1);
+                        (i == 0 ? a : b) = m[1]->getInputs(0);
+                        return Rewrite{
+                            {make_ref<MatmulObj>(
+                                nullptr, a, b, matmul->getOutput(),
+                                matmul->getTransA() || i == 0,
+                                matmul->getTransB() || i == 1,
+                                matmul->getBias(), matmul->getActivation(),
+                                matmul->getClipMin(), matmul->getClipMax())},
+                            {}};
+                    }};
+        }
+
+        // the readers of the only output of m[0] read `to` instead
+        optional<Rewrite> bypass(const OpVec &m, const Tensor &to)
+        {
+            return Rewrite{{}, {{m[0]->getOutput(), to}}};
+        }
+
+        const vector<RewriteRule> &simplifyRules()
+        {
+            auto identity = [](const Operator &op)
+            {
+                auto perm = as<TransposeObj>(op)->getPermute();
+                for (size_t i = 0; i < perm.size(); ++i)
+                    if (perm[i] != (int)i)
+                        return false;
+                return true;
+            };
+            auto sameType = [](const Operator &op)
+            {
+                auto cast = as<CastObj>(op);
+                return cast->getInputDataType() == cast->getOutputDataType();
+            };
+            auto single = [](const Operator &op)
+            { return op->getInputs().size() == 1; };
+            auto readInput = [](GraphObj &, const OpVec &m)
+            { return bypass(m, m[0]->getInputs(0)); };
+            static const vector<RewriteRule> rules{
+                {"identity-transpose", Pattern(OpType::Transpose, identity),
+                 readInput},
+                // T2(T1(x)) picks axis p1[p2[i]] of x as axis i, so a chain
+                // collapses one Transpose at a time into the last one
+                {"transpose-chain",
+                 Pattern(OpType::Transpose)
+                     .input(0, Pattern(OpType::Transpose)),
+                 [](GraphObj &, const OpVec &m) -> optional<Rewrite>
+                 {
+                     auto outer = as<TransposeObj>(m[0])->getPermute();
+                     auto inner = as<TransposeObj>(m[1])->getPermute();
+                     vector<int> perm(outer.size());
+                     for (size_t i = 0; i < outer.size(); ++i)
+                         perm[i] = inner[outer[i]];
+                     return Rewrite{{make_ref<TransposeObj>(
+                                        nullptr, m[1]->getInputs(0),
+                                        m[0]->getOutput(), perm)},
+                                    {}};
+                 }},
+                {"identity-cast", Pattern(OpType::Cast, sameType), readInput},
+                {"single-concat", Pattern(OpType::Concat, single), readInput},
+                foldTransposeIntoMatmul(0),
+                foldTransposeIntoMatmul(1),
+            };
+            return rules;
+        }
+    } // namespace
+
+    void GraphObj::optimize()
+    {
+        foldConstants();
+        applyRewrites(*this, simplifyRules());
+        eliminateCommonSubexpressions();
+        // epilogues first: a bias Add and its activation would otherwise end
+        // up in an element-wise chain
+        fuseMatmulEpilogues();
+        fuseElementWiseChains();
+        topo_sort();
+    }
+
+    void GraphObj::detachOperator(const Operator &op)
+    {
+        detachOperators({op});
+    }
+
+    void GraphObj::detachOperators(const OpVec &dead)
+    {
+        std::unordered_set<const OperatorObj *> gone;
+        for (auto &op : dead)
+            gone.insert(op.get());
+        // every list an operator of `dead` is in is filtered once
+        std::unordered_set<TensorObj *> inputs;
+        std::unordered_set<OperatorObj *> neighbours;
+        for (auto &op : dead)
+        {
+            for (auto &input : op->getInputs())
+                if (input)
+                    inputs.insert(input.get());
+            for (auto &output : op->getOutputs())
+                if (output && output->getSource() == op)
+                    output->setSource(nullptr);
+            for (auto *list : {&op->predecessors, &op->successors})
+                for (auto &w : *list)
+                    if (auto n = w.lock(); n && !gone.count(n.get()))
+                        neighbours.insert(n.get());
+        }
+        auto isGone = [&](const WRef<OperatorObj> &w)
+        { return gone.count(w.lock().get()) > 0; };
+        for (auto *input : inputs)
+            input->targets.erase(std::remove_if(input->targets.begin(),
+                                                input->targets.end(), isGone),
+                                 input->targets.end());
+        for (auto *op : neighbours)
+            for (auto *list : {&op->predecessors, &op->successors})
+                list->erase(std::remove_if(list->begin(), list->end(), isGone),
+                            list->end());
+        for (auto &op : dead)
+            removeOperator(op);
+    }
+
+    bool GraphObj::replaceSubgraph(const OpVec &matched, const OpVec &add,
+                                   const vector<pair<Tensor, Tensor>> &replace,
+                                   OpVec *touched)
+    {
+        IT_ASSERT(!matched.empty());
+        // outputs of matched operators that `add` writes, that stop being
+        // read, and that will be read
+        std::unordered_set<const TensorObj *> written, redirected, needed;
+        for (auto &op : add)
+        {
+            for (auto &output : op->getOutputs())
+                written.insert(output.get());
+            for (auto &input : op->getInputs())
+                needed.insert(input.get());
+        }
+        for (auto &[from, to] : replace)
+        {
+            redirected.insert(from.get());
+            needed.insert(to.get());
+        }
+        // outputs the rewrite created for `add` would be left unconnected
+        auto refuse = [&]
+        {
+            for (auto &op : add)
+                for (auto &output : op->getOutputs())
+                    if (!output->getSource() && !output->hasTargets())
+                        removeTensor(output);
+            return false;
+        };
+        for (auto &[from, to] : replace)
+            if (!from->hasTargets())
+                return refuse();
+
+        // consumers first, so that an operator is removable once the
+        // readers of its outputs are
+        std::unordered_set<const OperatorObj *> dead;
+        OpVec removed;
+        for (auto &op : matched)
+        {
+            if (dead.count(op.get()))
+                continue;
+            bool removable = true, overwritten = false;
+            for (auto &output : op->getOutputs())
+            {
+                overwritten |= written.count(output.get()) > 0;
+                if (written.count(output.get()) ||
+                    redirected.count(output.get()))
+                    continue;
+                removable &= !needed.count(output.get()) &&
+                             output->hasTargets() &&
+                             std::all_of(output->targets.begin(),
+                                         output->targets.end(),
+                                         [&](const WRef<OperatorObj> &w) {
+                                             return dead.count(
+                                                 w.lock().get()) > 0;
+                                         });
+            }
+            if (!removable && (op == matched[0] || overwritten))
+                return refuse();
+            if (removable)
+            {
+                dead.insert(op.get());
+                removed.emplace_back(op);
+            }
+        }
+
+        // in a fixed order, so that rewrites apply in the same order on
+        // every run
+        vector<OperatorObj *> around;
+        std::unordered_set<OperatorObj *> seen;
+        auto touch = [&](OperatorObj *op)
+        {
+            if (seen.insert(op).second)
+                around.emplace_back(op);
+        };
+        for (auto &op : removed)
+            for (auto &w : op->predecessors)
+                if (auto pred = w.lock(); pred && !dead.count(pred.get()))
+                    touch(pred.get());
+        TensorVec orphans;
+        for (auto &op : removed)
+            for (auto &output : op->getOutputs())
+                orphans.emplace_back(output);
+        detachOperators(removed);
+
+        for (auto &[from, to] : replace)
+        {
+            for (auto &reader : redirectReaders(from, to))
+                touch(reader.get());
+            orphans.emplace_back(from);
+        }
+        for (auto &op : add)
+        {
+            addOperatorAndConnect(op);
+            touch(op.get());
+            for (auto &output : op->getOutputs())
+                for (auto &w : output->targets)
+                    if (auto reader = w.lock())
+                        touch(reader.get());
+        }
+        for (auto &t : orphans)
+            if (getTensor(t->getFuid()) == t && !t->getSource() &&
+                !t->hasTargets())
+                removeTensor(t);
+        sorted = false;
+        if (touched)
+            for (auto *op : around)
+                if (auto alive = getOperator(op->getGuid()))
+                    touched->emplace_back(alive);
+        return true;
+    }
+
+    OpVec GraphObj::redirectReaders(const Tensor &from, const Tensor &to)
+    {
+        // one edge per input slot, as addOperatorAndConnect() makes them
+        auto eraseOne = [](vector<WRef<OperatorObj>> &list, const void *op)
+        {
+            auto it = std::find_if(list.begin(), list.end(),
+                                   [&](const WRef<OperatorObj> &w)
+                                   { return w.lock().get() == op; });
+            if (it != list.end())
+                list.erase(it);
+        };
+        OpVec readers;
+        std::unordered_set<const OperatorObj *> seen;
+        for (auto &w : from->targets)
+            if (auto reader = w.lock(); seen.insert(reader.get()).second)
+                readers.emplace_back(reader);
+        auto src = from->getSource(), dst = to->getSource();
+        for (auto &reader : readers)
+        {
+            auto &inputs = reader->getInputs();
+            auto slots = std::count(inputs.begin(), inputs.end(), from);
+            reader->replaceInput(from, to);
+            for (long i = 0; i < slots; ++i)
+            {
+                to->addTarget(reader);
+                if (src)
+                {
+                    eraseOne(reader->predecessors, src.get());
+                    eraseOne(src->successors, reader.get());
+                }
+                if (dst)
                 {
-                    modified = true;
-                    sorted.emplace_back(op);
-                    flags.insert(op.get());
+                    reader->addPredecessors(dst);
+                    dst->addSuccessors(reader);
                 }
             }
-            if (!modified)
+        }
+        from->targets.clear();
+        sorted = false;
+        plan = nullptr;
+        return readers;
+    }
+
+    void GraphObj::foldConstants()
+    {
+        IT_ASSERT(topo_sort() == true);
+        const auto &registry = KernelRegistry::getInstance();
+        OpVec folded;
+        TensorVec read;
+        // in topological order, an output made constant here lets its
+        // readers fold too
+        for (auto &op : ops)
+        {
+            auto &inputs = op->getInputs();
+            auto &outputs = op->getOutputs();
+            // a graph output keeps its producer, as in
+            // eliminateCommonSubexpressions()
+            if (inputs.empty() ||
+                !std::all_of(inputs.begin(), inputs.end(),
+                             [](const Tensor &t) { return t->isConstant(); }) ||
+                std::any_of(outputs.begin(), outputs.end(),
+                            [](const Tensor &t) { return !t->hasTargets(); }))
+                continue;
+            auto *item = registry.findKernelItem(KernelAttrs{
+                runtime->getDevice(), op->getOpType().underlying()});
+            if (!item)
+                continue;
+            for (auto &output : outputs)
+                output->setConstant();
+            std::get<0>(*item)->compute(op, runtime.get());
+            folded.emplace_back(op);
+            read.insert(read.end(), inputs.begin(), inputs.end());
+        }
+        detachOperators(folded);
+        for (auto &t : read)
+            if (!t->hasTargets() && getTensor(t->getFuid()) == t)
+                removeTensor(t);
+    }
+
+    void GraphObj::eliminateCommonSubexpressions()
+    {
+        IT_ASSERT(topo_sort() == true);
+        // outputs of merged operators and the outputs they merged into;
+        // an operator is keyed by the inputs it will read after the merges
+        std::unordered_map<const TensorObj *, Tensor> merged;
+        vector<pair<Tensor, Tensor>> redirects;
+        std::unordered_map<string, Operator> first;
+        OpVec dead;
+        for (auto &op : ops)
+        {
+            auto &outputs = op->getOutputs();
+            // a graph output keeps its producer and gets no readers
+            if (std::any_of(outputs.begin(), outputs.end(),
+                            [](const Tensor &t) { return !t->hasTargets(); }))
+                continue;
+            ByteWriter key;
+            key.put<OpType::underlying_t>(op->getOpType().underlying());
+            key.put<uint32_t>(op->getInputs().size());
+            for (auto &input : op->getInputs())
             {
-                return false;
+                auto it = merged.find(input.get());
+                key.put<UidBaseType>(
+                    (it == merged.end() ? input : it->second)->getFuid());
+            }
+            encodeAttributes(op, key);
+            auto [it, fresh] = first.try_emplace(std::move(key.buf), op);
+            if (fresh)
+                continue;
+            auto &kept = it->second->getOutputs();
+            for (size_t i = 0; i < outputs.size(); ++i)
+            {
+                merged[outputs[i].get()] = kept[i];
+                redirects.emplace_back(outputs[i], kept[i]);
             }
+            dead.emplace_back(op);
+        }
+        // detached first, so that rewiring a reader does not search the
+        // edges of the merged operator
+        detachOperators(dead);
+        for (auto &[from, to] : redirects)
+        {
+            redirectReaders(from, to);
+            removeTensor(from);
         }
-        this->ops = std::move(sorted);
-        return this->sorted = true;
     }
 
-    void GraphObj::optimize() {
-        auto it = ops.begin();
-        while (it != ops.end())
+    void GraphObj::fuseMatmulEpilogues()
+    {
+        IT_ASSERT(topo_sort() == true);
+        OpVec matmuls;
+        for (auto &op : ops)
+            if (auto matmul = as<MatmulObj>(op);
+                matmul && !matmul->getBias() &&
+                matmul->getActivation() == MatmulActivation::None)
+                matmuls.emplace_back(op);
+
+        // the only reader of `t`, if it has exactly one
+        auto onlyReader = [](const Tensor &t) -> Operator
+        {
+            auto targets = t->getTargets();
+            return targets.size() == 1 ? targets[0] : nullptr;
+        };
+        // detached together at the end: a weight shared by many MatMuls
+        // then has its readers filtered once instead of once per MatMul
+        OpVec dead;
+        for (auto &op : matmuls)
         {
-            if ((*it)->getOpType() == OpType(OpType::Transpose))
+            auto matmul = as<MatmulObj>(op);
+            Tensor c = matmul->getOutput(), out = c, bias;
+            OpVec absorbed{op};
+            auto next = onlyReader(out);
+            if (next && next->getOpType() == OpType::Add)
             {
-                TransposeObj *transposeOp = dynamic_cast<TransposeObj*>(it->get());
-                const std::vector<int> &permutation = transposeOp->getPermute();
-                size_t rank = permutation.size();
-
-                auto nextIt = std::next(it);
-                if (nextIt != ops.end() && (*nextIt)->getOpType() == OpType(OpType::Transpose))
+                Tensor other = next->getInputs(0) == c ? next->getInputs(1)
+                                                       : next->getInputs(0);
+                // a row of n, broadcast over the rows without growing C
+                const auto &dims = other->getDims();
+                bool row = other != c && !dims.empty() &&
+                           dims.size() <= c->getRank() &&
+                           dims.back() == c->getDims().back() &&
+                           other->size() == (size_t)dims.back() &&
+                           next->getOutput()->getDims() == c->getDims();
+                if (row)
                 {
-                    TransposeObj *nextTransposeOp = dynamic_cast<TransposeObj*>(nextIt->get());
-                    const std::vector<int> &nextPermutation = nextTransposeOp->getPermute();
-                    
-                    if (rank == nextPermutation.size() &&
-                        permutation[rank - 1] == static_cast<int>(rank - 2) &&
-                        permutation[rank - 2] == static_cast<int>(rank - 1) &&
-                        nextPermutation[rank - 1] == static_cast<int>(rank - 2) &&
-                        nextPermutation[rank - 2] == static_cast<int>(rank - 1))
-                    {
-                        for (auto &input : transposeOp->getInputs())
-                        {
-                            if (input)
-                            {
-                                input->removeTarget(*it);
-                            }
-                        }
-                        for (auto &input : nextTransposeOp->getInputs())
-                        {
-                            if (input)
-                            {
-                                input->removeTarget(*nextIt);
-                            }
-                        }
-                        for (auto &output : nextTransposeOp->getOutputs())
-                        {
-                            if (output)
-                            {
-                                output->setSource(nullptr);
-                                for (auto &target : output->getTargets())
-                                {
-                                    target->removePredecessors(*nextIt);
-                                    target->replaceInput(output, transposeOp->getInputs()[0]);
-                                }
-                            }
-                        }
-                        for (auto &output : transposeOp->getOutputs())
-                        {
-                            if (output)
-                            {
-                                output->setSource(nullptr);
-                                for (auto &target : output->getTargets())
-                                {
-                                    target->removePredecessors(*it);
-                                    target->replaceInput(output, transposeOp->getInputs()[0]);
-                                }
-                            }
-                        }
-
-
-                        // 移除两个 Transpose 算子的前驱和后继操作
-                        for (auto &predecessor : transposeOp->getPredecessors())
-                        {
-                            predecessor->removeSuccessors(*it);
-                        }
-                        for (auto &predecessor : nextTransposeOp->getPredecessors())
-                        {
-                            predecessor->removeSuccessors(*nextIt);
-                        }
-
-                        for (auto &successor : transposeOp->getSuccessors())
-                        {
-                            successor->removePredecessors(*it);
-                        }
-                        for (auto &successor : nextTransposeOp->getSuccessors())
-                        {
-                            successor->removePredecessors(*nextIt);
-                        }
-                        // 从 ops 列表中移除这两个 Transpose 算子
-                        removeTensor(nextTransposeOp->getOutputs()[0]);
-                        removeTensor(transposeOp->getOutputs()[0]);
-                        removeOperator(*nextIt);
-                        removeOperator(*it);
-                        continue;
-                    }
+                    bias = other;
+                    absorbed.emplace_back(next);
+                    out = next->getOutput();
+                    next = onlyReader(out);
                 }
             }
-            if ((*it)->getOpType() == OpType(OpType::MatMul)) {
-                MatmulObj *matmulOp = dynamic_cast<MatmulObj*>(it->get());
+            auto act = MatmulActivation::None;
+            std::optional<float> clipMin, clipMax;
+            if (next && next->getOpType() == OpType::Relu)
+                act = MatmulActivation::Relu;
+            else if (auto clip = next ? as<ClipObj>(next) : nullptr)
+            {
+                act = MatmulActivation::Clip;
+                clipMin = clip->getMin();
+                clipMax = clip->getMax();
+            }
+            if (act != MatmulActivation::None)
+            {
+                absorbed.emplace_back(next);
+                out = next->getOutput();
+            }
+            if (absorbed.size() == 1)
+                continue;
 
-                // 获取 MatMul 的输入张量
-                Tensor inputA = (*it)->getInputs()[0];
-                Tensor inputB = (*it)->getInputs()[1];
-    
-                // 检查 inputA 是否来自 Transpose
-                Operator sourceA = inputA->getSource();
-                if (sourceA && sourceA->getOpType() == OpType(OpType::Transpose) && matmulOp->getTransA()==false) {
-                    TransposeObj *transposeOp = dynamic_cast<TransposeObj*>(sourceA.get());
-                    const std::vector<int> &permutationA = transposeOp->getPermute();
-                    size_t rank = permutationA.size();
-                    if (rank >= 2 && permutationA[rank - 1] == static_cast<int>(rank - 2) && permutationA[rank - 2] == static_cast<int>(rank - 1))
-                    {
-                        matmulOp->setTransA(true);
-                        // 移除 Transpose 算子的输入张量的连接
-                        for (auto &input : transposeOp->getInputs())
-                        {
-                            if (input)
-                            {
-                                input->removeTarget(sourceA);
-                            }
-                        }
-
-                        // 移除 Transpose 算子的输出张量的连接
-                        for (auto &output : transposeOp->getOutputs())
-                        {
-                            if (output)
-                            {
-                                output->setSource(nullptr);
-                                for (auto &target : output->getTargets())
-                                {
-                                    target->removePredecessors(sourceA);
-                                    target->replaceInput(output, transposeOp->getInputs()[0]);
-                                }
-                            }
-                        }
-
-                        // 移除 Transpose 算子的前驱和后继操作
-                        for (auto &predecessor : transposeOp->getPredecessors())
-                        {
-                            predecessor->removeSuccessors(sourceA);
-                        }
-                        for (auto &successor : transposeOp->getSuccessors())
-                        {
-                            successor->removePredecessors(sourceA);
-                        }
-
-                        // 从 ops 列表中移除 Transpose 算子
-                        removeTensor(transposeOp->getOutputs()[0]);
-                        removeOperator(sourceA);
-                        continue;
-
-                    }
+            Tensor a = matmul->getInputs(0), b = matmul->getInputs(1);
+            for (auto &absorbedOp : absorbed)
+                if (absorbedOp->getOutput() != out)
+                    removeTensor(absorbedOp->getOutput());
+            dead.insert(dead.end(), absorbed.begin(), absorbed.end());
+            addOpWithOutputs<MatmulObj>(a, b, out, matmul->getTransA(),
+                                        matmul->getTransB(), bias, act,
+                                        clipMin, clipMax);
+        }
+        detachOperators(dead);
+    }
+
+    void GraphObj::fuseElementWiseChains()
+    {
+        IT_ASSERT(topo_sort() == true);
+        auto fusable = [](const Operator &op)
+        {
+            switch (op->getOpType().underlying())
+            {
+            case OpType::Add:
+            case OpType::Sub:
+            case OpType::Mul:
+            case OpType::Div:
+            case OpType::Relu:
+            case OpType::Clip:
+                return true;
+            default:
+                return false;
+            }
+        };
+
+        // chains are grown forward from the first operator in topological
+        // order that is not part of one yet, so each is maximal
+        vector<OpVec> chains;
+        std::unordered_set<OperatorObj *> taken;
+        for (auto &op : ops)
+        {
+            if (!fusable(op) || taken.count(op.get()))
+                continue;
+            OpVec chain{op};
+            while (true)
+            {
+                auto targets = chain.back()->getOutput()->getTargets();
+                // a graph output or a tensor read twice must be written
+                if (targets.size() != 1 || !fusable(targets[0]))
+                    break;
+                chain.emplace_back(targets[0]);
+            }
+            if (chain.size() < 2)
+                continue;
+            for (auto &member : chain)
+                taken.insert(member.get());
+            chains.emplace_back(std::move(chain));
+        }
+
+        for (auto &chain : chains)
+        {
+            TensorVec inputs;
+            std::unordered_map<const TensorObj *, int> indexOf;
+            auto inputIndex = [&](const Tensor &t)
+            {
+                auto [it, inserted] =
+                    indexOf.try_emplace(t.get(), inputs.size());
+                if (inserted)
+                    inputs.emplace_back(t);
+                return it->second;
+            };
+            vector<FusedStep> steps;
+            Tensor value = chain[0]->getInputs(0);
+            inputIndex(value);
+            for (auto &op : chain)
+            {
+                FusedStep step{op->getOpType()};
+                if (op->numInputs() == 2)
+                {
+                    step.reversed = op->getInputs(1) == value &&
+                                    op->getInputs(0) != value;
+                    step.operand = inputIndex(op->getInputs(step.reversed ? 0 : 1));
                 }
-                // 检查 inputB 是否来自 Transpose
-                Operator sourceB = inputB->getSource();
-                if (sourceB && sourceB->getOpType() == OpType(OpType::Transpose) && matmulOp->getTransB() == false)
+                else if (auto clip = as<ClipObj>(op))
                 {
-                    TransposeObj *transposeOp = dynamic_cast<TransposeObj*>(sourceB.get());
-                    const std::vector<int> &permutationB = transposeOp->getPermute();
-                    size_t rank = permutationB.size();
-                    if (rank >= 2 && permutationB[rank - 1] == static_cast<int>(rank - 2) && permutationB[rank - 2] == static_cast<int>(rank - 1))
-                    {
-                        matmulOp->setTransB(true);
-                        // 移除 Transpose 算子的输入张量的连接
-                        for (auto &input : transposeOp->getInputs())
-                        {
-                            if (input)
-                            {
-                                input->removeTarget(sourceB);
-                            }
-                        }
-
-                        // 移除 Transpose 算子的输出张量的连接
-                        for (auto &output : transposeOp->getOutputs())
-                        {
-                            if (output)
-                            {
-                                output->setSource(nullptr);
-                                for (auto &target : output->getTargets())
-                                {
-                                    target->removePredecessors(sourceB);
-                                    target->replaceInput(output, transposeOp->getInputs()[0]);
-                                }
-                            }
-                        }
-
-                        // 移除 Transpose 算子的前驱和后继操作
-                        for (auto &predecessor : transposeOp->getPredecessors())
-                        {
-                            predecessor->removeSuccessors(sourceB);
-                        }
-                        for (auto &successor : transposeOp->getSuccessors())
-                        {
-                            successor->removePredecessors(sourceB);
-                        }
-                        removeTensor(transposeOp->getOutputs()[0]);
-                        removeOperator(sourceB);
-                        continue;
-                    }
+                    step.min = clip->getMin();
+                    step.max = clip->getMax();
                 }
+                steps.emplace_back(step);
+                value = op->getOutput();
             }
-            ++it;
+
+            for (size_t i = 0; i + 1 < chain.size(); ++i)
+                removeTensor(chain[i]->getOutput());
+            addOpWithOutputs<FusedElementWiseObj>(inputs, value,
+                                                  std::move(steps));
         }
-        topo_sort();
+        OpVec dead;
+        for (auto &chain : chains)
+            dead.insert(dead.end(), chain.begin(), chain.end());
+        detachOperators(dead);
     }
     
 
     Tensor GraphObj::getTensor(int fuid) const
     {
-        for (auto tensor : tensors)
-        {
-            if (tensor->getFuid() == fuid)
-            {
-                return tensor;
-            }
-        }
-        return nullptr;
+        auto it = tensorSlots.find(fuid);
+        return it == tensorSlots.end() ? nullptr : tensors[it->second];
+    }
+
+    Operator GraphObj::getOperator(UidBaseType guid) const
+    {
+        auto it = opSlots.find(guid);
+        return it == opSlots.end() ? nullptr : ops[it->second];
+    }
+
+    void GraphObj::removeOperator(Operator op)
+    {
+        auto it = opSlots.find(op->getGuid());
+        if (it == opSlots.end() || ops[it->second] != op)
+            return;
+        plan = nullptr;
+        ops[it->second] = nullptr;
+        opSlots.erase(it);
+        ++holes;
+    }
+
+    void GraphObj::removeTensor(Tensor tensor)
+    {
+        auto it = tensorSlots.find(tensor->getFuid());
+        if (it == tensorSlots.end() || tensors[it->second] != tensor)
+            return;
+        tensors[it->second] = nullptr;
+        tensorSlots.erase(it);
+        ++holes;
+    }
+
+    void GraphObj::reindex() const
+    {
+        tensors.erase(std::remove(tensors.begin(), tensors.end(), nullptr),
+                      tensors.end());
+        ops.erase(std::remove(ops.begin(), ops.end(), nullptr), ops.end());
+        tensorSlots.clear();
+        opSlots.clear();
+        for (size_t i = 0; i < tensors.size(); ++i)
+            tensorSlots[tensors[i]->getFuid()] = i;
+        for (size_t i = 0; i < ops.size(); ++i)
+            opSlots[ops[i]->getGuid()] = i;
+        holes = 0;
     }
 
     void GraphObj::shape_infer()
     {
+        compact();
+        plan = nullptr;
         for (auto &op : ops)
         {
             auto ans = op->inferShape();
@@ -323,41 +726,485 @@ namespace infini
             for (int i = 0; i < (int)ans.value().size(); ++i)
             {
                 auto newShape = ans.value()[i];
-                auto oldShape = oldOutputs[i]->getDims();
-                auto fuid = oldOutputs[i]->getFuid();
-                if (newShape != oldShape)
-                {
-                    auto tensor = this->getTensor(fuid);
-                    tensor->setShape(newShape);
-                }
+                if (newShape != oldOutputs[i]->getDims())
+                    oldOutputs[i]->setShape(newShape);
             }
         }
     }
 
+    TensorVec GraphObj::updateInputShapes(
+        const vector<pair<UidBaseType, Shape>> &shapes)
+    {
+        plan = nullptr;
+        TensorVec changed;
+        std::unordered_set<const TensorObj *> reshaped;
+        auto reshape = [&](const Tensor &tensor, const Shape &shape)
+        {
+            if (tensor->getDims() == shape)
+                return;
+            bool view = !tensor->isContiguous();
+            size_t bytes = tensor->getBytes();
+            tensor->setShape(shape);
+            reshaped.insert(tensor.get());
+            if (view || tensor->getBytes() != bytes)
+                changed.emplace_back(tensor);
+        };
+
+        OpVec stack;
+        for (auto &[fuid, shape] : shapes)
+        {
+            auto tensor = getTensor(fuid);
+            IT_ASSERT(tensor && !tensor->getSource(),
+                      "No graph input with fuid " + std::to_string(fuid));
+            reshape(tensor, shape);
+            if (reshaped.count(tensor.get()))
+                for (auto &target : tensor->getTargets())
+                    stack.emplace_back(target);
+        }
+
+        // the operators downstream of a reshaped input, each with the
+        // number of its input slots produced inside that cone
+        std::unordered_map<OperatorObj *, size_t> pending;
+        OpVec cone;
+        while (!stack.empty())
+        {
+            auto op = std::move(stack.back());
+            stack.pop_back();
+            if (!pending.try_emplace(op.get(), 0).second)
+                continue;
+            cone.emplace_back(op);
+            for (auto &succ : op->getSuccessors())
+                stack.emplace_back(succ);
+        }
+        for (auto &op : cone)
+            for (auto &output : op->getOutputs())
+                for (auto &target : output->getTargets())
+                    ++pending.at(target.get());
+
+        for (auto &op : cone)
+            if (pending[op.get()] == 0)
+                stack.emplace_back(op);
+        while (!stack.empty())
+        {
+            auto op = std::move(stack.back());
+            stack.pop_back();
+            const auto &inputs = op->getInputs();
+            if (std::any_of(inputs.begin(), inputs.end(),
+                            [&](const Tensor &input)
+                            { return reshaped.count(input.get()) > 0; }))
+            {
+                auto ans = op->inferShape();
+                IT_ASSERT(ans.has_value(),
+                          "Cannot infer the shapes of " + op->toString());
+                auto outputs = op->getOutputs();
+                IT_ASSERT(ans->size() == outputs.size());
+                for (size_t i = 0; i < outputs.size(); ++i)
+                    reshape(outputs[i], (*ans)[i]);
+            }
+            for (auto &output : op->getOutputs())
+                for (auto &target : output->getTargets())
+                    if (--pending.at(target.get()) == 0)
+                        stack.emplace_back(target);
+        }
+        return changed;
+    }
+
     void GraphObj::dataMalloc()
     {
         // topological sorting first
         IT_ASSERT(topo_sort() == true);
+        // a new plan replaces the previous one and the data in its arena
+        allocator.reset();
+        plan = nullptr;
 
-        for (auto &tensor : tensors)
+        // When the runtime executes independent operators concurrently, the
+        // operators are planned level by level (level = longest path from a
+        // graph input) and blocks die only at the end of a level: operators
+        // of one level then never share memory, so the memory dependencies
+        // below only ever point to earlier levels instead of chaining
+        // independent branches together. This costs some peak memory.
+        bool byLevel = runtime->getInterOpThreads() > 1;
+        vector<size_t> level(ops.size(), 0);
+        std::unordered_map<OperatorObj *, size_t> levelOf;
+        if (byLevel)
         {
-            // 计算张量所需的内存大小
-            size_t size = tensor->getBytes();
-            if (size == 0) {
+            for (auto &op : ops)
+            {
+                size_t l = 0;
+                for (auto &pred : op->getPredecessors())
+                    l = std::max(l, levelOf[pred.get()] + 1);
+                levelOf[op.get()] = l;
+            }
+            std::stable_sort(ops.begin(), ops.end(),
+                             [&](const Operator &a, const Operator &b)
+                             { return levelOf[a.get()] < levelOf[b.get()]; });
+            reindex();
+            for (size_t i = 0; i < ops.size(); ++i)
+                level[i] = levelOf[ops[i].get()];
+        }
+
+        // A Transpose whose readers all take its permuted layout as it is
+        // only relabels its input: its output becomes a view of the input's
+        // block with permuted strides and its kernel does nothing. MatMul
+        // absorbs any strides into its packing and a Transpose of a view
+        // transposes the viewed block directly. Element-wise operators and
+        // Concat walk their operands row by row, so they only get views
+        // whose rows stay contiguous; a tiled copy beats column-strided reads
+        // for the others.
+        struct View
+        {
+            TensorObj *base;
+            vector<int64_t> strides;
+        };
+        std::unordered_map<TensorObj *, View> views;
+        auto readsView = [](const Operator &reader, const Tensor &tensor,
+                            const vector<int64_t> &strides)
+        {
+            switch (reader->getOpType().underlying())
+            {
+            case OpType::Add:
+            case OpType::Sub:
+            case OpType::Mul:
+            case OpType::Div:
+            case OpType::FusedElementWise:
+            case OpType::Concat:
+            {
+                auto dims = tensor->getDims();
+                for (size_t d = dims.size(); d > 0; --d)
+                    if (dims[d - 1] != 1)
+                        return strides[d - 1] == 1;
+                return true;
+            }
+            case OpType::Transpose:
+                return true;
+            case OpType::MatMul:
+                // A and B, but not the bias
+                return reader->numInputs() < 3 ||
+                       reader->getInputs(2) != tensor;
+            default:
+                return false;
+            }
+        };
+        for (auto &op : ops)
+        {
+            if (op->getOpType() != OpType::Transpose)
+                continue;
+            auto input = op->getInputs(0), output = op->getOutput();
+            auto readers = output->getTargets();
+            if (readers.empty() || output->getBytes() == 0)
+                continue;
+            // a view of a view shares the first one's block
+            View view{input.get(), {}};
+            if (auto it = views.find(input.get()); it != views.end())
+                view = it->second;
+            else
+            {
+                auto dims = input->getDims();
+                view.strides.assign(dims.size(), 1);
+                for (int d = (int)dims.size() - 2; d >= 0; --d)
+                    view.strides[d] = view.strides[d + 1] * dims[d + 1];
+            }
+            auto permute = as<TransposeObj>(op)->getPermute();
+            vector<int64_t> strides(permute.size());
+            for (size_t j = 0; j < permute.size(); ++j)
+                strides[j] = view.strides[permute[j]];
+            if (!std::all_of(readers.begin(), readers.end(),
+                             [&](const Operator &reader)
+                             { return readsView(reader, output, strides); }))
                 continue;
+            view.strides = std::move(strides);
+            views[output.get()] = std::move(view);
+        }
+
+        // A Concat whose dims before its axis are all 1 lays its inputs out
+        // one after the other. Inputs computed in the graph are then written
+        // by their producers straight into their slice of the output's block,
+        // and the Concat finds them in place. A tensor is a slice of at most
+        // one Concat; a Concat output may itself be a slice of another one.
+        struct Slice
+        {
+            TensorObj *concat;
+            size_t offset; // bytes
+        };
+        std::unordered_map<TensorObj *, Slice> slices;
+        for (auto &op : ops)
+        {
+            if (op->getOpType() != OpType::Concat)
+                continue;
+            auto output = op->getOutput();
+            auto dims = output->getDims();
+            int dim = as<ConcatObj>(op)->getDim();
+            if (!std::all_of(dims.begin(), dims.begin() + dim,
+                             [](int d) { return d == 1; }))
+                continue;
+            auto inputs = op->getInputs();
+            size_t offset = 0;
+            for (auto &input : inputs)
+            {
+                if (input->getSource() && input->getBytes() > 0 &&
+                    !views.count(input.get()) && !slices.count(input.get()) &&
+                    std::count(inputs.begin(), inputs.end(), input) == 1)
+                    slices[input.get()] = {output.get(), offset};
+                offset += input->getBytes();
             }
-            allocator.alloc(size);
-            void* basePtr = allocator.getPtr();
-            
-            Blob blob = make_ref<BlobObj>(runtime, basePtr);
-            tensor->setDataBlob(blob);
         }
+
+        // the tensor owning the block `tensor` lives in
+        auto blockOf = [&](TensorObj *tensor)
+        {
+            if (auto it = views.find(tensor); it != views.end())
+                tensor = it->second.base;
+            for (auto it = slices.find(tensor); it != slices.end();
+                 it = slices.find(tensor))
+                tensor = it->second.concat;
+            return tensor;
+        };
+        // views and slices reading or writing every block
+        std::unordered_map<TensorObj *, vector<TensorObj *>> aliasesOf;
+        for (auto &[tensor, view] : views)
+            aliasesOf[blockOf(tensor)].emplace_back(tensor);
+        for (auto &[tensor, slice] : slices)
+            aliasesOf[blockOf(tensor)].emplace_back(tensor);
+
+        // Index of the last operator reading each tensor, directly or through
+        // a view or slice. Graph inputs (and weights) are read again on every
+        // run and graph outputs are read by the caller, so neither of them is
+        // ever released.
+        std::unordered_map<TensorObj *, size_t> lastUse;
+        for (size_t i = 0; i < ops.size(); ++i)
+            for (auto &input : ops[i]->getInputs())
+                if (auto *block = blockOf(input.get()); block->hasTargets())
+                    lastUse[block] = i;
+
+        std::unordered_map<TensorObj *, size_t> offsets;
+        // Blocks of released tensors. An operator whose output overlaps one
+        // of them overwrites what the tensor's readers read, so it has to wait
+        // for them even without a data edge.
+        vector<std::pair<size_t, TensorObj *>> released;
+        memoryDeps.clear();
+        auto addDep = [&](const Operator &op, OperatorObj *dep)
+        {
+            auto &deps = memoryDeps[op.get()];
+            if (std::find(deps.begin(), deps.end(), dep) == deps.end())
+                deps.emplace_back(dep);
+        };
+        // The block of a Concat with slices is allocated with its first
+        // slice, and every slice's writer has to wait for what the block
+        // overwrote.
+        std::unordered_map<TensorObj *, vector<OperatorObj *>> sliceDeps;
+        auto allocTensor = [&](const Tensor &tensor, const Operator &writer)
+        {
+            // 计算张量所需的内存大小
+            if (tensor->getBytes() == 0 || views.count(tensor.get()))
+                return;
+            auto *block = blockOf(tensor.get());
+            if (offsets.count(block))
+            {
+                if (writer && block != tensor.get())
+                    for (auto *dep : sliceDeps[block])
+                        addDep(writer, dep);
+                return;
+            }
+            size_t size = block->getBytes();
+            size_t offset = allocator.alloc(size);
+            offsets[block] = offset;
+            if (!writer)
+                return;
+            vector<OperatorObj *> deps;
+            for (size_t k = 0; k < released.size();)
+            {
+                auto [begin, dead] = released[k];
+                size_t end = begin + dead->getBytes();
+                if (end <= offset || begin >= offset + size)
+                {
+                    ++k;
+                    continue;
+                }
+                auto readers = dead->getTargets();
+                if (auto it = aliasesOf.find(dead); it != aliasesOf.end())
+                    for (auto *alias : it->second)
+                        for (auto &reader : alias->getTargets())
+                            readers.emplace_back(reader);
+                for (auto &reader : readers)
+                    if (std::find(deps.begin(), deps.end(), reader.get()) ==
+                        deps.end())
+                        deps.emplace_back(reader.get());
+                // a block overwritten as a whole is ordered through its new
+                // tensor from now on
+                if (begin >= offset && end <= offset + size)
+                {
+                    released[k] = released.back();
+                    released.pop_back();
+                }
+                else
+                    ++k;
+            }
+            for (auto *dep : deps)
+                addDep(writer, dep);
+            if (block != tensor.get())
+                sliceDeps[block] = std::move(deps);
+        };
+
+        // weights bound to external memory (a loaded file) stay there
+        for (auto &tensor : tensors)
+            if (!tensor->getSource() && !tensor->hasExternalData())
+                allocTensor(tensor, nullptr);
+
+        vector<TensorObj *> dying;
+        auto release = [&]
+        {
+            for (auto *tensor : dying)
+            {
+                size_t offset = offsets[tensor];
+                allocator.free(offset, tensor->getBytes());
+                released.emplace_back(offset, tensor);
+            }
+            dying.clear();
+        };
+
+        // An element-wise operator may write its output over an input that
+        // dies with it, provided it reads that input at the output's own
+        // positions: same shape and data type, so no broadcast, and no view
+        // or slice shares the block. Planned by level, the input's other
+        // readers must also be in earlier levels.
+        auto inPlaceInput = [&](size_t i) -> TensorObj *
+        {
+            switch (ops[i]->getOpType().underlying())
+            {
+            case OpType::Add:
+            case OpType::Sub:
+            case OpType::Mul:
+            case OpType::Div:
+            case OpType::Relu:
+            case OpType::Clip:
+            case OpType::FusedElementWise:
+                break;
+            default:
+                return nullptr;
+            }
+            auto output = ops[i]->getOutput();
+            if (offsets.count(output.get()) || slices.count(output.get()))
+                return nullptr;
+            for (auto &input : ops[i]->getInputs())
+            {
+                auto it = lastUse.find(input.get());
+                if (it == lastUse.end() || it->second != i ||
+                    !input->getSource() || !offsets.count(input.get()) ||
+                    aliasesOf.count(input.get()) ||
+                    input->getDims() != output->getDims() ||
+                    !(input->getDType() == output->getDType()))
+                    continue;
+                auto readers = input->getTargets();
+                if (!byLevel ||
+                    std::all_of(readers.begin(), readers.end(),
+                                [&](const Operator &reader)
+                                {
+                                    return reader == ops[i] ||
+                                           levelOf[reader.get()] < level[i];
+                                }))
+                    return input.get();
+            }
+            return nullptr;
+        };
+
+        for (size_t i = 0; i < ops.size(); ++i)
+        {
+            if (byLevel && i > 0 && level[i] != level[i - 1])
+                release();
+            if (auto *input = inPlaceInput(i))
+            {
+                // the block is never released and lives on as the output;
+                // the input's other readers must finish before it is
+                // overwritten
+                offsets[ops[i]->getOutput().get()] = offsets[input];
+                lastUse.erase(input);
+                for (auto &reader : input->getTargets())
+                    if (reader != ops[i])
+                        addDep(ops[i], reader.get());
+            }
+            for (auto &output : ops[i]->getOutputs())
+                allocTensor(output, ops[i]);
+            // inputs are released only after the outputs have been placed, so
+            // an operator never writes over what it is still reading
+            for (auto &input : ops[i]->getInputs())
+            {
+                auto *block = blockOf(input.get());
+                auto it = lastUse.find(block);
+                if (it != lastUse.end() && it->second == i &&
+                    block->getSource() && offsets.count(block))
+                {
+                    dying.emplace_back(block);
+                    lastUse.erase(it); // guards repeated inputs
+                }
+            }
+            if (!byLevel)
+                release();
+        }
+
+        auto basePtr = static_cast<uint8_t *>(allocator.getPtr());
+        for (auto &[tensor, offset] : offsets)
+            tensor->setDataBlob(make_ref<BlobObj>(runtime, basePtr + offset));
+        for (auto &[tensor, slice] : slices)
+        {
+            size_t offset = slice.offset;
+            for (auto it = slices.find(slice.concat); it != slices.end();
+                 it = slices.find(it->second.concat))
+                offset += it->second.offset;
+            tensor->setDataBlob(make_ref<BlobObj>(
+                runtime, basePtr + offsets[blockOf(tensor)] + offset));
+        }
+        for (auto &[tensor, view] : views)
+            tensor->setView(view.base->data, view.strides);
         allocator.info();
     }
 
+    const vector<OperatorObj *> &
+    GraphObj::getMemoryDependencies(const OperatorObj *op) const
+    {
+        static const vector<OperatorObj *> none;
+        auto it = memoryDeps.find(op);
+        return it == memoryDeps.end() ? none : it->second;
+    }
+
+    ExecutionPlan GraphObj::compile()
+    {
+        IT_ASSERT(topo_sort() == true);
+        const auto &kernelRegistry = KernelRegistry::getInstance();
+        const size_t n = ops.size();
+        std::unordered_map<const OperatorObj *, size_t> index;
+        for (size_t i = 0; i < n; ++i)
+            index[ops[i].get()] = i;
+
+        vector<ExecutionPlanObj::Instruction> instructions(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            auto &inst = instructions[i];
+            auto kernelAttrs = KernelAttrs{runtime->getDevice(),
+                                           ops[i]->getOpType().underlying()};
+            inst.kernel = kernelRegistry.getKernel(kernelAttrs);
+            inst.launch = inst.kernel->prepare(ops[i], runtime.get());
+            inst.op = ops[i].get();
+            for (auto &succ : ops[i]->getSuccessors())
+                inst.successors.emplace_back(index.at(succ.get()));
+            for (auto *dep : getMemoryDependencies(ops[i].get()))
+                instructions[index.at(dep)].successors.emplace_back(i);
+        }
+        return make_ref<ExecutionPlanObj>(runtime.get(), ops,
+                                          std::move(instructions));
+    }
+
+    ExecutionPlan GraphObj::getPlan()
+    {
+        if (!plan)
+            plan = compile();
+        return plan;
+    }
+
     Tensor GraphObj::addTensor(Shape dim, DataType dtype)
     {
-        return tensors.emplace_back(make_ref<TensorObj>(dim, dtype, runtime));
+        auto tensor = make_ref<TensorObj>(dim, dtype, runtime);
+        tensorSlots[tensor->getFuid()] = tensors.size();
+        return tensors.emplace_back(std::move(tensor));
     }
 
     Tensor GraphObj::addTensor(const Tensor &tensor)
@@ -366,6 +1213,7 @@ namespace infini
                   std::string("Tensor runtime mismatch: cannot add a tenosr in ") +
                       tensor->getRuntime()->toString() + " to " +
                       runtime->toString());
+        tensorSlots[tensor->getFuid()] = tensors.size();
         tensors.emplace_back(tensor);
         return tensor;
     }
@@ -383,39 +1231,43 @@ namespace infini
     // "predecessors" and "successors" of an operator of "ops" must be in "ops".
     bool GraphObj::checkValid() const
     {
+        compact();
+        std::unordered_set<const OperatorObj *> opSet;
+        std::unordered_set<const TensorObj *> tensorSet;
+        for (auto &op : ops)
+            opSet.insert(op.get());
+        for (auto &tensor : tensors)
+            tensorSet.insert(tensor.get());
         for (auto tensor : tensors)
         {
-            IT_ASSERT(!(tensor->getTargets().size() == 0 &&
-                        nullptr == tensor->getSource()));
+            IT_ASSERT(tensor->hasTargets() || tensor->getSource());
             for (auto op : tensor->getTargets())
             {
-                IT_ASSERT(std::find(ops.begin(), ops.end(), op) != ops.end());
+                IT_ASSERT(opSet.count(op.get()));
             }
             auto op = tensor->getSource();
-            IT_ASSERT(!(op && std::find(ops.begin(), ops.end(), op) == ops.end()));
+            IT_ASSERT(!(op && !opSet.count(op.get())));
         }
         for (auto op : ops)
         {
             for (auto tensor : op->getInputs())
             {
-                IT_ASSERT(std::find(tensors.begin(), tensors.end(), tensor) !=
-                          tensors.end());
+                IT_ASSERT(tensorSet.count(tensor.get()));
             }
             for (auto tensor : op->getOutputs())
             {
-                IT_ASSERT(std::find(tensors.begin(), tensors.end(), tensor) !=
-                          tensors.end());
+                IT_ASSERT(tensorSet.count(tensor.get()));
             }
             for (auto pre : op->getPredecessors())
             {
-                IT_ASSERT(std::find(ops.begin(), ops.end(), pre) != ops.end());
+                IT_ASSERT(opSet.count(pre.get()));
             }
             for (auto suc : op->getSuccessors())
             {
-                IT_ASSERT(std::find(ops.begin(), ops.end(), suc) != ops.end());
+                IT_ASSERT(opSet.count(suc.get()));
             }
         }
-        std::set<UidBaseType> s;
+        std::unordered_set<UidBaseType> s;
         // check whether two tensors with the same FUID exist
         for (auto tensor : tensors)
         {
@@ -0,0 +1,785 @@
+#include "core/onnx.h"
+#include "operators/concat.h"
+#include "operators/element_wise.h"
+#include "operators/matmul.h"
+#include "operators/transpose.h"
+#include "operators/unary.h"
+#include "utils/mapped_file.h"
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <string_view>
+
+namespace infini
+{
+    namespace
+    {
+        // Protocol buffers wire format: a message is a sequence of fields,
+        // each a varint key (field number << 3 | wire type) and a value.
+        enum Wire
+        {
+            Varint = 0,
+            Fixed64 = 1,
+            Bytes = 2,
+            Fixed32 = 5,
+        };
+
+        class ProtoReader
+        {
+        public:
+            explicit ProtoReader(std::string_view bytes)
+                : p(bytes.data()), end(bytes.data() + bytes.size()) {}
+
+            // moves to the next field, false at the end of the message
+            bool next()
+            {
+                if (p == end)
+                    return false;
+                uint64_t key = varint();
+                field = key >> 3;
+                wire = key & 7;
+                return true;
+            }
+
+            uint64_t varint()
+            {
+                uint64_t value = 0;
+                for (int shift = 0;; shift += 7)
+                {
+                    need(1);
+                    IT_ASSERT(shift < 64, "Bad varint in ONNX protobuf");
+                    uint8_t b = *p++;
+                    value |= uint64_t(b & 0x7f) << shift;
+                    if (!(b & 0x80))
+                        return value;
+                }
+            }
+
+            int64_t int64()
+            {
+                expect(Varint);
+                return varint();
+            }
+
+            std::string_view bytes()
+            {
+                expect(Bytes);
+                uint64_t n = varint();
+                need(n);
+                std::string_view value(p, n);
+                p += n;
+                return value;
+            }
+
+            string str() { return string(bytes()); }
+
+            float f32()
+            {
+                expect(Fixed32);
+                return fixed<float>();
+            }
+
+            double f64()
+            {
+                expect(Fixed64);
+                return fixed<double>();
+            }
+
+            // repeated scalars, packed or one per field
+            void ints(vector<int64_t> &out)
+            {
+                if (wire != Bytes)
+                    out.emplace_back(int64());
+                else
+                    for (ProtoReader r(bytes()); r.p != r.end;)
+                        out.emplace_back(r.varint());
+            }
+
+            void floats(vector<float> &out)
+            {
+                if (wire != Bytes)
+                    out.emplace_back(f32());
+                else
+                    for (ProtoReader r(bytes()); r.p != r.end;)
+                        out.emplace_back(r.fixed<float>());
+            }
+
+            void skip()
+            {
+                switch (wire)
+                {
+                case Varint:
+                    varint();
+                    break;
+                case Fixed64:
+                    need(8);
+                    p += 8;
+                    break;
+                case Bytes:
+                    bytes();
+                    break;
+                case Fixed32:
+                    need(4);
+                    p += 4;
+                    break;
+                default:
+                    IT_ASSERT(false, "Malformed ONNX protobuf: wire type " +
+                                         std::to_string(wire));
+                }
+            }
+
+            int field = 0, wire = 0;
+
+        private:
+            const char *p, *end;
+
+            void need(size_t n) const
+            {
+                IT_ASSERT(n <= size_t(end - p), "Truncated ONNX protobuf");
+            }
+
+            void expect(int w) const
+            {
+                IT_ASSERT(wire == w, "Unexpected wire type " +
+                                         std::to_string(wire) + " for field " +
+                                         std::to_string(field));
+            }
+
+            template <typename T>
+            T fixed()
+            {
+                need(sizeof(T));
+                T value;
+                std::memcpy(&value, p, sizeof(T));
+                p += sizeof(T);
+                return value;
+            }
+        };
+
+        // TensorProto. Payloads stay views into the mapped file when the
+        // format stores them as plain little-endian arrays.
+        struct OnnxTensor
+        {
+            string name;
+            int dtype = 0;
+            vector<int64_t> dims;
+            // raw_data, or packed float_data / double_data
+            std::string_view raw;
+            // int32_data, int64_data or uint64_data
+            vector<int64_t> ints;
+            // float_data / double_data written one per field
+            vector<float> floats;
+            vector<double> doubles;
+            bool external = false;
+        };
+
+        struct OnnxValue
+        {
+            string name;
+            int dtype = 0;
+            bool hasShape = false;
+            // dim_value, or dim_param with value -1
+            vector<pair<int64_t, string>> dims;
+        };
+
+        struct OnnxAttribute
+        {
+            float f = 0;
+            int64_t i = 0;
+            std::string_view t;
+            vector<float> floats;
+            vector<int64_t> ints;
+        };
+
+        struct OnnxNode
+        {
+            string opType, domain;
+            vector<string> inputs, outputs;
+            map<string, OnnxAttribute> attributes;
+
+            const OnnxAttribute *attribute(const string &name) const
+            {
+                auto it = attributes.find(name);
+                return it == attributes.end() ? nullptr : &it->second;
+            }
+        };
+
+        struct OnnxGraph
+        {
+            vector<OnnxNode> nodes;
+            vector<OnnxTensor> initializers;
+            vector<OnnxValue> inputs, outputs;
+        };
+
+        OnnxTensor parseTensor(std::string_view bytes)
+        {
+            OnnxTensor t;
+            for (ProtoReader r(bytes); r.next();)
+                switch (r.field)
+                {
+                case 1: // dims
+                    r.ints(t.dims);
+                    break;
+                case 2: // data_type
+                    t.dtype = r.int64();
+                    break;
+                case 4: // float_data
+                case 10: // double_data
+                    if (r.wire == Bytes && t.raw.empty())
+                        t.raw = r.bytes();
+                    else if (r.field == 4)
+                        r.floats(t.floats);
+                    else if (r.wire == Bytes)
+                        IT_TODO_HALT_MSG("Split double_data in " + t.name);
+                    else
+                        t.doubles.emplace_back(r.f64());
+                    break;
+                case 5: // int32_data
+                case 7: // int64_data
+                case 11: // uint64_data
+                    r.ints(t.ints);
+                    break;
+                case 8: // name
+                    t.name = r.str();
+                    break;
+                case 9: // raw_data
+                    t.raw = r.bytes();
+                    break;
+                case 14: // data_location
+                    t.external = r.int64() == 1;
+                    break;
+                default:
+                    r.skip();
+                }
+            return t;
+        }
+
+        OnnxValue parseValue(std::string_view bytes)
+        {
+            OnnxValue v;
+            for (ProtoReader r(bytes); r.next();)
+            {
+                if (r.field == 1) // name
+                {
+                    v.name = r.str();
+                    continue;
+                }
+                if (r.field != 2) // type
+                {
+                    r.skip();
+                    continue;
+                }
+                for (ProtoReader type(r.bytes()); type.next();)
+                {
+                    if (type.field != 1) // tensor_type
+                    {
+                        type.skip();
+                        continue;
+                    }
+                    for (ProtoReader tensor(type.bytes()); tensor.next();)
+                    {
+                        if (tensor.field == 1) // elem_type
+                            v.dtype = tensor.int64();
+                        else if (tensor.field == 2) // shape
+                        {
+                            v.hasShape = true;
+                            for (ProtoReader shape(tensor.bytes());
+                                 shape.next();)
+                            {
+                                if (shape.field != 1) // dim
+                                {
+                                    shape.skip();
+                                    continue;
+                                }
+                                auto &dim = v.dims.emplace_back(-1, "");
+                                for (ProtoReader d(shape.bytes()); d.next();)
+                                    if (d.field == 1) // dim_value
+                                        dim.first = d.int64();
+                                    else if (d.field == 2) // dim_param
+                                        dim.second = d.str();
+                                    else
+                                        d.skip();
+                            }
+                        }
+                        else
+                            tensor.skip();
+                    }
+                }
+            }
+            return v;
+        }
+
+        OnnxNode parseNode(std::string_view bytes)
+        {
+            OnnxNode node;
+            for (ProtoReader r(bytes); r.next();)
+                switch (r.field)
+                {
+                case 1:
+                    node.inputs.emplace_back(r.str());
+                    break;
+                case 2:
+                    node.outputs.emplace_back(r.str());
+                    break;
+                case 4:
+                    node.opType = r.str();
+                    break;
+                case 5:
+                {
+                    string name;
+                    OnnxAttribute attr;
+                    for (ProtoReader a(r.bytes()); a.next();)
+                        switch (a.field)
+                        {
+                        case 1:
+                            name = a.str();
+                            break;
+                        case 2:
+                            attr.f = a.f32();
+                            break;
+                        case 3:
+                            attr.i = a.int64();
+                            break;
+                        case 5:
+                            attr.t = a.bytes();
+                            break;
+                        case 7:
+                            a.floats(attr.floats);
+                            break;
+                        case 8:
+                            a.ints(attr.ints);
+                            break;
+                        default:
+                            a.skip();
+                        }
+                    node.attributes[name] = std::move(attr);
+                    break;
+                }
+                case 7:
+                    node.domain = r.str();
+                    break;
+                default:
+                    r.skip();
+                }
+            return node;
+        }
+
+        OnnxGraph parseModel(const MappedFile &file, const string &path)
+        {
+            OnnxGraph g;
+            bool found = false;
+            for (ProtoReader model({file.data, file.size}); model.next();)
+            {
+                if (model.field != 7) // graph
+                {
+                    model.skip();
+                    continue;
+                }
+                found = true;
+                for (ProtoReader r(model.bytes()); r.next();)
+                    switch (r.field)
+                    {
+                    case 1:
+                        g.nodes.emplace_back(parseNode(r.bytes()));
+                        break;
+                    case 5:
+                        g.initializers.emplace_back(parseTensor(r.bytes()));
+                        break;
+                    case 11:
+                        g.inputs.emplace_back(parseValue(r.bytes()));
+                        break;
+                    case 12:
+                        g.outputs.emplace_back(parseValue(r.bytes()));
+                        break;
+                    default:
+                        r.skip();
+                    }
+            }
+            IT_ASSERT(found, path + " has no ONNX graph");
+            return g;
+        }
+
+        bool isSupported(const OnnxNode &node)
+        {
+            static const std::unordered_set<string> ops{
+                "MatMul", "Gemm", "Add", "Sub", "Mul", "Div", "Relu",
+                "Clip", "Cast", "Concat", "Transpose", "Identity",
+                "Constant"};
+            return (node.domain.empty() || node.domain == "ai.onnx") &&
+                   ops.count(node.opType);
+        }
+
+        map<string, int> countUnsupported(const OnnxGraph &g)
+        {
+            map<string, int> counts;
+            for (auto &node : g.nodes)
+                if (!isSupported(node))
+                    ++counts[node.domain.empty()
+                                 ? node.opType
+                                 : node.domain + ":" + node.opType];
+            return counts;
+        }
+
+        DataType dataTypeOf(int onnxType, const string &name)
+        {
+            // DataType indices are the ONNX element types
+            IT_ASSERT(onnxType > 0 && onnxType <= 16 &&
+                          onnxType != DataType::String.getIndex() &&
+                          DataType(onnxType).getSize() > 0,
+                      "Unsupported ONNX element type " +
+                          std::to_string(onnxType) + " of " + name);
+            return DataType(onnxType);
+        }
+
+        template <typename T, typename S>
+        void store(void *dst, const vector<S> &src)
+        {
+            auto *out = static_cast<T *>(dst);
+            for (size_t i = 0; i < src.size(); ++i)
+                out[i] = static_cast<T>(src[i]);
+        }
+
+        void bindWeight(const Tensor &tensor, const OnnxTensor &src,
+                        const MappedFile &file, const Runtime &runtime)
+        {
+            IT_ASSERT(!src.external,
+                      "External data of " + src.name + " is not supported");
+            size_t bytes = tensor->getBytes();
+            size_t elemSize = tensor->getDType().getSize();
+            if (!src.raw.empty())
+            {
+                IT_ASSERT(src.raw.size() == bytes,
+                          src.name + " holds " +
+                              std::to_string(src.raw.size()) +
+                              " bytes instead of " + std::to_string(bytes));
+                if (reinterpret_cast<uintptr_t>(src.raw.data()) % elemSize ==
+                    0)
+                {
+                    tensor->setDataBlob(make_ref<BlobObj>(
+                        runtime, const_cast<char *>(src.raw.data()),
+                        file.mapping));
+                    return;
+                }
+            }
+
+            // misaligned or varint-encoded: a 64-byte aligned copy
+            size_t capacity = (std::max<size_t>(bytes, 1) + 63) / 64 * 64;
+            void *buf = std::aligned_alloc(64, capacity);
+            IT_ASSERT(buf != nullptr);
+            Ref<void> owner(buf, std::free);
+            tensor->setDataBlob(make_ref<BlobObj>(runtime, buf, owner));
+            if (!src.raw.empty())
+            {
+                std::memcpy(buf, src.raw.data(), bytes);
+                return;
+            }
+            size_t n = tensor->size();
+            auto check = [&](size_t count)
+            {
+                IT_ASSERT(count == n, src.name + " holds " +
+                                          std::to_string(count) +
+                                          " values instead of " +
+                                          std::to_string(n));
+            };
+            auto dtype = tensor->getDType();
+            if (dtype == DataType::Float32)
+            {
+                check(src.floats.size());
+                store<float>(buf, src.floats);
+            }
+            else if (dtype == DataType::Double)
+            {
+                check(src.doubles.size());
+                store<double>(buf, src.doubles);
+            }
+            else
+            {
+                check(src.ints.size());
+                switch (elemSize)
+                {
+                // int32_data holds 8 and 16-bit types, including the bits
+                // of float16 / bfloat16, widened to int32
+                case 1:
+                    store<uint8_t>(buf, src.ints);
+                    break;
+                case 2:
+                    store<uint16_t>(buf, src.ints);
+                    break;
+                case 4:
+                    store<uint32_t>(buf, src.ints);
+                    break;
+                default:
+                    store<uint64_t>(buf, src.ints);
+                }
+            }
+        }
+
+        // Constant nodes carry a tensor or a scalar / list attribute.
+        OnnxTensor constantOf(const OnnxNode &node)
+        {
+            OnnxTensor t;
+            if (auto *a = node.attribute("value"))
+                t = parseTensor(a->t);
+            else if (auto *a = node.attribute("value_float"))
+            {
+                t.dtype = DataType::Float32.getIndex();
+                t.floats = {a->f};
+            }
+            else if (auto *a = node.attribute("value_floats"))
+            {
+                t.dtype = DataType::Float32.getIndex();
+                t.floats = a->floats;
+                t.dims = {(int64_t)a->floats.size()};
+            }
+            else if (auto *a = node.attribute("value_int"))
+            {
+                t.dtype = DataType::Int64.getIndex();
+                t.ints = {a->i};
+            }
+            else
+            {
+                auto *ints = node.attribute("value_ints");
+                IT_ASSERT(ints, "Unsupported Constant " + node.outputs.at(0));
+                t.dtype = DataType::Int64.getIndex();
+                t.ints = ints->ints;
+                t.dims = {(int64_t)ints->ints.size()};
+            }
+            t.name = node.outputs.at(0);
+            return t;
+        }
+
+        float scalarOf(const OnnxTensor &t)
+        {
+            IT_ASSERT(t.dtype == DataType::Float32.getIndex(),
+                      t.name + " is not a float scalar");
+            if (!t.floats.empty())
+                return t.floats[0];
+            IT_ASSERT(t.raw.size() >= sizeof(float),
+                      t.name + " is not a float scalar");
+            float value;
+            std::memcpy(&value, t.raw.data(), sizeof(float));
+            return value;
+        }
+
+        optional<CastType> castTypeOf(DataType from, DataType to)
+        {
+            for (int c = 0; c <= enum_to_underlying(CastType::Float2Float);
+                 ++c)
+                if (CastObj::getInputDataType(CastType(c)) == from &&
+                    CastObj::getOutputDataType(CastType(c)) == to)
+                    return CastType(c);
+            return std::nullopt;
+        }
+    } // namespace
+
+    map<string, int> unsupportedOnnxOps(const string &path)
+    {
+        auto file = mapFile(path);
+        return countUnsupported(parseModel(file, path));
+    }
+
+    OnnxModel importOnnx(Runtime runtime, const string &path,
+                         const map<string, int> &dimValues)
+    {
+        auto file = mapFile(path);
+        auto model = parseModel(file, path);
+        if (auto unsupported = countUnsupported(model); !unsupported.empty())
+        {
+            string msg = "Unsupported ONNX operators in " + path + ":";
+            for (auto &[op, count] : unsupported)
+                msg += " " + op + " x" + std::to_string(count);
+            IT_TODO_HALT_MSG(msg);
+        }
+
+        Graph g = make_ref<GraphObj>(runtime);
+        // Constant outputs live next to the initializers
+        std::deque<OnnxTensor> constants;
+        std::unordered_map<string, const OnnxTensor *> initializers;
+        for (auto &t : model.initializers)
+            initializers[t.name] = &t;
+        std::unordered_map<string, const OnnxValue *> inputs;
+        for (auto &v : model.inputs)
+            inputs[v.name] = &v;
+
+        // tensors are added when first read, so that unused initializers
+        // and inputs do not dangle in the graph
+        std::unordered_map<string, Tensor> names;
+        auto tensorOf = [&](const string &name) -> Tensor
+        {
+            if (auto it = names.find(name); it != names.end())
+                return it->second;
+            Tensor tensor;
+            if (auto it = initializers.find(name); it != initializers.end())
+            {
+                auto &src = *it->second;
+                Shape dims(src.dims.begin(), src.dims.end());
+                tensor = g->addTensor(dims, dataTypeOf(src.dtype, name));
+                tensor->setWeight();
+                bindWeight(tensor, src, file, runtime);
+            }
+            else
+            {
+                auto input = inputs.find(name);
+                IT_ASSERT(input != inputs.end(),
+                          "Undefined ONNX tensor " + name);
+                auto &value = *input->second;
+                IT_ASSERT(value.hasShape, "Input " + name + " has no shape");
+                Shape dims;
+                for (auto &[dim, param] : value.dims)
+                {
+                    if (dim >= 0)
+                    {
+                        dims.emplace_back(dim);
+                        continue;
+                    }
+                    auto d = dimValues.find(param);
+                    IT_ASSERT(d != dimValues.end(), "No value for dim \"" +
+                                                        param + "\" of input " +
+                                                        name);
+                    dims.emplace_back(d->second);
+                }
+                tensor = g->addTensor(dims, dataTypeOf(value.dtype, name));
+            }
+            return names[name] = tensor;
+        };
+        auto constantOfInput = [&](const string &name) -> const OnnxTensor &
+        {
+            auto it = initializers.find(name);
+            IT_ASSERT(it != initializers.end(), name + " is not a constant");
+            return *it->second;
+        };
+
+        for (auto &node : model.nodes)
+        {
+            auto &type = node.opType;
+            IT_ASSERT(node.outputs.size() == 1,
+                      type + " with " + std::to_string(node.outputs.size()) +
+                          " outputs");
+            auto &name = node.outputs[0];
+            auto has = [&](size_t i)
+            { return i < node.inputs.size() && !node.inputs[i].empty(); };
+            auto in = [&](size_t i)
+            {
+                IT_ASSERT(has(i), type + " " + name + " lacks input " +
+                                      std::to_string(i));
+                return tensorOf(node.inputs[i]);
+            };
+            auto intAttr = [&](const char *attr, int64_t fallback)
+            {
+                auto *a = node.attribute(attr);
+                return a ? a->i : fallback;
+            };
+
+            Operator op;
+            if (type == "Constant")
+            {
+                initializers[name] = &constants.emplace_back(constantOf(node));
+                continue;
+            }
+            else if (type == "Identity")
+            {
+                names[name] = in(0);
+                continue;
+            }
+            else if (type == "Add")
+                op = g->addOp<AddObj>(in(0), in(1), nullptr);
+            else if (type == "Sub")
+                op = g->addOp<SubObj>(in(0), in(1), nullptr);
+            else if (type == "Mul")
+                op = g->addOp<MulObj>(in(0), in(1), nullptr);
+            else if (type == "Div")
+                op = g->addOp<DivObj>(in(0), in(1), nullptr);
+            else if (type == "Relu")
+                op = g->addOp<ReluObj>(in(0), nullptr);
+            else if (type == "MatMul")
+                op = g->addOp<MatmulObj>(in(0), in(1), nullptr);
+            else if (type == "Gemm")
+            {
+                auto *alpha = node.attribute("alpha");
+                auto *beta = node.attribute("beta");
+                IT_ASSERT((!alpha || alpha->f == 1.f) &&
+                              (!beta || beta->f == 1.f),
+                          "Gemm " + name + " with alpha or beta != 1");
+                bool transA = intAttr("transA", 0);
+                bool transB = intAttr("transB", 0);
+                auto a = in(0), b = in(1);
+                Tensor c = has(2) ? in(2) : nullptr;
+                // a row of n folds into the MatMul as its bias
+                bool bias = false;
+                if (c)
+                {
+                    auto dims = c->getDims();
+                    auto n = b->getDims().at(transB ? 0 : 1);
+                    bias = !dims.empty() && dims.back() == n &&
+                           std::all_of(dims.begin(), dims.end() - 1,
+                                       [](int d) { return d == 1; });
+                }
+                op = g->addOp<MatmulObj>(a, b, nullptr, transA, transB,
+                                         bias ? c : nullptr);
+                if (c && !bias)
+                    op = g->addOp<AddObj>(op->getOutput(), c, nullptr);
+            }
+            else if (type == "Clip")
+            {
+                // attributes before opset 11, optional inputs since
+                std::optional<float> min, max;
+                if (auto *a = node.attribute("min"))
+                    min = a->f;
+                if (auto *a = node.attribute("max"))
+                    max = a->f;
+                if (has(1))
+                    min = scalarOf(constantOfInput(node.inputs[1]));
+                if (has(2))
+                    max = scalarOf(constantOfInput(node.inputs[2]));
+                op = g->addOp<ClipObj>(in(0), nullptr, min, max);
+            }
+            else if (type == "Cast")
+            {
+                auto input = in(0);
+                auto from = input->getDType();
+                auto to = dataTypeOf(intAttr("to", 0), name);
+                if (from == to)
+                {
+                    names[name] = input;
+                    continue;
+                }
+                auto castType = castTypeOf(from, to);
+                IT_ASSERT(castType, "Cast from " + from.toString() + " to " +
+                                        to.toString() + " is not supported");
+                op = g->addOp<CastObj>(input, nullptr, *castType);
+            }
+            else if (type == "Concat")
+            {
+                IT_ASSERT(node.attribute("axis"), "Concat without axis");
+                TensorVec inputs;
+                for (size_t i = 0; i < node.inputs.size(); ++i)
+                    inputs.emplace_back(in(i));
+                op = g->addOp<ConcatObj>(inputs, nullptr,
+                                         intAttr("axis", 0));
+            }
+            else if (type == "Transpose")
+            {
+                auto input = in(0);
+                vector<int> permute(input->getRank());
+                if (auto *perm = node.attribute("perm"))
+                    permute.assign(perm->ints.begin(), perm->ints.end());
+                else
+                    for (size_t i = 0; i < permute.size(); ++i)
+                        permute[i] = permute.size() - 1 - i;
+                op = g->addOp<TransposeObj>(input, nullptr, permute);
+            }
+            else
+                IT_TODO_HALT_MSG("Unsupported ONNX operator " + type);
+            names[name] = op->getOutput();
+        }
+
+        OnnxModel result{g, {}, {}};
+        for (auto &value : model.inputs)
+            if (!initializers.count(value.name) && names.count(value.name))
+                result.inputs.emplace_back(value.name, names[value.name]);
+        for (auto &value : model.outputs)
+            result.outputs.emplace_back(value.name, tensorOf(value.name));
+        return result;
+    }
+
+} // namespace infini
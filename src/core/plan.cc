@@ -0,0 +1,40 @@
+#include "core/plan.h"
+#include <algorithm>
+
+namespace infini
+{
+    ExecutionPlanObj::ExecutionPlanObj(const RuntimeObj *runtime, OpVec ops,
+                                       vector<Instruction> instructions)
+        : runtime(runtime), ops(std::move(ops)),
+          instructions(std::move(instructions))
+    {
+        for (auto &inst : this->instructions)
+            inst.numPredecessors = 0;
+        for (auto &inst : this->instructions)
+        {
+            auto &s = inst.successors;
+            std::sort(s.begin(), s.end());
+            s.erase(std::unique(s.begin(), s.end()), s.end());
+            for (auto j : s)
+            {
+                IT_ASSERT(j < this->instructions.size());
+                ++this->instructions[j].numPredecessors;
+            }
+        }
+    }
+
+    string ExecutionPlanObj::toString() const
+    {
+        std::ostringstream oss;
+        oss << "Execution plan, " << instructions.size() << " instructions:\n";
+        for (size_t i = 0; i < instructions.size(); ++i)
+        {
+            const auto &inst = instructions[i];
+            oss << "#" << i << " OP " << inst.op->getGuid();
+            oss << ", succ " << vecToString(inst.successors);
+            oss << ", " << inst.op->toString() << "\n";
+        }
+        return oss.str();
+    }
+
+} // namespace infini
@@ -0,0 +1,491 @@
+#include "core/plan_cache.h"
+#include "core/kernel.h"
+#include "core/serialize.h"
+#include "utils/mapped_file.h"
+#include <cstring>
+#include <fstream>
+#include <queue>
+#include <string_view>
+
+namespace infini
+{
+    namespace
+    {
+        constexpr char MAGIC[8] = {'I', 'T', 'P', 'L', 'A', 'N', 'C', '\0'};
+        constexpr uint32_t PLAN_FILE_VERSION = 2;
+
+        struct Canonical
+        {
+            string bytes;
+            TensorVec tensors; // by canonical id
+        };
+
+        /**
+         * Describes the graph independently of object identities: operators
+         * in a topological order that depends only on the order they were
+         * added in, tensors numbered by first use, each with its shape,
+         * data type and flags. Tensors no operator touches come last.
+         */
+        Canonical canonicalize(const GraphObj &g)
+        {
+            const auto &ops = g.getOperators();
+            std::unordered_map<const OperatorObj *, size_t> pending;
+            std::queue<Operator> ready;
+            for (auto &op : ops)
+            {
+                size_t n = 0;
+                for (auto &input : op->getInputs())
+                    n += input->getSource() != nullptr;
+                if (n == 0)
+                    ready.push(op);
+                else
+                    pending[op.get()] = n;
+            }
+
+            Canonical c;
+            ByteWriter w;
+            std::unordered_map<const TensorObj *, uint32_t> id;
+            auto idOf = [&](const Tensor &t)
+            {
+                auto [it, inserted] = id.try_emplace(t.get(), id.size());
+                if (inserted)
+                    c.tensors.emplace_back(t);
+                return it->second;
+            };
+            size_t visited = 0;
+            for (; !ready.empty(); ready.pop(), ++visited)
+            {
+                auto &op = ready.front();
+                w.put<uint16_t>(op->getOpType().underlying());
+                for (auto *list : {&op->getInputs(), &op->getOutputs()})
+                {
+                    w.put<uint32_t>(list->size());
+                    for (auto &tensor : *list)
+                        w.put<uint32_t>(idOf(tensor));
+                }
+                encodeAttributes(op, w);
+                // one decrement per input slot, as targets repeat alike
+                for (auto &output : op->getOutputs())
+                    for (auto &target : output->getTargets())
+                        if (--pending.at(target.get()) == 0)
+                            ready.push(target);
+            }
+            IT_ASSERT(visited == ops.size(), "The graph has a cycle");
+
+            for (auto &tensor : g.getTensors())
+                idOf(tensor);
+            w.put<uint32_t>(c.tensors.size());
+            for (auto &tensor : c.tensors)
+            {
+                auto dims = tensor->getDims();
+                w.put<int32_t>(tensor->getDType().getIndex());
+                w.put<uint32_t>(dims.size());
+                for (int d : dims)
+                    w.put<int32_t>(d);
+                w.put<uint8_t>(tensor->isWeight());
+                w.put<uint8_t>(tensor->hasExternalData());
+            }
+            c.bytes = std::move(w.buf);
+            return c;
+        }
+
+        uint64_t fnv1a(std::string_view bytes)
+        {
+            uint64_t h = 0xcbf29ce484222325ull;
+            for (unsigned char b : bytes)
+                h = (h ^ b) * 0x100000001b3ull;
+            return h;
+        }
+
+        /**
+         * The values optimize() folds constants from, which the structure
+         * does not capture: a digest of every constant read by an operator
+         * whose inputs are all constants or results of such operators, in
+         * canonical order.
+         */
+        string constantDigests(GraphObj &g, const Canonical &c)
+        {
+            IT_ASSERT(g.topo_sort() == true);
+            std::unordered_set<const TensorObj *> computed, read;
+            for (auto &op : g.getOperators())
+            {
+                auto &inputs = op->getInputs();
+                if (!std::all_of(inputs.begin(), inputs.end(),
+                                 [&](const Tensor &t) {
+                                     return t->isConstant() ||
+                                            computed.count(t.get());
+                                 }))
+                    continue;
+                for (auto &input : inputs)
+                    if (input->isConstant())
+                        read.insert(input.get());
+                for (auto &output : op->getOutputs())
+                    computed.insert(output.get());
+            }
+            ByteWriter w;
+            for (auto &tensor : c.tensors)
+                if (read.count(tensor.get()))
+                    w.put<uint64_t>(fnv1a(std::string_view(
+                        tensor->getRawDataPtr<char *>(), tensor->getBytes())));
+            return std::move(w.buf);
+        }
+
+    } // namespace
+
+    uint64_t hashGraph(const Graph &graph)
+    {
+        return fnv1a(canonicalize(*graph).bytes);
+    }
+
+    PlanCache &PlanCache::getInstance()
+    {
+        static PlanCache instance;
+        return instance;
+    }
+
+    bool PlanCache::prepare(const Graph &graph)
+    {
+        GraphObj &g = *graph;
+        auto c = canonicalize(g);
+        string key = std::move(c.bytes);
+        key += constantDigests(g, c);
+        // the memory plan differs when operators run concurrently
+        key += char(g.runtime->getDevice());
+        key += char(g.runtime->getInterOpThreads() > 1);
+        uint64_t hash = fnv1a(key);
+
+        Ref<const CachedPlan> plan;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = entries.find(hash);
+            if (it != entries.end() && it->second->key == key)
+                plan = it->second;
+        }
+        if (plan)
+        {
+            apply(g, *plan, c.tensors);
+            return true;
+        }
+
+        std::unordered_set<const TensorObj *> given;
+        for (auto &tensor : c.tensors)
+            if (tensor->isConstant())
+                given.insert(tensor.get());
+        g.optimize();
+        g.shape_infer();
+        g.dataMalloc();
+        auto entry = record(g, std::move(key), c.tensors, given);
+        std::lock_guard<std::mutex> lock(mutex);
+        // on a hash collision the first entry stays
+        entries.try_emplace(hash, std::move(entry));
+        return false;
+    }
+
+    Ref<PlanCache::CachedPlan>
+    PlanCache::record(GraphObj &g, string key, const TensorVec &canonical,
+                      const std::unordered_set<const TensorObj *> &given)
+    {
+        auto plan = make_ref<CachedPlan>();
+        plan->key = std::move(key);
+        std::unordered_map<const TensorObj *, int32_t> canonicalId;
+        for (size_t i = 0; i < canonical.size(); ++i)
+            canonicalId[canonical[i].get()] = i;
+        std::unordered_map<const TensorObj *, uint32_t> index;
+        std::unordered_map<const uint8_t *, int32_t> owner;
+        auto base = static_cast<uint8_t *>(g.allocator.getPtr());
+        for (auto &tensor : g.tensors)
+        {
+            index[tensor.get()] = plan->tensors.size();
+            auto it = canonicalId.find(tensor.get());
+            auto &tp = plan->tensors.emplace_back();
+            tp.canonical = it == canonicalId.end() ? -1 : it->second;
+            tp.dims = tensor->getDims();
+            tp.dtype = tensor->getDType().getIndex();
+            tp.arenaOffset = tp.base = -1;
+            tp.offset = tensor->getOffset();
+            if (!tensor->hasData() || !tensor->isContiguous())
+                continue;
+            auto ptr = tensor->getRawDataPtr<uint8_t *>();
+            owner.try_emplace(ptr, index[tensor.get()]);
+            if (!tensor->hasExternalData())
+                tp.arenaOffset = ptr - base;
+            // a constant optimize() computed: the graph it is applied to
+            // has no data for it
+            else if (tensor->isConstant() && !given.count(tensor.get()))
+                tp.data.assign(reinterpret_cast<char *>(ptr),
+                               tensor->getBytes());
+        }
+        // views share the blob of a dense tensor, which may be external
+        for (auto &tensor : g.tensors)
+        {
+            if (!tensor->hasData() || tensor->isContiguous())
+                continue;
+            auto &tp = plan->tensors[index[tensor.get()]];
+            tp.base = owner.at(tensor->getRawDataPtr<uint8_t *>() -
+                               tensor->getOffset());
+            tp.strides = tensor->getStrides();
+        }
+
+        const auto &registry = KernelRegistry::getInstance();
+        std::unordered_map<const OperatorObj *, uint32_t> opIndex;
+        for (auto &op : g.ops)
+        {
+            opIndex[op.get()] = plan->ops.size();
+            auto &opPlan = plan->ops.emplace_back();
+            opPlan.type = op->getOpType().underlying();
+            ByteWriter w;
+            encodeAttributes(op, w);
+            opPlan.attributes = std::move(w.buf);
+            for (auto &t : op->getInputs())
+                opPlan.inputs.emplace_back(index.at(t.get()));
+            for (auto &t : op->getOutputs())
+                opPlan.outputs.emplace_back(index.at(t.get()));
+            opPlan.kernel = std::get<1>(registry.getKernelItem(
+                KernelAttrs{g.runtime->getDevice(), opPlan.type}));
+        }
+        for (auto &op : g.ops)
+            for (auto *dep : g.getMemoryDependencies(op.get()))
+                plan->memoryDeps.emplace_back(opIndex.at(op.get()),
+                                              opIndex.at(dep));
+        plan->arenaBytes = g.allocator.getPeak();
+        return plan;
+    }
+
+    void PlanCache::apply(GraphObj &g, const CachedPlan &plan,
+                          const TensorVec &canonical)
+    {
+        for (auto &op : OpVec(g.getOperators()))
+            g.detachOperator(op);
+        g.memoryDeps.clear();
+
+        TensorVec tensors;
+        for (auto &tp : plan.tensors)
+        {
+            IT_ASSERT(tp.canonical < int32_t(canonical.size()),
+                      "Bad tensor in plan cache entry");
+            Tensor t = tp.canonical >= 0
+                           ? canonical[tp.canonical]
+                           : make_ref<TensorObj>(tp.dims, DataType(tp.dtype),
+                                                 g.runtime);
+            if (t->getDims() != tp.dims)
+                t->setShape(tp.dims);
+            if (!tp.data.empty())
+            {
+                t->setConstant();
+                std::memcpy(t->getRawDataPtr<void *>(), tp.data.data(),
+                            tp.data.size());
+            }
+            tensors.emplace_back(std::move(t));
+        }
+        g.tensors = tensors;
+
+        OpVec ops;
+        for (auto &opPlan : plan.ops)
+        {
+            TensorVec in, out;
+            for (auto i : opPlan.inputs)
+                in.emplace_back(tensors[i]);
+            for (auto i : opPlan.outputs)
+                out.emplace_back(tensors[i]);
+            ByteReader r(opPlan.attributes.data(), opPlan.attributes.size(),
+                         "plan cache entry");
+            ops.emplace_back(
+                decodeOperator(r, g, OpType(opPlan.type), in, out));
+        }
+        g.reindex();
+        g.sorted = true;
+        g.plan = nullptr;
+        for (auto &[op, dep] : plan.memoryDeps)
+            g.memoryDeps[ops[op].get()].emplace_back(ops[dep].get());
+
+        uint8_t *base = nullptr;
+        if (plan.arenaBytes > 0)
+        {
+            g.allocator.alloc(plan.arenaBytes);
+            base = static_cast<uint8_t *>(g.allocator.getPtr());
+        }
+        for (size_t i = 0; i < tensors.size(); ++i)
+            if (plan.tensors[i].arenaOffset >= 0)
+                tensors[i]->setDataBlob(make_ref<BlobObj>(
+                    g.runtime, base + plan.tensors[i].arenaOffset));
+        for (size_t i = 0; i < tensors.size(); ++i)
+            if (auto &tp = plan.tensors[i]; tp.base >= 0)
+                tensors[i]->setView(tensors[tp.base]->getDataBlob(),
+                                    tp.strides, tp.offset);
+    }
+
+    bool PlanCache::resolves(const CachedPlan &plan)
+    {
+        auto device = Device(uint8_t(plan.key[plan.key.size() - 2]));
+        const auto &registry = KernelRegistry::getInstance();
+        for (auto &op : plan.ops)
+        {
+            auto *item = registry.findKernelItem(KernelAttrs{device, op.type});
+            if (!item || std::get<1>(*item) != op.kernel)
+                return false;
+        }
+        return true;
+    }
+
+    void PlanCache::save(const string &path) const
+    {
+        ByteWriter w;
+        w.buf.append(MAGIC, sizeof(MAGIC));
+        w.put<uint32_t>(PLAN_FILE_VERSION);
+        std::lock_guard<std::mutex> lock(mutex);
+        w.put<uint32_t>(entries.size());
+        for (auto &[hash, plan] : entries)
+        {
+            w.putString(plan->key);
+            w.put<uint32_t>(plan->tensors.size());
+            for (auto &tp : plan->tensors)
+            {
+                w.put<int32_t>(tp.canonical);
+                w.put<int32_t>(tp.dtype);
+                w.put<uint32_t>(tp.dims.size());
+                for (int d : tp.dims)
+                    w.put<int32_t>(d);
+                w.put<int64_t>(tp.arenaOffset);
+                w.put<int32_t>(tp.base);
+                w.put<uint64_t>(tp.offset);
+                w.put<uint32_t>(tp.strides.size());
+                for (auto s : tp.strides)
+                    w.put<int64_t>(s);
+                w.putString(tp.data);
+            }
+            w.put<uint32_t>(plan->ops.size());
+            for (auto &op : plan->ops)
+            {
+                w.put<uint16_t>(op.type);
+                w.putString(op.attributes);
+                for (auto *list : {&op.inputs, &op.outputs})
+                {
+                    w.put<uint32_t>(list->size());
+                    for (auto i : *list)
+                        w.put<uint32_t>(i);
+                }
+                w.putString(op.kernel);
+            }
+            w.put<uint32_t>(plan->memoryDeps.size());
+            for (auto &[op, dep] : plan->memoryDeps)
+            {
+                w.put<uint32_t>(op);
+                w.put<uint32_t>(dep);
+            }
+            w.put<uint64_t>(plan->arenaBytes);
+        }
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        IT_ASSERT(file.good(), "Cannot open " + path + " for writing");
+        file.write(w.buf.data(), w.buf.size());
+        IT_ASSERT(file.good(), "Failed to write " + path);
+    }
+
+    size_t PlanCache::load(const string &path)
+    {
+        auto file = mapFile(path);
+        IT_ASSERT(file.size >= sizeof(MAGIC) &&
+                      std::memcmp(file.data, MAGIC, sizeof(MAGIC)) == 0,
+                  path + " is not a plan cache file");
+        ByteReader r(file.data, file.size, "plan cache file");
+        r.get<uint64_t>(); // magic
+        auto version = r.get<uint32_t>();
+        IT_ASSERT(version == PLAN_FILE_VERSION,
+                  "Unsupported plan cache version " + std::to_string(version));
+
+        vector<Ref<CachedPlan>> plans(r.getCount(32));
+        for (auto &plan : plans)
+        {
+            plan = make_ref<CachedPlan>();
+            plan->key = r.getString();
+            IT_ASSERT(plan->key.size() >= 2, "Bad key in plan cache file");
+            plan->tensors.resize(r.getCount(32));
+            for (auto &tp : plan->tensors)
+            {
+                tp.canonical = r.get<int32_t>();
+                tp.dtype = r.get<int32_t>();
+                IT_ASSERT(tp.dtype > 0 && tp.dtype < 17 &&
+                              DataType(tp.dtype).getSize() > 0,
+                          "Bad data type in plan cache file");
+                tp.dims.resize(r.getCount(4));
+                for (auto &d : tp.dims)
+                {
+                    d = r.get<int32_t>();
+                    IT_ASSERT(d >= 0, "Bad shape in plan cache file");
+                }
+                tp.arenaOffset = r.get<int64_t>();
+                tp.base = r.get<int32_t>();
+                tp.offset = r.get<uint64_t>();
+                tp.strides.resize(r.getCount(8));
+                for (auto &s : tp.strides)
+                    s = r.get<int64_t>();
+                tp.data = r.getString();
+                IT_ASSERT(tp.base < 0 ||
+                              (tp.arenaOffset < 0 &&
+                               size_t(tp.base) < plan->tensors.size() &&
+                               tp.strides.size() == tp.dims.size()),
+                          "Bad view in plan cache file");
+            }
+            plan->ops.resize(r.getCount(30));
+            for (auto &op : plan->ops)
+            {
+                op.type = r.get<uint16_t>();
+                op.attributes = r.getString();
+                for (auto *list : {&op.inputs, &op.outputs})
+                {
+                    list->resize(r.getCount(4));
+                    for (auto &i : *list)
+                    {
+                        i = r.get<uint32_t>();
+                        IT_ASSERT(i < plan->tensors.size(),
+                                  "Bad tensor index in plan cache file");
+                    }
+                }
+                op.kernel = r.getString();
+            }
+            plan->memoryDeps.resize(r.getCount(8));
+            for (auto &[op, dep] : plan->memoryDeps)
+            {
+                op = r.get<uint32_t>();
+                dep = r.get<uint32_t>();
+                IT_ASSERT(op < plan->ops.size() && dep < plan->ops.size(),
+                          "Bad dependency in plan cache file");
+            }
+            plan->arenaBytes = r.get<uint64_t>();
+            for (auto &tp : plan->tensors)
+            {
+                uint64_t bytes = DataType(tp.dtype).getSize();
+                for (int d : tp.dims)
+                    bytes *= d;
+                IT_ASSERT(tp.arenaOffset < 0 ||
+                              (uint64_t(tp.arenaOffset) <= plan->arenaBytes &&
+                               bytes <= plan->arenaBytes - tp.arenaOffset),
+                          "Tensor out of the arena in plan cache file");
+                IT_ASSERT(tp.data.empty() ||
+                              (tp.arenaOffset < 0 && tp.base < 0 &&
+                               tp.data.size() == bytes),
+                          "Bad constant in plan cache file");
+            }
+        }
+
+        size_t added = 0;
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto &plan : plans)
+            if (resolves(*plan))
+                added += entries.try_emplace(fnv1a(plan->key), plan).second;
+        return added;
+    }
+
+    size_t PlanCache::size() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return entries.size();
+    }
+
+    void PlanCache::clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.clear();
+    }
+
+} // namespace infini
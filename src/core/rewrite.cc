@@ -0,0 +1,79 @@
+#include "core/rewrite.h"
+#include <deque>
+
+namespace infini
+{
+    Pattern &Pattern::input(int index, Pattern producer)
+    {
+        producers.emplace_back(index, std::move(producer));
+        return *this;
+    }
+
+    bool Pattern::match(const Operator &op, OpVec &matched) const
+    {
+        if (op->getOpType() != type || (when && !when(op)))
+            return false;
+        size_t size = matched.size();
+        matched.emplace_back(op);
+        for (auto &[index, producer] : producers)
+        {
+            Operator source;
+            if (index < (int)op->getInputs().size())
+                source = op->getInputs(index)->getSource();
+            if (!source || !producer.match(source, matched))
+            {
+                matched.resize(size);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    size_t applyRewrites(GraphObj &graph, const vector<RewriteRule> &rules)
+    {
+        std::unordered_map<OpType::underlying_t, vector<const RewriteRule *>>
+            byRoot;
+        for (auto &rule : rules)
+            byRoot[rule.pattern.type.underlying()].emplace_back(&rule);
+
+        std::deque<Operator> work;
+        std::unordered_set<const OperatorObj *> queued;
+        auto push = [&](const Operator &op)
+        {
+            if (queued.insert(op.get()).second)
+                work.emplace_back(op);
+        };
+        IT_ASSERT(graph.topo_sort() == true);
+        for (auto &op : graph.getOperators())
+            push(op);
+
+        size_t applied = 0;
+        while (!work.empty())
+        {
+            auto op = std::move(work.front());
+            work.pop_front();
+            queued.erase(op.get());
+            auto it = byRoot.find(op->getOpType().underlying());
+            // removed by an earlier rewrite
+            if (it == byRoot.end() || graph.getOperator(op->getGuid()) != op)
+                continue;
+            for (auto *rule : it->second)
+            {
+                OpVec matched, touched;
+                if (!rule->pattern.match(op, matched))
+                    continue;
+                auto rewrite = rule->rewrite(graph, matched);
+                if (!rewrite ||
+                    !graph.replaceSubgraph(matched, rewrite->add,
+                                           rewrite->replace, &touched))
+                    continue;
+                ++applied;
+                for (auto &t : touched)
+                    push(t);
+                break;
+            }
+        }
+        return applied;
+    }
+
+} // namespace infini
@@ -1,23 +1,192 @@
 #include "core/runtime.h"
 #include "core/blob.h"
-#include "core/kernel.h"
 #include "core/graph.h"
-#include "core/kernel.h"
+#include "core/plan.h"
+#include "utils/profiler.h"
+#include "utils/thread_pool.h"
 #include <chrono>
+#include <cstdlib>
 #include <cstring>
 #include <memory>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 namespace infini
 {
+    NativeCpuRuntimeObj::NativeCpuRuntimeObj() : RuntimeObj(Device::CPU)
+    {
+        if (const char *env = std::getenv("INFINI_INTER_OP_THREADS"))
+            setInterOpThreads(std::atoi(env));
+        if (const char *env = std::getenv("INFINI_PROFILE"); env && *env)
+        {
+            profilePath = env;
+            setProfiling(true);
+        }
+    }
+
+    NativeCpuRuntimeObj::~NativeCpuRuntimeObj()
+    {
+        if (profiler && !profilePath.empty())
+        {
+            if (!profiler->writeChromeTrace(profilePath))
+                std::cerr << "Cannot write the profile to " << profilePath
+                          << std::endl;
+            std::cout << profiler->summary();
+        }
+    }
+
+    void NativeCpuRuntimeObj::setProfiling(bool enable)
+    {
+        if (enable && !profiler)
+            profiler = std::make_unique<Profiler>(device);
+        else if (!enable)
+            profiler = nullptr;
+    }
+
+    void NativeCpuRuntimeObj::setInterOpThreads(int threads)
+    {
+        threads = std::max(threads, 1);
+        if (threads == interOpThreads)
+            return;
+        interOpThreads = threads;
+        pool = threads > 1 ? std::make_unique<ThreadPool>(threads) : nullptr;
+    }
+
     void NativeCpuRuntimeObj::run(const Graph &graph) const
     {
-        const auto &kernelRegistry = KernelRegistry::getInstance();
+        run(graph->getPlan());
+    }
 
-        for (auto &op : graph->getOperators())
+    void NativeCpuRuntimeObj::run(const ExecutionPlan &plan) const
+    {
+        IT_ASSERT(plan->getRuntime() == this);
+        if (pool && plan->size() > 1)
+            return runParallel(*plan);
+        if (profiler)
         {
-            auto kernelAttrs = KernelAttrs{device, op->getOpType().underlying()};
-            Kernel *kernel = kernelRegistry.getKernel(kernelAttrs);
-            kernel->compute(op, this);
+            for (const auto &inst : plan->getInstructions())
+            {
+                int64_t begin = profiler->now();
+                inst.launch();
+                profiler->record(*inst.op, begin, profiler->now(), 0);
+            }
+            return;
         }
+        for (const auto &inst : plan->getInstructions())
+            inst.launch();
+    }
+
+    namespace
+    {
+        // Shared by the tasks of one parallel run. The tasks own it, so the
+        // last one to finish may outlive the wait in runParallel().
+        struct ParallelRun
+        {
+            ThreadPool *pool;
+            Profiler *profiler;
+            // only read before `finished` is set, and not owned, so that a
+            // late task never releases the last reference to the graph's
+            // tensors and with them the runtime
+            const ExecutionPlanObj *plan;
+            size_t size;
+            // predecessors each instruction still waits for
+            std::unique_ptr<std::atomic<int>[]> pending;
+            // OpenMP threads of each operator: an equal share per pool
+            // thread, so that operators running side by side never use
+            // more threads than the caller had
+            int ompThreads = 1;
+            std::atomic<size_t> remaining{0};
+            std::atomic<bool> failed{false};
+
+            std::mutex mutex;
+            std::condition_variable done;
+            bool finished = false;
+            std::exception_ptr error;
+        };
+
+        void execute(const std::shared_ptr<ParallelRun> &run, size_t i)
+        {
+            const size_t n = run->size;
+            const auto &instructions = run->plan->getInstructions();
+            while (true)
+            {
+#ifdef _OPENMP
+                omp_set_num_threads(run->ompThreads);
+#endif
+                // after a failure the remaining operators are only counted
+                try
+                {
+                    if (!run->failed)
+                    {
+                        auto *profiler = run->profiler;
+                        int64_t begin = profiler ? profiler->now() : 0;
+                        instructions[i].launch();
+                        if (profiler)
+                            profiler->record(*instructions[i].op, begin,
+                                             profiler->now(),
+                                             run->pool->workerIndex() + 1);
+                    }
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(run->mutex);
+                    if (!run->failed.exchange(true))
+                        run->error = std::current_exception();
+                }
+
+                // keep one ready successor on this thread, hand out the rest
+                size_t next = n;
+                for (auto j : instructions[i].successors)
+                    if (--run->pending[j] == 0)
+                    {
+                        if (next == n)
+                            next = j;
+                        else
+                            run->pool->submit([run, j] { execute(run, j); });
+                    }
+                if (--run->remaining == 0)
+                {
+                    std::lock_guard<std::mutex> lock(run->mutex);
+                    run->finished = true;
+                    run->done.notify_all();
+                }
+                if (next == n)
+                    return;
+                i = next;
+            }
+        }
+    } // namespace
+
+    void NativeCpuRuntimeObj::runParallel(const ExecutionPlanObj &plan) const
+    {
+        auto run = std::make_shared<ParallelRun>();
+        run->pool = pool.get();
+        run->profiler = profiler.get();
+        run->plan = &plan;
+        const auto &instructions = plan.getInstructions();
+        const size_t n = run->size = instructions.size();
+        run->pending = std::make_unique<std::atomic<int>[]>(n);
+        for (size_t i = 0; i < n; ++i)
+            run->pending[i] = instructions[i].numPredecessors;
+#ifdef _OPENMP
+        run->ompThreads =
+            std::max(1, omp_get_max_threads() / interOpThreads);
+#endif
+        run->remaining = n;
+
+        // the sources are collected first: once submitted they start
+        // decrementing the counters this loop would read
+        vector<size_t> sources;
+        for (size_t i = 0; i < n; ++i)
+            if (run->pending[i] == 0)
+                sources.emplace_back(i);
+        for (auto i : sources)
+            pool->submit([run, i] { execute(run, i); });
+
+        std::unique_lock<std::mutex> lock(run->mutex);
+        run->done.wait(lock, [&] { return run->finished; });
+        if (run->error)
+            std::rethrow_exception(run->error);
     }
 
     string NativeCpuRuntimeObj::toString() const { return "CPU Runtime"; }
@@ -29,8 +198,11 @@ namespace infini
 
     void *NativeCpuRuntimeObj::alloc(size_t size)
     {
-        return calloc((size + sizeof(uint64_t) - 1) / sizeof(uint64_t),
-                      sizeof(uint64_t));
+        // cache-line aligned and zero-filled; released by free() in dealloc
+        size = (size + 63) / 64 * 64;
+        void *ptr = aligned_alloc(64, size == 0 ? 64 : size);
+        IT_ASSERT(ptr != nullptr);
+        return memset(ptr, 0, size);
     }
 
 } // namespace infini
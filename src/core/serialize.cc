@@ -0,0 +1,318 @@
+#include "core/serialize.h"
+#include "operators/concat.h"
+#include "operators/element_wise.h"
+#include "operators/matmul.h"
+#include "operators/transpose.h"
+#include "operators/unary.h"
+#include "utils/mapped_file.h"
+#include "utils/byte_stream.h"
+#include <cstring>
+#include <fstream>
+
+namespace infini
+{
+    namespace
+    {
+        constexpr char MAGIC[8] = {'I', 'T', 'G', 'R', 'A', 'P', 'H', '\0'};
+        constexpr size_t WEIGHT_ALIGN = 64;
+        // magic, version, reserved, weightOffset, weightBytes
+        constexpr size_t HEADER_BYTES = 8 + 4 + 4 + 8 + 8;
+
+        size_t alignUp(size_t n)
+        {
+            return (n + WEIGHT_ALIGN - 1) / WEIGHT_ALIGN * WEIGHT_ALIGN;
+        }
+
+    } // namespace
+
+    void encodeAttributes(const Operator &op, ByteWriter &w)
+    {
+        switch (op->getOpType().underlying())
+        {
+        case OpType::Add:
+        case OpType::Sub:
+        case OpType::Mul:
+        case OpType::Div:
+        case OpType::Relu:
+            break;
+        case OpType::Transpose:
+        {
+            auto permute = as<TransposeObj>(op)->getPermute();
+            w.put<uint32_t>(permute.size());
+            for (int p : permute)
+                w.put<int32_t>(p);
+            break;
+        }
+        case OpType::MatMul:
+        {
+            auto mm = as<MatmulObj>(op);
+            w.put<uint8_t>(mm->getTransA());
+            w.put<uint8_t>(mm->getTransB());
+            w.put<uint8_t>(enum_to_underlying(mm->getActivation()));
+            w.putOptional(mm->getClipMin());
+            w.putOptional(mm->getClipMax());
+            break;
+        }
+        case OpType::Clip:
+        {
+            auto clip = as<ClipObj>(op);
+            w.putOptional(clip->getMin());
+            w.putOptional(clip->getMax());
+            break;
+        }
+        case OpType::Cast:
+            w.put<int32_t>(enum_to_underlying(as<CastObj>(op)->getType()));
+            break;
+        case OpType::Concat:
+            w.put<int32_t>(as<ConcatObj>(op)->getDim());
+            break;
+        case OpType::FusedElementWise:
+        {
+            auto &steps = as<FusedElementWiseObj>(op)->getSteps();
+            w.put<uint32_t>(steps.size());
+            for (auto &step : steps)
+            {
+                w.put<uint16_t>(step.type.underlying());
+                w.put<int32_t>(step.operand);
+                w.put<uint8_t>(step.reversed);
+                w.putOptional(step.min);
+                w.putOptional(step.max);
+            }
+            break;
+        }
+        default:
+            IT_TODO_HALT_MSG(string("Cannot serialize operator ") +
+                             op->getOpType().toString());
+        }
+    }
+
+    Operator decodeOperator(ByteReader &r, GraphObj &g, OpType type,
+                            const TensorVec &in, const TensorVec &out)
+    {
+        auto arity = [&](size_t nIn)
+        {
+            IT_ASSERT(in.size() == nIn && out.size() == 1,
+                      string("Bad arity for ") + type.toString());
+        };
+        switch (type.underlying())
+        {
+#define BINARY(T) \
+    arity(2);     \
+    return g.addOpWithOutputs<T>(in[0], in[1], out[0]);
+        case OpType::Add:
+            BINARY(AddObj)
+        case OpType::Sub:
+            BINARY(SubObj)
+        case OpType::Mul:
+            BINARY(MulObj)
+        case OpType::Div:
+            BINARY(DivObj)
+#undef BINARY
+        case OpType::Relu:
+            arity(1);
+            return g.addOpWithOutputs<ReluObj>(in[0], out[0]);
+        case OpType::Transpose:
+        {
+            arity(1);
+            vector<int> permute(r.getCount(4));
+            for (auto &p : permute)
+                p = r.get<int32_t>();
+            return g.addOpWithOutputs<TransposeObj>(in[0], out[0], permute);
+        }
+        case OpType::MatMul:
+        {
+            IT_ASSERT((in.size() == 2 || in.size() == 3) && out.size() == 1,
+                      "Bad arity for MatMul");
+            bool transA = r.get<uint8_t>(), transB = r.get<uint8_t>();
+            auto act = r.get<uint8_t>();
+            IT_ASSERT(act <= enum_to_underlying(MatmulActivation::Clip));
+            auto min = r.getOptional(), max = r.getOptional();
+            return g.addOpWithOutputs<MatmulObj>(
+                in[0], in[1], out[0], transA, transB,
+                in.size() > 2 ? in[2] : nullptr, MatmulActivation(act), min,
+                max);
+        }
+        case OpType::Clip:
+        {
+            arity(1);
+            auto min = r.getOptional(), max = r.getOptional();
+            return g.addOpWithOutputs<ClipObj>(in[0], out[0], min, max);
+        }
+        case OpType::Cast:
+        {
+            arity(1);
+            auto castType = r.get<int32_t>();
+            IT_ASSERT(castType >= 0 &&
+                      castType <= enum_to_underlying(CastType::Float2Float));
+            return g.addOpWithOutputs<CastObj>(in[0], out[0],
+                                               CastType(castType));
+        }
+        case OpType::Concat:
+        {
+            IT_ASSERT(!in.empty() && out.size() == 1, "Bad arity for Concat");
+            return g.addOpWithOutputs<ConcatObj>(in, out[0], r.get<int32_t>());
+        }
+        case OpType::FusedElementWise:
+        {
+            IT_ASSERT(!in.empty() && out.size() == 1,
+                      "Bad arity for FusedElementWise");
+            vector<FusedStep> steps;
+            for (auto n = r.getCount(17); n > 0; --n)
+            {
+                FusedStep step{OpType(r.get<uint16_t>())};
+                step.operand = r.get<int32_t>();
+                step.reversed = r.get<uint8_t>();
+                step.min = r.getOptional();
+                step.max = r.getOptional();
+                steps.emplace_back(step);
+            }
+            return g.addOpWithOutputs<FusedElementWiseObj>(in, out[0], steps);
+        }
+        default:
+            IT_ASSERT(false, "Unknown operator type " +
+                                 std::to_string(type.underlying()) +
+                                 " in graph file");
+        }
+    }
+
+    void saveGraph(const Graph &graph, const string &path)
+    {
+        IT_ASSERT(graph->topo_sort() == true);
+        auto &tensors = graph->getTensors();
+        std::unordered_map<const TensorObj *, uint32_t> index;
+        for (size_t i = 0; i < tensors.size(); ++i)
+            index[tensors[i].get()] = i;
+
+        ByteWriter w;
+        w.buf.append(MAGIC, sizeof(MAGIC));
+        w.put<uint32_t>(GRAPH_FILE_VERSION);
+        w.put<uint32_t>(0);
+        w.put<uint64_t>(0); // patched below
+        w.put<uint64_t>(0);
+
+        // payloads are laid out in tensor order, each one aligned
+        vector<const TensorObj *> weights;
+        size_t weightBytes = 0;
+        w.put<uint32_t>(tensors.size());
+        for (auto &tensor : tensors)
+        {
+            auto dims = tensor->getDims();
+            w.put<int32_t>(tensor->getFuid());
+            w.put<int32_t>(tensor->getDType().getIndex());
+            w.put<uint32_t>(dims.size());
+            for (int d : dims)
+                w.put<int32_t>(d);
+            w.put<uint8_t>(tensor->isWeight());
+            if (!tensor->isWeight())
+                continue;
+            IT_ASSERT(tensor->isContiguous() &&
+                          (tensor->getBytes() == 0 ||
+                           tensor->hasData()),
+                      "Weight " + std::to_string(tensor->getFuid()) +
+                          " has no data to save");
+            weightBytes = alignUp(weightBytes);
+            w.put<uint64_t>(weightBytes);
+            weightBytes += tensor->getBytes();
+            weights.emplace_back(tensor.get());
+        }
+
+        auto &ops = graph->getOperators();
+        w.put<uint32_t>(ops.size());
+        for (auto &op : ops)
+        {
+            w.put<uint16_t>(op->getOpType().underlying());
+            for (auto *list : {&op->getInputs(), &op->getOutputs()})
+            {
+                w.put<uint32_t>(list->size());
+                for (auto &tensor : *list)
+                    w.put<uint32_t>(index.at(tensor.get()));
+            }
+            encodeAttributes(op, w);
+        }
+
+        size_t weightOffset = alignUp(w.buf.size());
+        w.patch<uint64_t>(16, weightOffset);
+        w.patch<uint64_t>(24, weightBytes);
+        w.buf.resize(weightOffset, '\0');
+        for (auto *tensor : weights)
+        {
+            w.buf.resize(weightOffset + alignUp(w.buf.size() - weightOffset),
+                         '\0');
+            if (tensor->getBytes() > 0)
+                w.buf.append(tensor->getRawDataPtr<const char *>(),
+                             tensor->getBytes());
+        }
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        IT_ASSERT(file.good(), "Cannot open " + path + " for writing");
+        file.write(w.buf.data(), w.buf.size());
+        IT_ASSERT(file.good(), "Failed to write " + path);
+    }
+
+    Graph loadGraph(Runtime runtime, const string &path)
+    {
+        auto file = mapFile(path);
+        const char *base = file.data;
+        size_t size = file.size;
+        IT_ASSERT(size >= HEADER_BYTES &&
+                      std::memcmp(base, MAGIC, sizeof(MAGIC)) == 0,
+                  path + " is not a graph file");
+
+        ByteReader r(base, size, "graph file");
+        r.get<uint64_t>(); // magic
+        auto version = r.get<uint32_t>();
+        IT_ASSERT(version == GRAPH_FILE_VERSION,
+                  "Unsupported graph file version " + std::to_string(version));
+        r.get<uint32_t>();
+        auto weightOffset = r.get<uint64_t>(), weightBytes = r.get<uint64_t>();
+        IT_ASSERT(weightOffset % WEIGHT_ALIGN == 0 && weightOffset <= size &&
+                      weightBytes <= size - weightOffset,
+                  "Truncated graph file");
+
+        Graph g = make_ref<GraphObj>(runtime);
+        TensorVec tensors(r.getCount(13));
+        for (auto &tensor : tensors)
+        {
+            r.get<int32_t>(); // fuid
+            auto dtype = r.get<int32_t>();
+            IT_ASSERT(dtype > 0 && dtype < 17 && DataType(dtype).getSize() > 0,
+                      "Bad data type in graph file");
+            Shape dims(r.getCount(4));
+            for (auto &d : dims)
+            {
+                d = r.get<int32_t>();
+                IT_ASSERT(d >= 0, "Bad shape in graph file");
+            }
+            tensor = g->addTensor(dims, DataType(dtype));
+            if (!r.get<uint8_t>())
+                continue;
+            auto offset = r.get<uint64_t>();
+            IT_ASSERT(offset % WEIGHT_ALIGN == 0 && offset <= weightBytes &&
+                          tensor->getBytes() <= weightBytes - offset,
+                      "Weight out of the graph file");
+            tensor->setWeight();
+            tensor->setDataBlob(make_ref<BlobObj>(
+                runtime, file.data + weightOffset + offset, file.mapping));
+        }
+
+        auto nOps = r.getCount(10);
+        for (uint32_t i = 0; i < nOps; ++i)
+        {
+            OpType type(r.get<uint16_t>());
+            TensorVec lists[2];
+            for (auto &list : lists)
+            {
+                list.resize(r.getCount(4));
+                for (auto &tensor : list)
+                {
+                    auto t = r.get<uint32_t>();
+                    IT_ASSERT(t < tensors.size(), "Bad tensor index");
+                    tensor = tensors[t];
+                }
+            }
+            decodeOperator(r, *g, type, lists[0], lists[1]);
+        }
+        return g;
+    }
+
+} // namespace infini
@@ -21,6 +21,7 @@ namespace infini {
             ss << "nullptr data";
         string ret = "Tensor " + std::to_string(guid) + ", Fuid " +
                      std::to_string(fuid) + ", shape " + vecToString(shape) +
+                     (strides.empty() ? "" : ", strides " + vecToString(strides)) +
                      ", dtype " + dtype.toString() + ", " + runtime->toString() +
                      ", " + ss.str() + "\n";
         vector<UidBaseType> targetGuids;
@@ -43,6 +44,7 @@ void TensorObj::setShape(Shape shape_) {
 
 void TensorObj::printData() const {
     IT_ASSERT(data != nullptr);
+    IT_ASSERT(isContiguous());
     if (!runtime->isCpu())
         IT_TODO_HALT();
 
@@ -73,6 +75,7 @@ void TensorObj::printData() const {
 bool TensorObj::equalData(const Tensor &rhs, double relativeError) const {
     IT_ASSERT(data != nullptr);
     IT_ASSERT(rhs->data != nullptr);
+    IT_ASSERT(isContiguous() && rhs->isContiguous());
     IT_ASSERT(getDType() == rhs->getDType());
     IT_ASSERT(runtime->isCpu());
     IT_ASSERT(rhs->getRuntime()->isCpu());
@@ -108,9 +111,58 @@ bool TensorObj::equalData(const Tensor &rhs, double relativeError) const {
 void TensorObj::setData(
     const std::function<void(void *, size_t, DataType)> &generator) const {
     IT_ASSERT(data != nullptr);
+    IT_ASSERT(isContiguous());
     generator(getRawDataPtr<void *>(), size(), dtype);
 }
 
-void TensorObj::setDataBlob(const Blob &blob) { this->data = blob; }
+void TensorObj::setConstant(
+    const std::function<void(void *, size_t, DataType)> &generator) {
+    auto owner = runtime;
+    void *ptr = runtime->alloc(getBytes());
+    setDataBlob(make_ref<BlobObj>(
+        runtime, ptr, Ref<void>(ptr, [owner](void *p) { owner->dealloc(p); })));
+    weight = true;
+    if (generator)
+        setData(generator);
+}
+
+void TensorObj::setDataBlob(const Blob &blob) {
+    this->data = blob;
+    strides.clear();
+    offset = 0;
+}
+
+void TensorObj::setView(const Blob &blob, vector<int64_t> strides_,
+                        size_t offset_) {
+    IT_ASSERT(strides_.size() == shape.size());
+    data = blob;
+    strides = std::move(strides_);
+    offset = offset_;
+}
+
+vector<int64_t> TensorObj::getStrides() const {
+    if (!strides.empty())
+        return strides;
+    vector<int64_t> dense(shape.size());
+    int64_t acc = 1;
+    for (size_t i = shape.size(); i > 0; --i) {
+        dense[i - 1] = acc;
+        acc *= shape[i - 1];
+    }
+    return dense;
+}
+
+bool TensorObj::isContiguous() const {
+    if (strides.empty())
+        return true;
+    // strides of size-1 dims do not matter
+    int64_t acc = 1;
+    for (size_t i = shape.size(); i > 0; --i) {
+        if (shape[i - 1] != 1 && strides[i - 1] != acc)
+            return false;
+        acc *= shape[i - 1];
+    }
+    return true;
+}
 
 }; // namespace infini
@@ -0,0 +1,178 @@
+#include "kernels/cpu/binary_simd.h"
+#include <cstring>
+
+#define SIMD_INLINE inline __attribute__((always_inline))
+
+namespace infini
+{
+    namespace
+    {
+        // GCC vector extensions: the same loop body is compiled once per
+        // instruction set by inlining it into target-specific entry points.
+        template <typename T, int W>
+        struct Vec
+        {
+            typedef T type __attribute__((vector_size(W * sizeof(T))));
+        };
+
+        struct AddOp
+        {
+            template <typename V>
+            static SIMD_INLINE V apply(V a, V b) { return a + b; }
+        };
+        struct SubOp
+        {
+            template <typename V>
+            static SIMD_INLINE V apply(V a, V b) { return a - b; }
+        };
+        struct MulOp
+        {
+            template <typename V>
+            static SIMD_INLINE V apply(V a, V b) { return a * b; }
+        };
+        struct DivOp
+        {
+            template <typename V>
+            static SIMD_INLINE V apply(V a, V b)
+            {
+                using T = std::remove_reference_t<decltype(a[0])>;
+                if constexpr (std::is_same_v<T, uint32_t>)
+                {
+                    // No vector integer division exists. Through double it
+                    // is exact: a/b is at least 1/b away from the next
+                    // integer, far above the rounding error of the quotient.
+                    typedef double D __attribute__((
+                        vector_size(sizeof(V) / sizeof(T) * sizeof(double))));
+                    D q = __builtin_convertvector(a, D) /
+                          __builtin_convertvector(b, D);
+                    return __builtin_convertvector(q, V);
+                }
+                else
+                    return a / b;
+            }
+        };
+
+        template <typename T, int W, typename Op, BinaryPattern P>
+        SIMD_INLINE void segmentLoop(const void *_a, const void *_b, void *_c,
+                                     int64_t n)
+        {
+            using V = typename Vec<T, W>::type;
+            const T *a = static_cast<const T *>(_a);
+            const T *b = static_cast<const T *>(_b);
+            T *c = static_cast<T *>(_c);
+            V va = {}, vb = {};
+            if constexpr (P == BinaryPattern::SV)
+                for (int i = 0; i < W; ++i)
+                    va[i] = a[0];
+            if constexpr (P == BinaryPattern::VS)
+                for (int i = 0; i < W; ++i)
+                    vb[i] = b[0];
+
+            int64_t i = 0;
+            // two vectors per iteration hide the latency of the loads
+            for (; i + 2 * W <= n; i += 2 * W)
+            {
+                V va1 = va, vb1 = vb;
+                if constexpr (P != BinaryPattern::SV)
+                {
+                    std::memcpy(&va, a + i, sizeof(V));
+                    std::memcpy(&va1, a + i + W, sizeof(V));
+                }
+                if constexpr (P != BinaryPattern::VS)
+                {
+                    std::memcpy(&vb, b + i, sizeof(V));
+                    std::memcpy(&vb1, b + i + W, sizeof(V));
+                }
+                V vc = Op::apply(va, vb), vc1 = Op::apply(va1, vb1);
+                std::memcpy(c + i, &vc, sizeof(V));
+                std::memcpy(c + i + W, &vc1, sizeof(V));
+            }
+            for (; i < n; ++i)
+            {
+                T x = P == BinaryPattern::SV ? a[0] : a[i];
+                T y = P == BinaryPattern::VS ? b[0] : b[i];
+                typedef T S __attribute__((vector_size(sizeof(T))));
+                S sx = {x}, sy = {y};
+                c[i] = Op::apply(sx, sy)[0];
+            }
+        }
+
+        template <typename T, typename Op, BinaryPattern P>
+        void segmentScalar(const void *a, const void *b, void *c, int64_t n)
+        {
+            segmentLoop<T, 16 / sizeof(T), Op, P>(a, b, c, n);
+        }
+
+        template <typename T, typename Op, BinaryPattern P>
+        __attribute__((target("avx2,fma"))) void
+        segmentAvx2(const void *a, const void *b, void *c, int64_t n)
+        {
+            segmentLoop<T, 32 / sizeof(T), Op, P>(a, b, c, n);
+        }
+
+        template <typename T, typename Op, BinaryPattern P>
+        __attribute__((target("avx512f,avx512bw,avx512dq,avx512vl"))) void
+        segmentAvx512(const void *a, const void *b, void *c, int64_t n)
+        {
+            segmentLoop<T, 64 / sizeof(T), Op, P>(a, b, c, n);
+        }
+
+        template <typename T, typename Op, BinaryPattern P>
+        BinarySegmentFn selectIsa(CpuIsa isa)
+        {
+            switch (isa)
+            {
+            case CpuIsa::AVX512:
+                return segmentAvx512<T, Op, P>;
+            case CpuIsa::AVX2:
+                return segmentAvx2<T, Op, P>;
+            default:
+                return segmentScalar<T, Op, P>;
+            }
+        }
+
+        template <typename T, typename Op>
+        BinarySegmentFn selectPattern(BinaryPattern pattern, CpuIsa isa)
+        {
+            switch (pattern)
+            {
+            case BinaryPattern::VV:
+                return selectIsa<T, Op, BinaryPattern::VV>(isa);
+            case BinaryPattern::VS:
+                return selectIsa<T, Op, BinaryPattern::VS>(isa);
+            default:
+                return selectIsa<T, Op, BinaryPattern::SV>(isa);
+            }
+        }
+
+        template <typename T>
+        BinarySegmentFn selectOp(OpType op, BinaryPattern pattern, CpuIsa isa)
+        {
+            switch (op.underlying())
+            {
+            case OpType::Add:
+                return selectPattern<T, AddOp>(pattern, isa);
+            case OpType::Sub:
+                return selectPattern<T, SubOp>(pattern, isa);
+            case OpType::Mul:
+                return selectPattern<T, MulOp>(pattern, isa);
+            case OpType::Div:
+                return selectPattern<T, DivOp>(pattern, isa);
+            default:
+                return nullptr;
+            }
+        }
+    } // namespace
+
+    BinarySegmentFn getBinarySimdKernel(OpType op, DataType dtype,
+                                        BinaryPattern pattern, CpuIsa isa)
+    {
+        isa = std::min(isa, getCpuIsa());
+        if (dtype == DataType::Float32)
+            return selectOp<float>(op, pattern, isa);
+        if (dtype == DataType::UInt32)
+            return selectOp<uint32_t>(op, pattern, isa);
+        return nullptr;
+    }
+
+} // namespace infini
@@ -0,0 +1,364 @@
+#include "core/kernel.h"
+#include "kernels/cpu/cast_simd.h"
+#include <cstring>
+#include <immintrin.h>
+
+#define SIMD_INLINE inline __attribute__((always_inline))
+
+namespace infini
+{
+    uint16_t floatToHalf(float x)
+    {
+        uint32_t u;
+        std::memcpy(&u, &x, sizeof(u));
+        uint32_t sign = (u >> 16) & 0x8000;
+        u &= 0x7fffffff;
+        uint16_t h;
+        if (u >= 0x47800000) // 2^16 and above: Inf, or NaN kept quiet
+            h = u > 0x7f800000 ? 0x7e00 : 0x7c00;
+        else if (u < 0x38800000)
+        {
+            // below 2^-14 the result is subnormal: adding 0.5 lines the
+            // half ulp up with the float ulp and the FPU rounds to even
+            float f;
+            std::memcpy(&f, &u, sizeof(f));
+            f += 0.5f;
+            std::memcpy(&u, &f, sizeof(u));
+            h = u - 0x3f000000;
+        }
+        else
+        {
+            // rebias the exponent, then round the 13 dropped bits to even;
+            // a carry into the exponent (up to Inf) is the right result
+            u += 0xc8000fff + ((u >> 13) & 1);
+            h = u >> 13;
+        }
+        return h | sign;
+    }
+
+    float halfToFloat(uint16_t x)
+    {
+        uint32_t u = uint32_t(x & 0x7fff) << 13;
+        uint32_t exp = u & 0x0f800000;
+        u += 0x38000000; // rebias 15 -> 127
+        float f;
+        if (exp == 0x0f800000) // Inf or NaN
+            u += 0x38000000;
+        else if (exp == 0) // zero or subnormal: renormalize through the FPU
+        {
+            u += 1 << 23;
+            std::memcpy(&f, &u, sizeof(f));
+            f -= 6.103515625e-05f; // 2^-14
+            std::memcpy(&u, &f, sizeof(u));
+        }
+        u |= uint32_t(x & 0x8000) << 16;
+        std::memcpy(&f, &u, sizeof(f));
+        return f;
+    }
+
+    uint16_t floatToBFloat16(float x)
+    {
+        uint32_t u;
+        std::memcpy(&u, &x, sizeof(u));
+        if ((u & 0x7fffffff) > 0x7f800000)
+            return (u >> 16) | 0x40;
+        return (u + 0x7fff + ((u >> 16) & 1)) >> 16;
+    }
+
+    float bfloat16ToFloat(uint16_t x)
+    {
+        uint32_t u = uint32_t(x) << 16;
+        float f;
+        std::memcpy(&f, &u, sizeof(f));
+        return f;
+    }
+
+    namespace
+    {
+        template <typename T, int W>
+        struct Vec
+        {
+            typedef T type __attribute__((vector_size(W * sizeof(T))));
+        };
+
+        // Plain C++ conversion.
+        struct ConvertOp
+        {
+            template <typename D, typename S>
+            static SIMD_INLINE D scalar(S x) { return static_cast<D>(x); }
+            template <typename VD, typename VS>
+            static SIMD_INLINE VD vector(VS x)
+            {
+                return __builtin_convertvector(x, VD);
+            }
+        };
+
+        // Float32 -> BFloat16, the same bit operations as floatToBFloat16.
+        struct ToBFloat16Op
+        {
+            template <typename D, typename S>
+            static SIMD_INLINE D scalar(S x) { return floatToBFloat16(x); }
+            template <typename VD, typename VS>
+            static SIMD_INLINE VD vector(VS x)
+            {
+                typedef uint32_t VU
+                    __attribute__((vector_size(sizeof(VS))));
+                VU u = (VU)x;
+                VU rounded = (u + 0x7fff + ((u >> 16) & 1)) >> 16;
+                VU quiet = (u >> 16) | 0x40;
+                VU r = (u & 0x7fffffff) > 0x7f800000 ? quiet : rounded;
+                return __builtin_convertvector(r, VD);
+            }
+        };
+
+        // BFloat16 -> Float32 is exact: the bits move to the upper half.
+        struct FromBFloat16Op
+        {
+            template <typename D, typename S>
+            static SIMD_INLINE D scalar(S x) { return bfloat16ToFloat(x); }
+            template <typename VD, typename VS>
+            static SIMD_INLINE VD vector(VS x)
+            {
+                typedef uint32_t VU
+                    __attribute__((vector_size(sizeof(VD))));
+                return (VD)(__builtin_convertvector(x, VU) << 16);
+            }
+        };
+
+        template <typename S, typename D, int Bytes, typename Op>
+        SIMD_INLINE void castLoop(const void *_x, void *_y, int64_t n)
+        {
+            constexpr int W = Bytes / std::max(sizeof(S), sizeof(D));
+            using VS = typename Vec<S, W>::type;
+            using VD = typename Vec<D, W>::type;
+            const S *x = static_cast<const S *>(_x);
+            D *y = static_cast<D *>(_y);
+            int64_t i = 0;
+            for (; i + W <= n; i += W)
+            {
+                VS vs;
+                std::memcpy(&vs, x + i, sizeof(VS));
+                VD vd = Op::template vector<VD>(vs);
+                std::memcpy(y + i, &vd, sizeof(VD));
+            }
+            for (; i < n; ++i)
+                y[i] = Op::template scalar<D>(x[i]);
+        }
+
+        template <typename S, typename D, typename Op>
+        void castScalar(const void *x, void *y, int64_t n)
+        {
+            castLoop<S, D, 16, Op>(x, y, n);
+        }
+
+        template <typename S, typename D, typename Op>
+        __attribute__((target("avx2,fma"))) void
+        castAvx2(const void *x, void *y, int64_t n)
+        {
+            castLoop<S, D, 32, Op>(x, y, n);
+        }
+
+        template <typename S, typename D, typename Op>
+        __attribute__((target("avx512f,avx512bw,avx512dq,avx512vl"))) void
+        castAvx512(const void *x, void *y, int64_t n)
+        {
+            castLoop<S, D, 64, Op>(x, y, n);
+        }
+
+        void floatToHalfScalar(const void *_x, void *_y, int64_t n)
+        {
+            auto x = static_cast<const float *>(_x);
+            auto y = static_cast<uint16_t *>(_y);
+            for (int64_t i = 0; i < n; ++i)
+                y[i] = floatToHalf(x[i]);
+        }
+
+        void halfToFloatScalar(const void *_x, void *_y, int64_t n)
+        {
+            auto x = static_cast<const uint16_t *>(_x);
+            auto y = static_cast<float *>(_y);
+            for (int64_t i = 0; i < n; ++i)
+                y[i] = halfToFloat(x[i]);
+        }
+
+        __attribute__((target("avx2,f16c"))) void
+        floatToHalfF16c(const void *_x, void *_y, int64_t n)
+        {
+            auto x = static_cast<const float *>(_x);
+            auto y = static_cast<uint16_t *>(_y);
+            int64_t i = 0;
+            for (; i + 8 <= n; i += 8)
+            {
+                __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(x + i),
+                                            _MM_FROUND_TO_NEAREST_INT);
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(y + i), h);
+            }
+            for (; i < n; ++i)
+                y[i] = floatToHalf(x[i]);
+        }
+
+        __attribute__((target("avx2,f16c"))) void
+        halfToFloatF16c(const void *_x, void *_y, int64_t n)
+        {
+            auto x = static_cast<const uint16_t *>(_x);
+            auto y = static_cast<float *>(_y);
+            int64_t i = 0;
+            for (; i + 8 <= n; i += 8)
+                _mm256_storeu_ps(y + i,
+                                 _mm256_cvtph_ps(_mm_loadu_si128(
+                                     reinterpret_cast<const __m128i *>(x + i))));
+            for (; i < n; ++i)
+                y[i] = halfToFloat(x[i]);
+        }
+
+        __attribute__((target("avx512f"))) void
+        floatToHalfAvx512(const void *_x, void *_y, int64_t n)
+        {
+            auto x = static_cast<const float *>(_x);
+            auto y = static_cast<uint16_t *>(_y);
+            int64_t i = 0;
+            for (; i + 16 <= n; i += 16)
+            {
+                // the zero-masked forms avoid a spurious GCC warning about
+                // the undefined pass-through of the plain ones
+                __m256i h = _mm512_maskz_cvtps_ph(0xffff, _mm512_loadu_ps(x + i),
+                                                  _MM_FROUND_TO_NEAREST_INT);
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(y + i), h);
+            }
+            for (; i < n; ++i)
+                y[i] = floatToHalf(x[i]);
+        }
+
+        __attribute__((target("avx512f"))) void
+        halfToFloatAvx512(const void *_x, void *_y, int64_t n)
+        {
+            auto x = static_cast<const uint16_t *>(_x);
+            auto y = static_cast<float *>(_y);
+            int64_t i = 0;
+            for (; i + 16 <= n; i += 16)
+                _mm512_storeu_ps(y + i, _mm512_maskz_cvtph_ps(
+                                            0xffff,
+                                            _mm256_loadu_si256(
+                                                reinterpret_cast<const __m256i *>(
+                                                    x + i))));
+            for (; i < n; ++i)
+                y[i] = halfToFloat(x[i]);
+        }
+
+        template <typename S, typename D, typename Op = ConvertOp>
+        CastFn selectIsa(CpuIsa isa)
+        {
+            switch (isa)
+            {
+            case CpuIsa::AVX512:
+                return castAvx512<S, D, Op>;
+            case CpuIsa::AVX2:
+                return castAvx2<S, D, Op>;
+            default:
+                return castScalar<S, D, Op>;
+            }
+        }
+    } // namespace
+
+    CastFn getCastKernel(CastType type, CpuIsa isa)
+    {
+        isa = std::min(isa, getCpuIsa());
+        // every AVX-512 machine has F16C
+        bool f16c = isa >= CpuIsa::AVX2 && getCpuFeatures().f16c;
+        switch (type)
+        {
+        case CastType::Float2Float16:
+            return isa == CpuIsa::AVX512 ? floatToHalfAvx512
+                   : f16c                ? floatToHalfF16c
+                                         : floatToHalfScalar;
+        case CastType::Float162Float:
+            return isa == CpuIsa::AVX512 ? halfToFloatAvx512
+                   : f16c                ? halfToFloatF16c
+                                         : halfToFloatScalar;
+        case CastType::Float2BFloat16:
+            return selectIsa<float, uint16_t, ToBFloat16Op>(isa);
+        case CastType::BFloat162Float:
+            return selectIsa<uint16_t, float, FromBFloat16Op>(isa);
+        case CastType::Float2Int64:
+            return selectIsa<float, int64_t>(isa);
+        case CastType::Float2Int32:
+            return selectIsa<float, int32_t>(isa);
+        case CastType::Float2Int16:
+            return selectIsa<float, int16_t>(isa);
+        case CastType::Float2Int8:
+            return selectIsa<float, int8_t>(isa);
+        case CastType::Int322Float:
+            return selectIsa<int32_t, float>(isa);
+        case CastType::Int322Int8:
+            return selectIsa<int32_t, int8_t>(isa);
+        case CastType::Int322Int16:
+            return selectIsa<int32_t, int16_t>(isa);
+        case CastType::Int322Int64:
+            return selectIsa<int32_t, int64_t>(isa);
+        case CastType::Int162Float:
+            return selectIsa<int16_t, float>(isa);
+        case CastType::Int162Int32:
+            return selectIsa<int16_t, int32_t>(isa);
+        case CastType::Int82Float:
+            return selectIsa<int8_t, float>(isa);
+        case CastType::Int82Int16:
+            return selectIsa<int8_t, int16_t>(isa);
+        case CastType::Int82Int32:
+            return selectIsa<int8_t, int32_t>(isa);
+        case CastType::Uint82Float:
+            return selectIsa<uint8_t, float>(isa);
+        case CastType::Uint82Int32:
+            return selectIsa<uint8_t, int32_t>(isa);
+        case CastType::Uint82Int64:
+            return selectIsa<uint8_t, int64_t>(isa);
+        case CastType::Int642Int32:
+            return selectIsa<int64_t, int32_t>(isa);
+        case CastType::Int642Uint32:
+            return selectIsa<int64_t, uint32_t>(isa);
+        case CastType::Int642Float:
+            return selectIsa<int64_t, float>(isa);
+        case CastType::Uint322Int64:
+            return selectIsa<uint32_t, int64_t>(isa);
+        case CastType::Float2Float:
+            return selectIsa<float, float>(isa);
+        default:
+            return nullptr;
+        }
+    }
+
+    class NativeCast : public CpuKernelWithoutConfig
+    {
+        KernelLaunch prepare(const Operator &_op,
+                             const RuntimeObj *context) const override
+        {
+            auto op = as<CastObj>(_op);
+            auto input = op->getInputs(0), output = op->getOutput();
+            IT_ASSERT(input->getDType() == op->getInputDataType());
+            IT_ASSERT(input->isContiguous());
+            auto fn = getCastKernel(op->getType());
+            IT_ASSERT(fn != nullptr);
+            auto x = input->getRawDataPtr<char *>();
+            auto y = output->getRawDataPtr<char *>();
+            size_t inSize = input->getDType().getSize(),
+                   outSize = output->getDType().getSize();
+            int64_t n = output->size();
+
+            return [=]
+            {
+                constexpr int64_t chunk = 1 << 14;
+#pragma omp parallel for if (n > chunk)
+                for (int64_t i = 0; i < n; i += chunk)
+                    fn(x + i * inSize, y + i * outSize, std::min(chunk, n - i));
+            };
+        }
+
+        void compute(const Operator &_op,
+                     const RuntimeObj *context) const override
+        {
+            prepare(_op, context)();
+        }
+    };
+
+    REGISTER_KERNEL(Device::CPU, OpType::Cast, NativeCast, "Cast_CPU");
+
+}; // namespace infini
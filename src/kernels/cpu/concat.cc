@@ -1,64 +1,162 @@
 #include "operators/concat.h"
 #include "core/kernel.h"
+#include "utils/broadcast.h"
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 namespace infini {
 
-class NaiveConcat : public CpuKernelWithoutConfig {
-    template <typename T>
-    void doCompute(const Operator &_op, const RuntimeObj *context) const {
+namespace {
+
+// Outputs larger than this do not fit in the last level cache, so they are
+// written with non-temporal stores that bypass it.
+constexpr size_t STREAM_THRESHOLD = 8 << 20;
+// Blocks are split into pieces of this many bytes when there are too few
+// blocks to keep every thread busy.
+constexpr size_t GRAIN = 64 << 10;
+
+// memcpy through non-temporal stores. The caller issues the fence.
+void streamCopy(char *dst, const char *src, size_t bytes) {
+#ifdef __SSE2__
+    size_t head = (16 - reinterpret_cast<uintptr_t>(dst) % 16) % 16;
+    if (bytes < head + 64) {
+        std::memcpy(dst, src, bytes);
+        return;
+    }
+    std::memcpy(dst, src, head);
+    dst += head, src += head, bytes -= head;
+    size_t body = bytes / 64 * 64;
+    for (size_t i = 0; i < body; i += 64) {
+        auto s = reinterpret_cast<const __m128i *>(src + i);
+        auto d = reinterpret_cast<__m128i *>(dst + i);
+        __m128i a = _mm_loadu_si128(s), b = _mm_loadu_si128(s + 1),
+                c = _mm_loadu_si128(s + 2), e = _mm_loadu_si128(s + 3);
+        _mm_stream_si128(d, a);
+        _mm_stream_si128(d + 1, b);
+        _mm_stream_si128(d + 2, c);
+        _mm_stream_si128(d + 3, e);
+    }
+    std::memcpy(dst + body, src + body, bytes - body);
+#else
+    std::memcpy(dst, src, bytes);
+#endif
+}
+
+} // namespace
+
+// Concat along `dim` is, for every index over the dims before it, one
+// contiguous block per input written next to each other in the output.
+// Strided inputs (views) are gathered into their blocks instead, and inputs
+// the memory planner placed in their block already are skipped.
+class BlockConcat : public CpuKernelWithoutConfig {
+    KernelLaunch prepare(const Operator &_op,
+                         const RuntimeObj *context) const override {
         auto op = as<ConcatObj>(_op);
-        auto inputs = op->getInputs(), outputs = op->getOutputs();
-        auto dim = op->getDim();
-        auto output = outputs[0];
-        std::vector<Shape> iDims;
-        for (auto input : inputs)
-            iDims.emplace_back(input->getDims());
+        auto inputs = op->getInputs();
+        auto output = op->getOutput();
+        int dim = op->getDim();
+        size_t elemSize = output->getDType().getSize();
         const auto &outDim = output->getDims();
-        size_t blockOffsetInner = 1;
-        for (size_t i = outDim.size() - 1; i > (size_t)dim; --i)
-            blockOffsetInner *= outDim[i];
-        size_t blockOffset = outDim[dim] * blockOffsetInner;
-        for (size_t i = 0; i < inputs.size(); ++i) {
-            auto input = inputs[i];
-            auto dimOffset = 0;
-            auto iDim = iDims[i];
-            for (size_t j = 0; j < i; ++j)
-                dimOffset += iDims[j][dim];
-            size_t localBlockOffset = 1;
-            for (size_t i = iDim.size() - 1;
-                 i >= (size_t)dim && i != (size_t)-1; --i)
-                localBlockOffset *= iDim[i];
-            auto innerOffset = blockOffsetInner * dimOffset;
-            auto inSize = input->size();
-            auto inPtr = input->getRawDataPtr<T *>(),
-                 outPtr = output->getRawDataPtr<T *>();
-#pragma omp parallel for
-            for (size_t iOffset = 0; iOffset < inSize; ++iOffset) {
-                auto oOffset = iOffset % localBlockOffset + innerOffset +
-                               iOffset / localBlockOffset * blockOffset;
-                outPtr[oOffset] = inPtr[iOffset];
-            }
+
+        size_t outer = 1, inner = elemSize;
+        for (int i = 0; i < dim; ++i)
+            outer *= outDim[i];
+        for (size_t i = dim + 1; i < outDim.size(); ++i)
+            inner *= outDim[i];
+
+        // bytes of every input block and where it starts in an output block
+        size_t nIn = inputs.size(), maxBlock = 0;
+        vector<size_t> block(nIn), offset(nIn);
+        vector<const char *> src(nIn);
+        // bytes copied block by block: none for strided or placed inputs
+        vector<size_t> dense(nIn, 0), strided;
+        char *dst = output->getRawDataPtr<char *>();
+        size_t outBlock = 0;
+        for (size_t i = 0; i < nIn; ++i) {
+            block[i] = inputs[i]->getDims()[dim] * inner;
+            offset[i] = outBlock;
+            outBlock += block[i];
+            src[i] = inputs[i]->getRawDataPtr<char *>();
+            if (!inputs[i]->isContiguous())
+                strided.emplace_back(i);
+            else if (outer > 1 || src[i] != dst + offset[i])
+                dense[i] = block[i];
+            maxBlock = std::max(maxBlock, dense[i]);
+        }
+        size_t total = outer * outBlock;
+        if (total == 0 || (maxBlock == 0 && strided.empty()))
+            return [] {};
+        vector<Shape> stridedDims;
+        vector<vector<int64_t>> stridedSrc;
+        for (auto i : strided) {
+            stridedDims.emplace_back(inputs[i]->getDims());
+            stridedSrc.emplace_back(inputs[i]->getStrides());
         }
+        auto dstStrides = output->getStrides();
+
+        return [=, block = std::move(block), offset = std::move(offset),
+                src = std::move(src), dense = std::move(dense),
+                strided = std::move(strided),
+                stridedDims = std::move(stridedDims),
+                stridedSrc = std::move(stridedSrc),
+                dstStrides = std::move(dstStrides)] {
+            for (size_t s = 0; s < strided.size(); ++s) {
+                size_t i = strided[s];
+                copyStrided(dst + offset[i], dstStrides, src[i], stridedSrc[s],
+                            stridedDims[s], elemSize);
+            }
+            if (maxBlock == 0)
+                return;
+            // the split depends on the threads available when it runs
+            int threads = 1;
+#ifdef _OPENMP
+            threads = omp_get_max_threads();
+#endif
+            size_t blocks = outer * nIn;
+            size_t pieces = 1;
+            if (blocks < (size_t)threads)
+                pieces = std::max<size_t>(1, (maxBlock + GRAIN - 1) / GRAIN);
+            size_t pieceLen = (maxBlock + pieces - 1) / pieces;
+            int64_t units = blocks * pieces;
+            bool stream = total >= STREAM_THRESHOLD;
+
+#pragma omp parallel if (total > GRAIN && units > 1)
+            {
+#pragma omp for
+                for (int64_t u = 0; u < units; ++u) {
+                    size_t b = u / pieces, i = b % nIn, o = b / nIn;
+                    size_t begin = u % pieces * pieceLen;
+                    if (begin >= dense[i])
+                        continue;
+                    size_t len = std::min(pieceLen, dense[i] - begin);
+                    char *to = dst + o * outBlock + offset[i] + begin;
+                    const char *from = src[i] + o * block[i] + begin;
+                    if (stream)
+                        streamCopy(to, from, len);
+                    else
+                        std::memcpy(to, from, len);
+                }
+#ifdef __SSE2__
+                // streaming stores are weakly ordered, each thread fences its
+                // own
+                if (stream)
+                    _mm_sfence();
+#endif
+            }
+        };
     }
 
     void compute(const Operator &_op,
                  const RuntimeObj *context) const override {
-#define CASE(N)                                                                \
-    case N:                                                                    \
-        doCompute<DT<N>::t>(_op, context)
-
-        int dataTypeIdx = _op->getDType().getIndex();
-        switch (dataTypeIdx) {
-            CASE(1); // DataType::Float32
-            break;
-            CASE(12); // DataType::UInt32
-            break;
-        default:
-            IT_TODO_HALT();
-        }
+        prepare(_op, context)();
     }
 };
 
-REGISTER_KERNEL(Device::CPU, OpType::Concat, NaiveConcat, "ConcatNaive_CPU");
+REGISTER_KERNEL(Device::CPU, OpType::Concat, BlockConcat, "ConcatBlock_CPU");
 
 } // namespace infini
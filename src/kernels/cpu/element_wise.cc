@@ -1,5 +1,7 @@
 #include "operators/element_wise.h"
 #include "core/kernel.h"
+#include "kernels/cpu/binary_simd.h"
+#include "utils/broadcast.h"
 #include "utils/operator_utils.h"
 
 namespace infini
@@ -30,85 +32,299 @@ namespace infini
             return (T)(val0 / val1);
         }
 
+        // One contiguous output segment. Each operand is contiguous, a
+        // broadcast scalar or strided along it; the first three cover the
+        // same-shape, scalar, row-broadcast and column-broadcast cases and go
+        // to the vectorized kernels, which are looked up once per launch.
+        // `c` may be an operand of the output's shape (in-place execution).
+        template <typename T, T (*Fn)(T, T)>
+        static KernelLaunch broadcastLaunch(BroadcastPlan plan, OpType type,
+                                            DataType dtype, const T *a,
+                                            const T *b, T *c)
+        {
+            auto vv = getBinarySimdKernel(type, dtype, BinaryPattern::VV);
+            auto vs = getBinarySimdKernel(type, dtype, BinaryPattern::VS);
+            auto sv = getBinarySimdKernel(type, dtype, BinaryPattern::SV);
+            return [plan = std::move(plan), vv, vs, sv, a, b, c]
+            {
+                int64_t sa = plan.innerStride(0), sb = plan.innerStride(1);
+                plan.forEachSegment(
+                    [&](int64_t outOffset, const int64_t *inOffsets, int64_t n)
+                    {
+                        const T *pa = a + inOffsets[0], *pb = b + inOffsets[1];
+                        T *pc = c + outOffset;
+                        if (sa == 1 && sb == 1)
+                            vv(pa, pb, pc, n);
+                        else if (sa == 1 && sb == 0)
+                            vs(pa, pb, pc, n);
+                        else if (sa == 0 && sb == 1)
+                            sv(pa, pb, pc, n);
+                        else
+                            for (int64_t i = 0; i < n; ++i)
+                                pc[i] = Fn(pa[i * sa], pb[i * sb]);
+                    });
+            };
+        }
+
         template <typename T>
-        void doCompute(const Operator &_op, const RuntimeObj *context) const
+        KernelLaunch doPrepare(const Operator &_op,
+                               const RuntimeObj *context) const
         {
             auto op = as<ElementWiseObj>(_op);
             T *inptr0 = op->getInputs(0)->getRawDataPtr<T *>();
             T *inptr1 = op->getInputs(1)->getRawDataPtr<T *>();
             T *outptr = op->getOutput()->getRawDataPtr<T *>();
 
-            auto shapeA = op->getInputs(0)->getDims();
-            auto shapeB = op->getInputs(1)->getDims();
-            auto shapeC = op->getOutput()->getDims();
-            auto rank = op->getOutput()->getRank();
-            Shape a(rank, 1);
-            Shape b(rank, 1);
-            std::copy(shapeA.begin(), shapeA.end(),
-                      a.begin() + (rank - shapeA.size()));
-            std::copy(shapeB.begin(), shapeB.end(),
-                      b.begin() + (rank - shapeB.size()));
-            auto getStride = [&](const Shape &shape)
-            {
-                int p = 1;
-                Shape stride(rank);
-                for (auto i = rank; i > 0; --i)
-                {
-                    stride[i - 1] = p;
-                    p = p * shape[i - 1];
-                }
-                return stride;
-            };
-            Shape strideA = getStride(a);
-            Shape strideB = getStride(b);
-
-            auto n = op->getOutput()->size();
-            T (*_doCompute)
-            (T val0, T val1);
-            switch (op->getOpType().underlying())
+            // operands may be strided views
+            BroadcastPlan plan(op->getOutput()->getDims(),
+                               {op->getInputs(0)->getDims(),
+                                op->getInputs(1)->getDims()},
+                               {op->getInputs(0)->getStrides(),
+                                op->getInputs(1)->getStrides()});
+            auto type = op->getOpType();
+            auto dtype = op->getDType();
+            switch (type.underlying())
             {
             case OpType::Add:
-                _doCompute = addCompute<T>;
-                break;
+                return broadcastLaunch<T, addCompute<T>>(
+                    std::move(plan), type, dtype, inptr0, inptr1, outptr);
             case OpType::Sub:
-                _doCompute = subCompute<T>;
-                break;
+                return broadcastLaunch<T, subCompute<T>>(
+                    std::move(plan), type, dtype, inptr0, inptr1, outptr);
             case OpType::Mul:
-                _doCompute = mulCompute<T>;
-                break;
+                return broadcastLaunch<T, mulCompute<T>>(
+                    std::move(plan), type, dtype, inptr0, inptr1, outptr);
             case OpType::Div:
-                _doCompute = divCompute<T>;
-                break;
+                return broadcastLaunch<T, divCompute<T>>(
+                    std::move(plan), type, dtype, inptr0, inptr1, outptr);
             default:
                 IT_TODO_HALT();
             }
+        }
 
-            for (size_t i = 0; i < n; ++i)
+        KernelLaunch prepare(const Operator &_op,
+                             const RuntimeObj *context) const override
+        {
+#define CASE(N) \
+    case N:     \
+        return doPrepare<DT<N>::t>(_op, context)
+
+            int dataTypeIdx = _op->getDType().getIndex();
+            switch (dataTypeIdx)
             {
-                auto shapeIndexC = locate_index(i, shapeC);
-                auto indexA = delocate_index(shapeIndexC, a, strideA);
-                auto indexB = delocate_index(shapeIndexC, b, strideB);
-                outptr[i] = _doCompute(inptr0[indexA], inptr1[indexB]);
+                CASE(1); // DataType::Float32
+                CASE(12); // DataType::UInt32
+            default:
+                IT_TODO_HALT();
             }
+#undef CASE
         }
 
         void compute(const Operator &_op,
                      const RuntimeObj *context) const override
         {
+            prepare(_op, context)();
+        }
+    };
+
+    // Evaluates a fused chain block by block: a block of the running value
+    // stays in L1 while every step goes over it, with the same vectorized
+    // segment kernels as the single operators, and only the last step
+    // writes to the output.
+    class FusedElementWise : public CpuKernelWithoutConfig
+    {
+        static constexpr int64_t BLOCK = 512;
+
+        template <typename T>
+        struct Step
+        {
+            OpType type;
+            int operand;
+            bool reversed;
+            std::optional<float> min, max;
+            BinarySegmentFn vv, vs, sv;
+            T (*fn)(T, T);
+        };
+
+        template <typename T>
+        static T (*binaryFn(OpType type))(T, T)
+        {
+            switch (type.underlying())
+            {
+            case OpType::Add:
+                return [](T a, T b) { return a + b; };
+            case OpType::Sub:
+                return [](T a, T b) { return a - b; };
+            case OpType::Mul:
+                return [](T a, T b) { return a * b; };
+            case OpType::Div:
+                return [](T a, T b) { return (T)(a / b); };
+            default:
+                IT_TODO_HALT();
+            }
+        }
+
+        // dst[0, n) = step(src[0, n)); the operand, if any, starts at `b`
+        // and advances by `sb`
+        template <typename T>
+        static void apply(const Step<T> &step, const T *src, const T *b,
+                          int64_t sb, T *dst, int64_t n)
+        {
+            switch (step.type.underlying())
+            {
+            // src and dst are the same block or do not overlap
+            case OpType::Relu:
+#pragma omp simd
+                for (int64_t i = 0; i < n; ++i)
+                    dst[i] = std::max(T(0), src[i]);
+                return;
+            case OpType::Clip:
+                if constexpr (std::is_same_v<T, float>)
+                {
+                    // absent bounds clip to +-Inf; NaN passes as in Clip
+                    float lo = step.min.value_or(-INFINITY),
+                          hi = step.max.value_or(INFINITY);
+#pragma omp simd
+                    for (int64_t i = 0; i < n; ++i)
+                    {
+                        float val = src[i] < lo ? lo : src[i];
+                        dst[i] = val > hi ? hi : val;
+                    }
+                }
+                else
+                    for (int64_t i = 0; i < n; ++i)
+                    {
+                        auto val = src[i];
+                        dst[i] = (step.min && val < *step.min) ? *step.min
+                                 : (step.max && val > *step.max)
+                                     ? *step.max
+                                     : val;
+                    }
+                return;
+            default:
+                break;
+            }
+            if (sb == 1)
+                step.reversed ? step.vv(b, src, dst, n)
+                              : step.vv(src, b, dst, n);
+            else if (sb == 0)
+                step.reversed ? step.sv(b, src, dst, n)
+                              : step.vs(src, b, dst, n);
+            else if (step.reversed)
+                for (int64_t i = 0; i < n; ++i)
+                    dst[i] = step.fn(b[i * sb], src[i]);
+            else
+                for (int64_t i = 0; i < n; ++i)
+                    dst[i] = step.fn(src[i], b[i * sb]);
+        }
+
+        template <typename T>
+        KernelLaunch doPrepare(const Operator &_op,
+                               const RuntimeObj *context) const
+        {
+            auto op = as<FusedElementWiseObj>(_op);
+            auto dtype = op->getDType();
+            vector<Shape> shapes;
+            vector<vector<int64_t>> strides;
+            vector<const T *> in;
+            for (auto &input : op->getInputs())
+            {
+                shapes.emplace_back(input->getDims());
+                strides.emplace_back(input->getStrides());
+                in.emplace_back(input->getRawDataPtr<T *>());
+            }
+            T *out = op->getOutput()->getRawDataPtr<T *>();
+            BroadcastPlan plan(op->getOutput()->getDims(), shapes, strides);
+
+            vector<Step<T>> steps;
+            for (auto &s : op->getSteps())
+            {
+                Step<T> step{s.type, s.operand, s.reversed, s.min, s.max,
+                             nullptr, nullptr, nullptr, nullptr};
+                if (s.operand >= 0)
+                {
+                    step.vv = getBinarySimdKernel(s.type, dtype,
+                                                  BinaryPattern::VV);
+                    step.vs = getBinarySimdKernel(s.type, dtype,
+                                                  BinaryPattern::VS);
+                    step.sv = getBinarySimdKernel(s.type, dtype,
+                                                  BinaryPattern::SV);
+                    IT_ASSERT(step.vv && step.vs && step.sv);
+                    step.fn = binaryFn<T>(s.type);
+                }
+                else
+                    IT_ASSERT(s.type == OpType::Relu || s.type == OpType::Clip);
+                steps.emplace_back(step);
+            }
+
+            return [plan = std::move(plan), steps = std::move(steps),
+                    in = std::move(in), out]
+            {
+                plan.forEachSegment(
+                    [&](int64_t outOffset, const int64_t *inOffsets, int64_t n)
+                    {
+                        alignas(64) T acc[BLOCK];
+                        for (int64_t b0 = 0; b0 < n; b0 += BLOCK)
+                        {
+                            int64_t len = std::min(BLOCK, n - b0);
+                            // the running value starts as input 0, read in
+                            // place when it is contiguous
+                            int64_t s0 = plan.innerStride(0);
+                            const T *src = in[0] + inOffsets[0] + b0 * s0;
+                            if (s0 != 1)
+                            {
+                                for (int64_t i = 0; i < len; ++i)
+                                    acc[i] = src[i * s0];
+                                src = acc;
+                            }
+                            // the block of the output is written only by
+                            // the last step, after every read of the same
+                            // block of the inputs, so it may alias an input
+                            // of its shape
+                            for (size_t k = 0; k < steps.size(); ++k)
+                            {
+                                const auto &step = steps[k];
+                                T *dst = k + 1 == steps.size()
+                                             ? out + outOffset + b0
+                                             : acc;
+                                const T *b = nullptr;
+                                int64_t sb = 0;
+                                if (step.operand >= 0)
+                                {
+                                    sb = plan.innerStride(step.operand);
+                                    b = in[step.operand] +
+                                        inOffsets[step.operand] + b0 * sb;
+                                }
+                                apply(step, src, b, sb, dst, len);
+                                src = dst;
+                            }
+                        }
+                    });
+            };
+        }
+
+        KernelLaunch prepare(const Operator &_op,
+                             const RuntimeObj *context) const override
+        {
 #define CASE(N) \
     case N:     \
-        doCompute<DT<N>::t>(_op, context)
+        return doPrepare<DT<N>::t>(_op, context)
 
             int dataTypeIdx = _op->getDType().getIndex();
             switch (dataTypeIdx)
             {
                 CASE(1); // DataType::Float32
-                break;
                 CASE(12); // DataType::UInt32
-                break;
             default:
                 IT_TODO_HALT();
             }
+#undef CASE
+        }
+
+        void compute(const Operator &_op,
+                     const RuntimeObj *context) const override
+        {
+            prepare(_op, context)();
         }
     };
 
@@ -116,4 +332,6 @@ namespace infini
     REGISTER_KERNEL(Device::CPU, OpType::Sub, NativeElementWise, "subNaive_CPU");
     REGISTER_KERNEL(Device::CPU, OpType::Mul, NativeElementWise, "mulNaive_CPU");
     REGISTER_KERNEL(Device::CPU, OpType::Div, NativeElementWise, "divNaive_CPU");
+    REGISTER_KERNEL(Device::CPU, OpType::FusedElementWise, FusedElementWise,
+                    "FusedElementWise_CPU");
 }; // namespace infini
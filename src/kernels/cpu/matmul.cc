@@ -0,0 +1,639 @@
+#include "operators/matmul.h"
+#include "core/kernel.h"
+#include "utils/cpu_isa.h"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <immintrin.h>
+#include <memory>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace infini
+{
+    // Packed, cache-blocked SGEMM in the style of Goto/BLIS:
+    //   - B is packed into KC x NC blocks made of KC x NR micro-panels (L1/L3),
+    //     once per block into a buffer all threads read,
+    //   - A is packed into MC x KC blocks made of MR x KC micro-panels (L2),
+    //   - an MR x NR micro-kernel keeps the C tile in registers over KC.
+    // Operands are addressed through (row stride, column stride) pairs, so
+    // transA/transB are absorbed by the packing routines and never
+    // materialized. Bias and activation are applied by the micro-kernel
+    // after the last K block, before the C tile leaves the registers.
+    namespace
+    {
+        // The bias and activation of a fused MatMul.
+        struct Epilogue
+        {
+            // one value per column of C, or nullptr
+            const float *bias = nullptr;
+            MatmulActivation act = MatmulActivation::None;
+            // Clip bounds, +-Inf where absent
+            float lo = -INFINITY, hi = INFINITY;
+
+            bool empty() const
+            {
+                return !bias && act == MatmulActivation::None;
+            }
+
+            // the epilogue of a tile starting at column j
+            Epilogue at(int64_t j) const
+            {
+                Epilogue e = *this;
+                if (e.bias)
+                    e.bias += j;
+                return e;
+            }
+
+            // Same results as separate Add, Relu and Clip operators,
+            // including NaN: Relu maps it to 0, Clip passes it.
+            float apply(float v, int j) const
+            {
+                if (bias)
+                    v += bias[j];
+                if (act == MatmulActivation::Relu)
+                    v = std::max(0.f, v);
+                else if (act == MatmulActivation::Clip)
+                {
+                    v = v < lo ? lo : v;
+                    v = v > hi ? hi : v;
+                }
+                return v;
+            }
+        };
+
+        // `ep` is non-null for the last K block only
+        using MicroKernelFn = void (*)(int kc, const float *a, const float *b,
+                                       float *c, int64_t ldc, bool accumulate,
+                                       const Epilogue *ep);
+
+        struct GemmConfig
+        {
+            int mr, nr, mc, kc, nc;
+            MicroKernelFn microKernel;
+        };
+
+        // C[MR x NR] (+)= A_panel[MR x kc] * B_panel[kc x NR]
+        template <int MR, int NR>
+        void microKernelGeneric(int kc, const float *a, const float *b,
+                                float *c, int64_t ldc, bool accumulate,
+                                const Epilogue *ep)
+        {
+            float acc[MR][NR] = {};
+            for (int p = 0; p < kc; ++p)
+            {
+                for (int i = 0; i < MR; ++i)
+                {
+                    float ai = a[i];
+                    for (int j = 0; j < NR; ++j)
+                        acc[i][j] += ai * b[j];
+                }
+                a += MR;
+                b += NR;
+            }
+            for (int i = 0; i < MR; ++i)
+                for (int j = 0; j < NR; ++j)
+                {
+                    float v = accumulate ? c[i * ldc + j] + acc[i][j]
+                                         : acc[i][j];
+                    c[i * ldc + j] = ep ? ep->apply(v, j) : v;
+                }
+        }
+
+        __attribute__((target("avx2,fma"))) void
+        microKernelAvx2(int kc, const float *a, const float *b, float *c,
+                        int64_t ldc, bool accumulate, const Epilogue *ep)
+        {
+            constexpr int MR = 6;
+            __m256 acc[MR][2];
+#pragma GCC unroll 6
+            for (int i = 0; i < MR; ++i)
+                acc[i][0] = acc[i][1] = _mm256_setzero_ps();
+            for (int p = 0; p < kc; ++p)
+            {
+                __m256 b0 = _mm256_load_ps(b);
+                __m256 b1 = _mm256_load_ps(b + 8);
+#pragma GCC unroll 6
+                for (int i = 0; i < MR; ++i)
+                {
+                    __m256 ai = _mm256_broadcast_ss(a + i);
+                    acc[i][0] = _mm256_fmadd_ps(ai, b0, acc[i][0]);
+                    acc[i][1] = _mm256_fmadd_ps(ai, b1, acc[i][1]);
+                }
+                a += MR;
+                b += 16;
+            }
+#pragma GCC unroll 6
+            for (int i = 0; i < MR; ++i)
+            {
+                float *ci = c + i * ldc;
+                if (accumulate)
+                {
+                    acc[i][0] = _mm256_add_ps(acc[i][0], _mm256_loadu_ps(ci));
+                    acc[i][1] =
+                        _mm256_add_ps(acc[i][1], _mm256_loadu_ps(ci + 8));
+                }
+                if (ep)
+                {
+                    if (ep->bias)
+                    {
+                        acc[i][0] =
+                            _mm256_add_ps(acc[i][0], _mm256_loadu_ps(ep->bias));
+                        acc[i][1] = _mm256_add_ps(
+                            acc[i][1], _mm256_loadu_ps(ep->bias + 8));
+                    }
+                    // max(x, 0) maps NaN to 0 like Relu; max(lo, x) and
+                    // min(hi, x) pass it like Clip
+                    if (ep->act == MatmulActivation::Relu)
+                        for (auto &v : acc[i])
+                            v = _mm256_max_ps(v, _mm256_setzero_ps());
+                    else if (ep->act == MatmulActivation::Clip)
+                        for (auto &v : acc[i])
+                            v = _mm256_min_ps(
+                                _mm256_set1_ps(ep->hi),
+                                _mm256_max_ps(_mm256_set1_ps(ep->lo), v));
+                }
+                _mm256_storeu_ps(ci, acc[i][0]);
+                _mm256_storeu_ps(ci + 8, acc[i][1]);
+            }
+        }
+
+        __attribute__((target("avx512f"))) void
+        microKernelAvx512(int kc, const float *a, const float *b, float *c,
+                          int64_t ldc, bool accumulate, const Epilogue *ep)
+        {
+            constexpr int MR = 12;
+            __m512 acc[MR][2];
+#pragma GCC unroll 12
+            for (int i = 0; i < MR; ++i)
+                acc[i][0] = acc[i][1] = _mm512_setzero_ps();
+            for (int p = 0; p < kc; ++p)
+            {
+                __m512 b0 = _mm512_load_ps(b);
+                __m512 b1 = _mm512_load_ps(b + 16);
+#pragma GCC unroll 12
+                for (int i = 0; i < MR; ++i)
+                {
+                    __m512 ai = _mm512_set1_ps(a[i]);
+                    acc[i][0] = _mm512_fmadd_ps(ai, b0, acc[i][0]);
+                    acc[i][1] = _mm512_fmadd_ps(ai, b1, acc[i][1]);
+                }
+                a += MR;
+                b += 32;
+            }
+#pragma GCC unroll 12
+            for (int i = 0; i < MR; ++i)
+            {
+                float *ci = c + i * ldc;
+                if (accumulate)
+                {
+                    acc[i][0] = _mm512_add_ps(acc[i][0], _mm512_loadu_ps(ci));
+                    acc[i][1] =
+                        _mm512_add_ps(acc[i][1], _mm512_loadu_ps(ci + 16));
+                }
+                if (ep)
+                {
+                    if (ep->bias)
+                    {
+                        acc[i][0] =
+                            _mm512_add_ps(acc[i][0], _mm512_loadu_ps(ep->bias));
+                        acc[i][1] = _mm512_add_ps(
+                            acc[i][1], _mm512_loadu_ps(ep->bias + 16));
+                    }
+                    // the maskz forms keep GCC 12 from warning about the
+                    // undefined pass-through of the unmasked ones
+                    if (ep->act == MatmulActivation::Relu)
+                        for (auto &v : acc[i])
+                            v = _mm512_maskz_max_ps(0xffff, v,
+                                                    _mm512_setzero_ps());
+                    else if (ep->act == MatmulActivation::Clip)
+                        for (auto &v : acc[i])
+                            v = _mm512_maskz_min_ps(
+                                0xffff, _mm512_set1_ps(ep->hi),
+                                _mm512_maskz_max_ps(
+                                    0xffff, _mm512_set1_ps(ep->lo), v));
+                }
+                _mm512_storeu_ps(ci, acc[i][0]);
+                _mm512_storeu_ps(ci + 16, acc[i][1]);
+            }
+        }
+
+        const GemmConfig &getGemmConfig()
+        {
+            static const GemmConfig config = []
+            {
+                switch (getCpuIsa())
+                {
+                case CpuIsa::AVX512:
+                    return GemmConfig{12, 32, 144, 256, 1024, microKernelAvx512};
+                case CpuIsa::AVX2:
+                    return GemmConfig{6, 16, 144, 256, 1024, microKernelAvx2};
+                default:
+                    return GemmConfig{4, 16, 128, 256, 1024,
+                                      microKernelGeneric<4, 16>};
+                }
+            }();
+            return config;
+        }
+
+        // Pack an mc x kc block of A into MR-row micro-panels, zero padded.
+        void packA(const float *A, int64_t rs, int64_t cs, int mc, int kc,
+                   int MR, float *dst)
+        {
+            for (int i0 = 0; i0 < mc; i0 += MR)
+            {
+                int rows = std::min(MR, mc - i0);
+                const float *src = A + i0 * rs;
+                if (cs == 1)
+                {
+                    for (int i = 0; i < rows; ++i)
+                        for (int p = 0; p < kc; ++p)
+                            dst[p * MR + i] = src[i * rs + p];
+                }
+                else
+                {
+                    for (int p = 0; p < kc; ++p)
+                        for (int i = 0; i < rows; ++i)
+                            dst[p * MR + i] = src[i * rs + p * cs];
+                }
+                if (rows < MR)
+                    for (int p = 0; p < kc; ++p)
+                        for (int i = rows; i < MR; ++i)
+                            dst[p * MR + i] = 0.f;
+                dst += MR * kc;
+            }
+        }
+
+        // Pack a kc x nc block of B into NR-column micro-panels, zero padded.
+        void packB(const float *B, int64_t rs, int64_t cs, int kc, int nc,
+                   int NR, float *dst)
+        {
+            for (int j0 = 0; j0 < nc; j0 += NR)
+            {
+                int cols = std::min(NR, nc - j0);
+                const float *src = B + j0 * cs;
+                if (cs == 1)
+                {
+                    for (int p = 0; p < kc; ++p)
+                    {
+                        std::memcpy(dst + p * NR, src + p * rs,
+                                    cols * sizeof(float));
+                        for (int j = cols; j < NR; ++j)
+                            dst[p * NR + j] = 0.f;
+                    }
+                }
+                else
+                {
+                    for (int j = 0; j < cols; ++j)
+                        for (int p = 0; p < kc; ++p)
+                            dst[p * NR + j] = src[j * cs + p * rs];
+                    if (cols < NR)
+                        for (int p = 0; p < kc; ++p)
+                            for (int j = cols; j < NR; ++j)
+                                dst[p * NR + j] = 0.f;
+                }
+                dst += NR * kc;
+            }
+        }
+
+        struct AlignedFree
+        {
+            void operator()(float *p) const { std::free(p); }
+        };
+
+        // Per-thread packing buffers, grown on demand: 0 holds an A block,
+        // 1 the B block a gemm() call shares with its team.
+        float *threadBuffer(int which, size_t count)
+        {
+            thread_local std::unique_ptr<float, AlignedFree> buffers[2];
+            thread_local size_t capacity[2] = {0, 0};
+            if (capacity[which] < count)
+            {
+                size_t bytes = (count * sizeof(float) + 63) / 64 * 64;
+                buffers[which].reset(
+                    static_cast<float *>(std::aligned_alloc(64, bytes)));
+                IT_ASSERT(buffers[which] != nullptr);
+                capacity[which] = count;
+            }
+            return buffers[which].get();
+        }
+
+        // C = op(A) * op(B) with the epilogue, in the Goto/BLIS loop order:
+        // for every NC column block and KC depth block, B is packed once into
+        // the shared bufB, then each MC row block packs its A block into a
+        // per-thread buffer and runs the micro-kernel over its NR x MR tiles.
+        // With `parallel` the threads of one team split the packing of B and
+        // the (MC block, NR panel group) tasks; otherwise the caller's thread
+        // does all of it, e.g. when the batches are spread over the threads.
+        void gemm(const GemmConfig &cfg, int m, int n, int k, const float *A,
+                  int64_t rsA, int64_t csA, const float *B, int64_t rsB,
+                  int64_t csB, float *C, int64_t ldc, const Epilogue &ep,
+                  bool parallel)
+        {
+            if (k == 0)
+            {
+                for (int i = 0; i < m; ++i)
+                    for (int j = 0; j < n; ++j)
+                        C[i * ldc + j] = ep.apply(0.f, j);
+                return;
+            }
+            const int MR = cfg.mr, NR = cfg.nr;
+            float *bufB = threadBuffer(1, (size_t)cfg.kc * cfg.nc);
+            // at least GRAIN multiply-adds per thread, so that small GEMMs
+            // do not pay for the barriers between the blocks
+            constexpr int64_t GRAIN = 1 << 18;
+            int threads = 1;
+#ifdef _OPENMP
+            if (parallel)
+                threads = (int)std::min<int64_t>(omp_get_max_threads(),
+                                                 std::max<int64_t>(
+                                                     1, (int64_t)m * n * k /
+                                                            GRAIN));
+#endif
+            // split the NR panels of a column block into groups when there
+            // are fewer MC blocks than threads; each group repacks its A block
+            int blocksM = (m + cfg.mc - 1) / cfg.mc;
+            int groups = std::max(1, std::min((threads + blocksM - 1) / blocksM,
+                                              (std::min(n, cfg.nc) + NR - 1) /
+                                                  NR));
+
+#pragma omp parallel num_threads(threads) if (threads > 1)
+            {
+                float *bufA = threadBuffer(0, (size_t)cfg.mc * cfg.kc);
+                alignas(64) float edge[16 * 32];
+                for (int jc = 0; jc < n; jc += cfg.nc)
+                {
+                    int nc = std::min(cfg.nc, n - jc);
+                    int panelsB = (nc + NR - 1) / NR;
+                    int perGroup = (panelsB + groups - 1) / groups;
+                    for (int pc = 0; pc < k; pc += cfg.kc)
+                    {
+                        int kc = std::min(cfg.kc, k - pc);
+                        bool accumulate = pc != 0;
+                        bool last = pc + kc >= k && !ep.empty();
+                        // the implicit barriers keep bufB whole while the
+                        // tasks read it
+#pragma omp for schedule(static)
+                        for (int jr = 0; jr < panelsB; ++jr)
+                            packB(B + pc * rsB + (jc + jr * NR) * csB, rsB, csB,
+                                  kc, std::min(NR, nc - jr * NR), NR,
+                                  bufB + (size_t)jr * NR * kc);
+#pragma omp for schedule(dynamic)
+                        for (int task = 0; task < blocksM * groups; ++task)
+                        {
+                            int ic = task / groups * cfg.mc;
+                            int mc = std::min(cfg.mc, m - ic);
+                            int jr0 = task % groups * perGroup;
+                            int jr1 = std::min(panelsB, jr0 + perGroup);
+                            if (jr0 >= jr1)
+                                continue;
+                            packA(A + ic * rsA + pc * csA, rsA, csA, mc, kc, MR,
+                                  bufA);
+                            for (int jr = jr0; jr < jr1; ++jr)
+                            {
+                                int j0 = jr * NR;
+                                int cols = std::min(NR, nc - j0);
+                                const float *panelB = bufB + (size_t)j0 * kc;
+                                Epilogue tileEp = ep.at(jc + j0);
+                                for (int i0 = 0; i0 < mc; i0 += MR)
+                                {
+                                    int rows = std::min(MR, mc - i0);
+                                    const float *panelA =
+                                        bufA + (size_t)i0 * kc;
+                                    float *c = C + (ic + i0) * ldc + jc + j0;
+                                    if (rows == MR && cols == NR)
+                                    {
+                                        cfg.microKernel(kc, panelA, panelB, c,
+                                                        ldc, accumulate,
+                                                        last ? &tileEp
+                                                             : nullptr);
+                                        continue;
+                                    }
+                                    cfg.microKernel(kc, panelA, panelB, edge,
+                                                    NR, false, nullptr);
+                                    for (int i = 0; i < rows; ++i)
+                                        for (int j = 0; j < cols; ++j)
+                                        {
+                                            float v = accumulate
+                                                          ? c[i * ldc + j] +
+                                                                edge[i * NR + j]
+                                                          : edge[i * NR + j];
+                                            c[i * ldc + j] =
+                                                last ? tileEp.apply(v, j) : v;
+                                        }
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        // Element offsets of every output batch in A and B, following the
+        // right-aligned broadcasting allowed by MatmulObj::inferShape.
+        void batchOffsets(const Shape &outDims, const Shape &dimsA,
+                          const vector<int64_t> &stridesA, const Shape &dimsB,
+                          const vector<int64_t> &stridesB,
+                          vector<int64_t> &offA, vector<int64_t> &offB)
+        {
+            int batchRank = outDims.size() - 2;
+            size_t batch = 1;
+            for (int i = 0; i < batchRank; ++i)
+                batch *= outDims[i];
+            offA.assign(batch, 0);
+            offB.assign(batch, 0);
+
+            auto strides = [&](const Shape &dims, const vector<int64_t> &st)
+            {
+                // stride of each output batch dim inside the operand,
+                // 0 where the operand is broadcast
+                vector<int64_t> s(batchRank, 0);
+                int rank = dims.size();
+                for (int i = rank - 3, o = batchRank - 1; i >= 0; --i, --o)
+                    s[o] = dims[i] == 1 ? 0 : st[i];
+                return s;
+            };
+            auto sA = strides(dimsA, stridesA), sB = strides(dimsB, stridesB);
+            for (size_t b = 0; b < batch; ++b)
+            {
+                size_t rest = b;
+                int64_t a = 0, c = 0;
+                for (int i = batchRank - 1; i >= 0; --i)
+                {
+                    size_t idx = rest % outDims[i];
+                    rest /= outDims[i];
+                    a += idx * sA[i];
+                    c += idx * sB[i];
+                }
+                offA[b] = a;
+                offB[b] = c;
+            }
+        }
+    } // namespace
+
+    class NativeMatmul : public CpuKernelWithoutConfig
+    {
+        // The epilogue of the reference path, for any T: the same operations
+        // as separate Add, Relu and Clip operators.
+        template <typename T>
+        static void epilogueReference(const T *bias, MatmulActivation act,
+                                      std::optional<float> minValue,
+                                      std::optional<float> maxValue, int m,
+                                      int n, T *C)
+        {
+            for (int64_t i = 0; i < (int64_t)m * n; ++i)
+            {
+                T v = C[i];
+                if (bias)
+                    v = v + bias[i % n];
+                if (act == MatmulActivation::Relu)
+                    v = std::max(T(0), v);
+                else if (act == MatmulActivation::Clip)
+                    v = (minValue && v < *minValue)   ? *minValue
+                        : (maxValue && v > *maxValue) ? *maxValue
+                                                      : v;
+                C[i] = v;
+            }
+        }
+
+        template <typename T>
+        static void gemmReference(int m, int n, int k, const T *A, int64_t rsA,
+                                  int64_t csA, const T *B, int64_t rsB,
+                                  int64_t csB, T *C)
+        {
+            for (int i = 0; i < m; ++i)
+            {
+                T *c = C + (int64_t)i * n;
+                std::fill(c, c + n, T(0));
+                for (int p = 0; p < k; ++p)
+                {
+                    T a = A[i * rsA + p * csA];
+                    for (int j = 0; j < n; ++j)
+                        c[j] += a * B[p * rsB + j * csB];
+                }
+            }
+        }
+
+        template <typename T>
+        KernelLaunch doPrepare(const Operator &_op,
+                               const RuntimeObj *context) const
+        {
+            auto op = as<MatmulObj>(_op);
+            const auto &A = op->getInputs(0), &B = op->getInputs(1);
+            const auto &C = op->getOutput();
+            auto dimsA = A->getDims(), dimsB = B->getDims();
+            auto outDims = C->getDims();
+            int rankA = dimsA.size(), rankB = dimsB.size();
+            bool transA = op->getTransA(), transB = op->getTransB();
+
+            int m = outDims[outDims.size() - 2];
+            int n = outDims[outDims.size() - 1];
+            int k = transA ? dimsA[rankA - 2] : dimsA[rankA - 1];
+            IT_ASSERT(k == (transB ? dimsB[rankB - 1] : dimsB[rankB - 2]));
+
+            // (row stride, column stride) of op(A) and op(B); A and B may be
+            // strided views, e.g. of a Transpose elided by the planner
+            auto stridesA = A->getStrides(), stridesB = B->getStrides();
+            int64_t rowA = stridesA[rankA - 2], colA = stridesA[rankA - 1];
+            int64_t rowB = stridesB[rankB - 2], colB = stridesB[rankB - 1];
+            int64_t rsA = transA ? colA : rowA, csA = transA ? rowA : colA;
+            int64_t rsB = transB ? colB : rowB, csB = transB ? rowB : colB;
+
+            vector<int64_t> offA, offB;
+            batchOffsets(outDims, dimsA, stridesA, dimsB, stridesB, offA, offB);
+            int batch = offA.size();
+
+            const T *ptrA = A->getRawDataPtr<T *>();
+            const T *ptrB = B->getRawDataPtr<T *>();
+            T *ptrC = C->getRawDataPtr<T *>();
+            int64_t sizeC = (int64_t)m * n;
+            const T *bias = nullptr;
+            if (auto t = op->getBias())
+            {
+                IT_ASSERT(t->isContiguous());
+                bias = t->getRawDataPtr<T *>();
+            }
+
+            if constexpr (std::is_same_v<T, float>)
+            {
+                const auto &cfg = getGemmConfig();
+                Epilogue ep;
+                ep.bias = bias;
+                ep.act = op->getActivation();
+                ep.lo = op->getClipMin().value_or(-INFINITY);
+                ep.hi = op->getClipMax().value_or(INFINITY);
+                return [=, &cfg, offA = std::move(offA),
+                        offB = std::move(offB)]
+                {
+                    // enough batches to keep every thread busy: one whole
+                    // GEMM per thread at a time, else one GEMM at a time
+                    // split over the threads
+                    int threads = 1;
+#ifdef _OPENMP
+                    threads = omp_get_max_threads();
+#endif
+                    if (batch >= threads && threads > 1)
+                    {
+#pragma omp parallel for schedule(dynamic)
+                        for (int b = 0; b < batch; ++b)
+                            gemm(cfg, m, n, k, ptrA + offA[b], rsA, csA,
+                                 ptrB + offB[b], rsB, csB, ptrC + b * sizeC, n,
+                                 ep, false);
+                        return;
+                    }
+                    for (int b = 0; b < batch; ++b)
+                        gemm(cfg, m, n, k, ptrA + offA[b], rsA, csA,
+                             ptrB + offB[b], rsB, csB, ptrC + b * sizeC, n, ep,
+                             true);
+                };
+            }
+            else
+            {
+                auto act = op->getActivation();
+                auto minValue = op->getClipMin(), maxValue = op->getClipMax();
+                bool fused = bias || act != MatmulActivation::None;
+                return [=, offA = std::move(offA), offB = std::move(offB)]
+                {
+#pragma omp parallel for
+                    for (int b = 0; b < batch; ++b)
+                    {
+                        gemmReference(m, n, k, ptrA + offA[b], rsA, csA,
+                                      ptrB + offB[b], rsB, csB,
+                                      ptrC + b * sizeC);
+                        if (fused)
+                            epilogueReference(bias, act, minValue, maxValue,
+                                              m, n, ptrC + b * sizeC);
+                    }
+                };
+            }
+        }
+
+        KernelLaunch prepare(const Operator &_op,
+                             const RuntimeObj *context) const override
+        {
+#define CASE(N) \
+    case N:     \
+        return doPrepare<DT<N>::t>(_op, context)
+
+            int dataTypeIdx = _op->getDType().getIndex();
+            switch (dataTypeIdx)
+            {
+                CASE(1); // DataType::Float32
+                CASE(12); // DataType::UInt32
+            default:
+                IT_TODO_HALT();
+            }
+#undef CASE
+        }
+
+        void compute(const Operator &_op,
+                     const RuntimeObj *context) const override
+        {
+            prepare(_op, context)();
+        }
+    };
+
+    REGISTER_KERNEL(Device::CPU, OpType::MatMul, NativeMatmul, "MatmulPacked_CPU");
+
+}; // namespace infini
@@ -1,60 +1,305 @@
 #include "operators/transpose.h"
 #include "core/kernel.h"
+#include "utils/broadcast.h"
+#include "utils/cpu_isa.h"
+#include <cstring>
+#include <immintrin.h>
 
 namespace infini {
 
-inline Shape idx2Pos(const Shape &shape, size_t idx) {
-    Shape pos = Shape(shape.size(), 0);
-    auto rest = idx, curDimId = shape.size() - 1;
-    while (rest > 0) {
-        pos[curDimId] = rest % shape[curDimId];
-        rest /= shape[curDimId];
-        curDimId--;
+namespace {
+
+// Side of the square tiles the two swapped dims are cut into.
+constexpr int64_t TILE = 32;
+
+// Drops size-1 dims and merges input dims that stay adjacent in the output.
+// On return output dim j is input dim perm[j] of `shape`.
+void collapseDims(const Shape &inDim, const vector<int> &permute, Shape &shape,
+                  vector<int> &perm) {
+    int rank = inDim.size();
+    vector<int> order; // output order of the non-trivial input dims
+    for (int j = 0; j < rank; ++j)
+        if (inDim[permute[j]] != 1)
+            order.emplace_back(permute[j]);
+
+    // runs of consecutive input dims, in output order
+    vector<pair<int, int>> runs;
+    for (auto d : order) {
+        if (!runs.empty() && runs.back().second + 1 == d)
+            runs.back().second = d;
+        else
+            runs.emplace_back(d, d);
+    }
+    vector<int> byInput(runs.size());
+    for (size_t i = 0; i < runs.size(); ++i)
+        byInput[i] = i;
+    std::sort(byInput.begin(), byInput.end(), [&](int x, int y) {
+        return runs[x].first < runs[y].first;
+    });
+
+    shape.assign(runs.size(), 1);
+    perm.assign(runs.size(), 0);
+    for (size_t i = 0; i < byInput.size(); ++i) {
+        auto [first, last] = runs[byInput[i]];
+        for (int d = first; d <= last; ++d)
+            shape[i] *= inDim[d];
+        perm[byInput[i]] = i;
+    }
+}
+
+// A view whose strides are a permutation of the dense strides of some shape
+// is that dense tensor transposed. If so, rewrites `dims` and `permute` to
+// transpose the dense tensor directly, composing both permutations.
+bool denseBase(const vector<int64_t> &strides, Shape &dims,
+               vector<int> &permute) {
+    int rank = dims.size();
+    // base dim k is view dim order[k], outermost (largest stride) first
+    vector<int> order(rank);
+    for (int i = 0; i < rank; ++i)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(),
+                     [&](int a, int b) { return strides[a] > strides[b]; });
+    Shape base(rank);
+    int64_t acc = 1;
+    for (int k = rank - 1; k >= 0; --k) {
+        base[k] = dims[order[k]];
+        if (base[k] != 1 && strides[order[k]] != acc)
+            return false;
+        acc *= base[k];
+    }
+    vector<int> baseDim(rank); // base dim of every view dim
+    for (int k = 0; k < rank; ++k)
+        baseDim[order[k]] = k;
+    for (auto &p : permute)
+        p = baseDim[p];
+    dims = std::move(base);
+    return true;
+}
+
+vector<int64_t> denseStrides(const Shape &shape) {
+    vector<int64_t> stride(shape.size());
+    int64_t acc = 1;
+    for (size_t i = shape.size(); i > 0; --i) {
+        stride[i - 1] = acc;
+        acc *= shape[i - 1];
     }
-    return pos;
+    return stride;
 }
 
-class NaiveTranspose : public CpuKernelWithoutConfig {
+__attribute__((target("avx2"), always_inline)) inline void
+transpose8x8Avx2(const float *src, int64_t srcStride, float *dst,
+                 int64_t dstStride) {
+    __m256 r0 = _mm256_loadu_ps(src + 0 * srcStride);
+    __m256 r1 = _mm256_loadu_ps(src + 1 * srcStride);
+    __m256 r2 = _mm256_loadu_ps(src + 2 * srcStride);
+    __m256 r3 = _mm256_loadu_ps(src + 3 * srcStride);
+    __m256 r4 = _mm256_loadu_ps(src + 4 * srcStride);
+    __m256 r5 = _mm256_loadu_ps(src + 5 * srcStride);
+    __m256 r6 = _mm256_loadu_ps(src + 6 * srcStride);
+    __m256 r7 = _mm256_loadu_ps(src + 7 * srcStride);
+    __m256 t0 = _mm256_unpacklo_ps(r0, r1), t1 = _mm256_unpackhi_ps(r0, r1);
+    __m256 t2 = _mm256_unpacklo_ps(r2, r3), t3 = _mm256_unpackhi_ps(r2, r3);
+    __m256 t4 = _mm256_unpacklo_ps(r4, r5), t5 = _mm256_unpackhi_ps(r4, r5);
+    __m256 t6 = _mm256_unpacklo_ps(r6, r7), t7 = _mm256_unpackhi_ps(r6, r7);
+    r0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+    r1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+    r2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    r3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+    r4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+    r5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+    r6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+    r7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+    _mm256_storeu_ps(dst + 0 * dstStride, _mm256_permute2f128_ps(r0, r4, 0x20));
+    _mm256_storeu_ps(dst + 1 * dstStride, _mm256_permute2f128_ps(r1, r5, 0x20));
+    _mm256_storeu_ps(dst + 2 * dstStride, _mm256_permute2f128_ps(r2, r6, 0x20));
+    _mm256_storeu_ps(dst + 3 * dstStride, _mm256_permute2f128_ps(r3, r7, 0x20));
+    _mm256_storeu_ps(dst + 4 * dstStride, _mm256_permute2f128_ps(r0, r4, 0x31));
+    _mm256_storeu_ps(dst + 5 * dstStride, _mm256_permute2f128_ps(r1, r5, 0x31));
+    _mm256_storeu_ps(dst + 6 * dstStride, _mm256_permute2f128_ps(r2, r6, 0x31));
+    _mm256_storeu_ps(dst + 7 * dstStride, _mm256_permute2f128_ps(r3, r7, 0x31));
+}
+
+// dst[x * dstStride + y] = src[y * srcStride + x] for a ny x nx tile.
+template <typename T>
+void transposeTile(const T *src, int64_t srcStride, T *dst, int64_t dstStride,
+                   int64_t ny, int64_t nx) {
+    for (int64_t y = 0; y < ny; ++y)
+        for (int64_t x = 0; x < nx; ++x)
+            dst[x * dstStride + y] = src[y * srcStride + x];
+}
+
+// 4-byte elements: full 8x8 blocks are transposed in registers.
+__attribute__((target("avx2"))) void
+transposeTile4Avx2(const uint32_t *src, int64_t srcStride, uint32_t *dst,
+                   int64_t dstStride, int64_t ny, int64_t nx) {
+    int64_t fy = ny / 8 * 8, fx = nx / 8 * 8;
+    // walk along the output rows so that they fill up one after another
+    for (int64_t x = 0; x < fx; x += 8)
+        for (int64_t y = 0; y < fy; y += 8)
+            transpose8x8Avx2(
+                reinterpret_cast<const float *>(src + y * srcStride + x),
+                srcStride, reinterpret_cast<float *>(dst + x * dstStride + y),
+                dstStride);
+    if (fx < nx)
+        transposeTile(src + fx, srcStride, dst + fx * dstStride, dstStride, fy,
+                      nx - fx);
+    if (fy < ny)
+        transposeTile(src + fy * srcStride, srcStride, dst + fy, dstStride,
+                      ny - fy, nx);
+}
+
+} // namespace
+
+class TiledTranspose : public CpuKernelWithoutConfig {
+    // Transposes are pure data movement, so T only carries the element size.
     template <typename T>
-    void doCompute(const Operator &_op, const RuntimeObj *context) const {
+    KernelLaunch doPrepare(const Operator &_op,
+                           const RuntimeObj *context) const {
         auto op = as<TransposeObj>(_op);
         auto inputs = op->getInputs(), outputs = op->getOutputs();
-        const auto &inDim = inputs[0]->getDims();
-        const auto &perm = op->getPermute();
-
-        size_t inSize = inputs[0]->size();
         auto inPtr = inputs[0]->getRawDataPtr<T *>(),
              outPtr = outputs[0]->getRawDataPtr<T *>();
-        // #pragma omp parallel for
-        for (size_t inIdx = 0; inIdx < inSize; ++inIdx) {
-            auto posInput = idx2Pos(inDim, inIdx);
-            int outIdx = 0;
-            for (size_t j = 0, jEnd = perm.size(); j < jEnd; ++j) {
-                outIdx = outIdx * inDim[perm[j]] + posInput[perm[j]];
-            }
-            outPtr[outIdx] = inPtr[inIdx];
+        int64_t size = inputs[0]->size();
+
+        // the planner made the output a view of the input: nothing to do
+        if (static_cast<void *>(outPtr) == static_cast<void *>(inPtr))
+            return [] {};
+        Shape inDims = inputs[0]->getDims();
+        vector<int> permute = op->getPermute();
+        if (!inputs[0]->isContiguous() &&
+            !denseBase(inputs[0]->getStrides(), inDims, permute)) {
+            // any other strided view: gather it in output order
+            auto inStrides = inputs[0]->getStrides();
+            vector<int64_t> srcStrides(permute.size());
+            for (size_t j = 0; j < permute.size(); ++j)
+                srcStrides[j] = inStrides[permute[j]];
+            auto outDims = outputs[0]->getDims();
+            auto outStrides = outputs[0]->getStrides();
+            return [=] {
+                copyStrided(outPtr, outStrides, inPtr, srcStrides, outDims,
+                            sizeof(T));
+            };
+        }
+
+        Shape shape;
+        vector<int> perm;
+        collapseDims(inDims, permute, shape, perm);
+        int rank = shape.size();
+        bool identity = true;
+        for (int j = 0; j < rank; ++j)
+            identity &= perm[j] == j;
+        if (identity) {
+            // nothing moves: a parallel copy of the whole tensor
+            return [=] {
+                constexpr int64_t chunk = 1 << 16;
+#pragma omp parallel for if (size > chunk)
+                for (int64_t i = 0; i < size; i += chunk)
+                    std::memcpy(outPtr + i, inPtr + i,
+                                std::min(chunk, size - i) * sizeof(T));
+            };
         }
+
+        Shape outShape(rank);
+        for (int j = 0; j < rank; ++j)
+            outShape[j] = shape[perm[j]];
+        auto inStride = denseStrides(shape), outStride = denseStrides(outShape);
+        // input stride of every output dim
+        vector<int64_t> srcStride(rank);
+        for (int j = 0; j < rank; ++j)
+            srcStride[j] = inStride[perm[j]];
+
+        if (perm[rank - 1] == rank - 1) {
+            // The innermost dim does not move: output rows are contiguous
+            // blocks of the input. One memcpy per block, in output order.
+            int64_t block = shape[rank - 1];
+            int64_t inner = outShape[rank - 2], innerStride = srcStride[rank - 2];
+            int64_t outer = size / block / inner;
+            return [=] {
+#pragma omp parallel for if (size > (1 << 14))
+                for (int64_t o = 0; o < outer; ++o) {
+                    int64_t src = 0, rest = o;
+                    for (int j = rank - 3; j >= 0; --j) {
+                        src += rest % outShape[j] * srcStride[j];
+                        rest /= outShape[j];
+                    }
+                    T *dst = outPtr + o * inner * block;
+                    for (int64_t i = 0; i < inner; ++i)
+                        std::memcpy(dst + i * block,
+                                    inPtr + src + i * innerStride,
+                                    block * sizeof(T));
+                }
+            };
+        }
+
+        // The innermost input dim `x` moves to output position q and the
+        // innermost output dim reads input dim `y`; both are cut into tiles
+        // so every tile is read and written along cache lines.
+        int q = 0;
+        while (perm[q] != rank - 1)
+            ++q;
+        int y = perm[rank - 1];
+        int64_t nx = shape[rank - 1], ny = shape[y];
+        int64_t xStride = outStride[q], yStride = inStride[y];
+        vector<int> outerDims;
+        for (int j = 0; j < rank - 1; ++j)
+            if (j != q)
+                outerDims.emplace_back(j);
+        int64_t tilesX = (nx + TILE - 1) / TILE, tilesY = (ny + TILE - 1) / TILE;
+        int64_t units = size / nx / ny * tilesX * tilesY;
+        bool simd = getCpuIsa() >= CpuIsa::AVX2;
+
+        return [=] {
+#pragma omp parallel for if (size > (1 << 14))
+            for (int64_t u = 0; u < units; ++u) {
+                int64_t tx = u % tilesX, ty = u / tilesX % tilesY;
+                int64_t rest = u / tilesX / tilesY, src = 0, dst = 0;
+                for (int i = (int)outerDims.size() - 1; i >= 0; --i) {
+                    int j = outerDims[i];
+                    int64_t idx = rest % outShape[j];
+                    rest /= outShape[j];
+                    src += idx * srcStride[j];
+                    dst += idx * outStride[j];
+                }
+                int64_t x0 = tx * TILE, y0 = ty * TILE;
+                const T *from = inPtr + src + y0 * yStride + x0;
+                T *to = outPtr + dst + x0 * xStride + y0;
+                int64_t tileY = std::min(TILE, ny - y0),
+                        tileX = std::min(TILE, nx - x0);
+                if constexpr (sizeof(T) == 4) {
+                    if (simd) {
+                        transposeTile4Avx2(from, yStride, to, xStride, tileY,
+                                           tileX);
+                        continue;
+                    }
+                }
+                transposeTile(from, yStride, to, xStride, tileY, tileX);
+            }
+        };
     }
 
-    void compute(const Operator &_op,
-                 const RuntimeObj *context) const override {
-#define CASE(N)                                                                \
-    case N:                                                                    \
-        doCompute<DT<N>::t>(_op, context)
-
-        int dataTypeIdx = _op->getDType().getIndex();
-        switch (dataTypeIdx) {
-            CASE(1); // DataType::Float32
-            break;
-            CASE(12); // DataType::UInt32
-            break;
+    KernelLaunch prepare(const Operator &_op,
+                         const RuntimeObj *context) const override {
+        switch (_op->getDType().getSize()) {
+        case 1:
+            return doPrepare<uint8_t>(_op, context);
+        case 2:
+            return doPrepare<uint16_t>(_op, context);
+        case 4:
+            return doPrepare<uint32_t>(_op, context);
+        case 8:
+            return doPrepare<uint64_t>(_op, context);
         default:
             IT_TODO_HALT();
         }
     }
+
+    void compute(const Operator &_op,
+                 const RuntimeObj *context) const override {
+        prepare(_op, context)();
+    }
 };
 
-REGISTER_KERNEL(Device::CPU, OpType::Transpose, NaiveTranspose,
-                "TransposeNaive_CPU");
+REGISTER_KERNEL(Device::CPU, OpType::Transpose, TiledTranspose,
+                "TransposeTiled_CPU");
 
 } // namespace infini
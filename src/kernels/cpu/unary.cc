@@ -12,13 +12,14 @@ namespace infini
         }
 
         template <typename T>
-        void doCompute(const Operator &_op, const RuntimeObj *context) const
+        KernelLaunch doPrepare(const Operator &_op,
+                               const RuntimeObj *context) const
         {
             auto op = as<UnaryObj>(_op);
+            IT_ASSERT(op->getInputs(0)->isContiguous());
             T *inptr = op->getInputs(0)->getRawDataPtr<T *>();
             T *outptr = op->getOutput()->getRawDataPtr<T *>();
 
-            auto outDim = op->getOutput()->getDims();
             auto n = op->getOutput()->size();
 
             T (*_doCompute)
@@ -32,70 +33,91 @@ namespace infini
                 IT_TODO_HALT();
             }
 
-            for (size_t offset = 0; offset < n; offset++)
+            // outptr may be inptr when the graph runs the operator in place
+            return [=]
             {
-                outptr[offset] = _doCompute(inptr[offset]);
-            }
+                for (size_t offset = 0; offset < n; offset++)
+                {
+                    outptr[offset] = _doCompute(inptr[offset]);
+                }
+            };
         }
 
-        void compute(const Operator &_op,
-                     const RuntimeObj *context) const override
+        KernelLaunch prepare(const Operator &_op,
+                             const RuntimeObj *context) const override
         {
 #define CASE(N) \
     case N:     \
-        doCompute<DT<N>::t>(_op, context)
+        return doPrepare<DT<N>::t>(_op, context)
 
             int dataTypeIdx = _op->getDType().getIndex();
             switch (dataTypeIdx)
             {
                 CASE(1); // DataType::Float32
-                break;
                 CASE(12); // DataType::UInt32
-                break;
             default:
                 IT_TODO_HALT();
             }
+#undef CASE
+        }
+
+        void compute(const Operator &_op,
+                     const RuntimeObj *context) const override
+        {
+            prepare(_op, context)();
         }
     };
 
     class Clip : public CpuKernelWithoutConfig
     {
         template <typename T>
-        void doCompute(const Operator &_op, const RuntimeObj *context) const
+        KernelLaunch doPrepare(const Operator &_op,
+                               const RuntimeObj *context) const
         {
             auto op = as<ClipObj>(_op);
+            IT_ASSERT(op->getInputs(0)->isContiguous());
             T *inptr = op->getInputs(0)->getRawDataPtr<T *>();
             T *outptr = op->getOutput()->getRawDataPtr<T *>();
             auto minValue = op->getMin();
             auto maxValue = op->getMax();
 
             auto n = op->getOutput()->size();
-            for (size_t offset = 0; offset < n; offset++)
+            // each element is read before it is written, in place included
+            return [=]
             {
-                auto val = *inptr++;
-                *outptr++ = (minValue && val < *minValue)   ? *minValue
-                            : (maxValue && val > *maxValue) ? *maxValue
-                                                            : val;
-            }
+                for (size_t offset = 0; offset < n; offset++)
+                {
+                    auto val = inptr[offset];
+                    outptr[offset] = (minValue && val < *minValue) ? *minValue
+                                     : (maxValue && val > *maxValue)
+                                         ? *maxValue
+                                         : val;
+                }
+            };
         }
 
-        void compute(const Operator &_op,
-                     const RuntimeObj *context) const override
+        KernelLaunch prepare(const Operator &_op,
+                             const RuntimeObj *context) const override
         {
 #define CASE(N) \
     case N:     \
-        doCompute<DT<N>::t>(_op, context)
+        return doPrepare<DT<N>::t>(_op, context)
 
             int dataTypeIdx = _op->getDType().getIndex();
             switch (dataTypeIdx)
             {
                 CASE(1); // DataType::Float32
-                break;
                 CASE(12); // DataType::UInt32
-                break;
             default:
                 IT_TODO_HALT();
             }
+#undef CASE
+        }
+
+        void compute(const Operator &_op,
+                     const RuntimeObj *context) const override
+        {
+            prepare(_op, context)();
         }
     };
 
@@ -14,10 +14,15 @@ optional<vector<Shape>> ConcatObj::inferShape(const TensorVec &inputs) {
     auto rank = inputs[0]->getRank();
     for (size_t i = 1; i < inputs.size(); ++i) {
         const auto &inputShape = inputs[i]->getDims();
+        // inputs may only differ along the concatenated dim
+        if (inputShape.size() != rank ||
+            !(inputs[i]->getDType() == inputs[0]->getDType()))
+            return {};
         for (size_t j = 0; j < rank; ++j) {
-            if (j == static_cast<size_t>(dim)) {
+            if (j == static_cast<size_t>(dim))
                 dims[j] += inputShape[j];
-            } 
+            else if (inputShape[j] != dims[j])
+                return {};
         }
     }
     return {{dims}};
@@ -30,4 +30,52 @@ namespace infini
         return os.str();
     }
 
+    FusedElementWiseObj::FusedElementWiseObj(GraphObj *graph, TensorVec inputs,
+                                             Tensor output,
+                                             vector<FusedStep> steps)
+        : OperatorObj(OpType::FusedElementWise, inputs, {output}),
+          steps(std::move(steps))
+    {
+        IT_ASSERT(!this->steps.empty());
+        for (auto &step : this->steps)
+            if (step.operand >= 0)
+                IT_ASSERT(step.operand < (int)inputs.size());
+        IT_ASSERT(checkValid(graph));
+    }
+
+    optional<vector<Shape>>
+    FusedElementWiseObj::inferShape(const TensorVec &inputs)
+    {
+        Shape res = inputs[0]->getDims();
+        for (size_t i = 1; i < inputs.size(); ++i)
+        {
+            if (!(inputs[i]->getDType() == inputs[0]->getDType()))
+                return {};
+            res = infer_broadcast(res, inputs[i]->getDims());
+        }
+        return {{res}};
+    }
+
+    std::string FusedElementWiseObj::toString() const
+    {
+        std::ostringstream os;
+        os << type.toString() << "[" << getGuid() << "]";
+        os << "(";
+        for (auto &input : inputs)
+            os << vecToString(input->getDims()) << ",";
+        os << "steps=";
+        for (auto &step : steps)
+        {
+            os << step.type.toString();
+            if (step.operand >= 0)
+                os << (step.reversed ? "<" : ">") << step.operand;
+            os << ";";
+        }
+        os << "input=";
+        for (auto &input : inputs)
+            os << input->getGuid() << ",";
+        os << "output=" << outputs[0]->getGuid() << ")";
+        return os.str();
+    }
+
 }; // namespace infini
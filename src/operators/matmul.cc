@@ -4,9 +4,13 @@ namespace infini
 {
 
     MatmulObj::MatmulObj(GraphObj *graph, Tensor A, Tensor B, Tensor C, bool transA,
-                         bool transB)
-        : OperatorObj(OpType::MatMul, TensorVec{A, B}, {C}),
-          transA(transA), transB(transB)
+                         bool transB, Tensor bias, MatmulActivation act,
+                         std::optional<float> clipMin,
+                         std::optional<float> clipMax)
+        : OperatorObj(OpType::MatMul,
+                      bias ? TensorVec{A, B, bias} : TensorVec{A, B}, {C}),
+          transA(transA), transB(transB), act(act), clipMin(clipMin),
+          clipMax(clipMax)
     {
         IT_ASSERT(checkValid(graph));
     }
@@ -16,20 +20,27 @@ namespace infini
         std::ostringstream os;
         os << "Matmul([" << (transA ? "A^T" : "A") << "," << (transB ? "B^T" : "B]")
            << ",A=" << inputs[0]->getGuid()
-           << ",B=" << inputs[1]->getGuid() << ",C=" << outputs[0]->getGuid()
+           << ",B=" << inputs[1]->getGuid();
+        if (inputs.size() > 2)
+            os << ",bias=" << inputs[2]->getGuid();
+        if (act == MatmulActivation::Relu)
+            os << ",act=Relu";
+        else if (act == MatmulActivation::Clip)
+            os << ",act=Clip";
+        os << ",C=" << outputs[0]->getGuid()
            << ",mnk=[" << m << "," << n << "," << k << "])";
         return os.str();
     }
 
     optional<vector<Shape>> MatmulObj::inferShape(const TensorVec &inputs)
     {
-        if (inputs.size() != 2)
+        if (inputs.size() != 2 && inputs.size() != 3)
         {
             return std::nullopt;
         }
-        size_t rankA = inputs[0] -> getRank();
-        size_t rankB = inputs[1] -> getRank();
-        
+        size_t rankA = inputs[0]->getRank();
+        size_t rankB = inputs[1]->getRank();
+
         if (rankA < 2 || rankB < 2) {
             return std::nullopt; // 最后两维必须存在
         }
@@ -37,37 +48,22 @@ namespace infini
         const Shape &shapeA = inputs[0]->getDims();
         const Shape &shapeB = inputs[1]->getDims();
 
-        int64_t dimA_last = shapeA[rankA - 1];
-        int64_t dimA_sec_Last = shapeA[rankA - 2];
-        int64_t dimB_last = shapeB[rankB - 1];
-        int64_t dimB_sec_Last = shapeB[rankB - 2];
-
-        if (dimA_last == dimB_sec_Last) {
-            dimA_sec_Last = dimA_sec_Last;
-            dimB_last = dimB_last;
-        }
-        else if (dimA_last == dimB_last) {
-            dimA_sec_Last = dimA_sec_Last;
-            dimB_last = dimB_sec_Last;
-        }
-        else if (dimA_sec_Last == dimB_sec_Last) {
-            dimA_sec_Last = dimA_last;
-            dimB_last = dimB_last;
-        }
-        else if (dimA_sec_Last == dimB_last) {
-            dimA_sec_Last = dimA_last;
-            dimB_last = dimB_sec_Last;
-        }
-        else
+        // transA/transB decide which of the last two dims is contracted
+        int mA = transA ? shapeA[rankA - 1] : shapeA[rankA - 2];
+        int kA = transA ? shapeA[rankA - 2] : shapeA[rankA - 1];
+        int kB = transB ? shapeB[rankB - 1] : shapeB[rankB - 2];
+        int nB = transB ? shapeB[rankB - 2] : shapeB[rankB - 1];
+        if (kA != kB)
         {
-            return std::nullopt;    
+            return std::nullopt;
         }
-        Shape outputShape;    
 
+        Shape outputShape;
         size_t maxRank = std::max(rankA, rankB);
         for (size_t i = 0; i < maxRank - 2; ++i) {
-            int64_t dimA = i < rankA ? shapeA[rankA - maxRank + i] : 1;
-            int64_t dimB = i < rankB ? shapeB[rankB - maxRank + i] : 1;
+            // leading dims are aligned to the right, missing ones count as 1
+            int dimA = i + rankA >= maxRank ? shapeA[i + rankA - maxRank] : 1;
+            int dimB = i + rankB >= maxRank ? shapeB[i + rankB - maxRank] : 1;
 
             if (dimA != dimB && dimA != 1 && dimB != 1) {
                 return std::nullopt; // 广播不兼容
@@ -75,8 +71,23 @@ namespace infini
             outputShape.push_back(std::max(dimA, dimB));
         }
 
-        outputShape.push_back(dimA_sec_Last);
-        outputShape.push_back(dimB_last);
+        if (inputs.size() == 3)
+        {
+            // a row vector of n, broadcast over the rows of every batch
+            const Shape &bias = inputs[2]->getDims();
+            if (bias.empty() || bias.size() > maxRank || bias.back() != nB ||
+                !(inputs[2]->getDType() == inputs[0]->getDType()))
+                return std::nullopt;
+            for (size_t i = 0; i + 1 < bias.size(); ++i)
+                if (bias[i] != 1)
+                    return std::nullopt;
+        }
+
+        m = mA;
+        n = nB;
+        k = kA;
+        outputShape.push_back(m);
+        outputShape.push_back(n);
 
         return {{outputShape}};
     }
@@ -9,6 +9,7 @@ namespace infini
         auto rank = input->getRank();
         if (permute.empty())
         {
+            transposePermute.resize(rank);
             for (size_t i = 0; i < rank; ++i)
             {
                 transposePermute[i] = i;
@@ -31,9 +32,10 @@ namespace infini
         if((int)transposePermute.size() != rank){
             return std::nullopt;
         }
+        // output dim i is input dim permute[i], as in numpy and onnx
         for(int i=0; i<rank; i++)
         {
-            output_dim[transposePermute[i]] = input_dim[i];
+            output_dim[i] = input_dim[transposePermute[i]];
         }
 
         return {{output_dim}};
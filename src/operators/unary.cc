@@ -67,9 +67,7 @@ namespace infini
         if (inputs.empty()) {
             return {};
         }
-        DataType Type = getOutputDataType();
-        int num = inputs[0]->size();
-        return {Type, num};
+        return {getOutputDataType()};
     }
     optional<vector<Shape>> CastObj::inferShape(const TensorVec &inputs)
     {
@@ -91,6 +89,16 @@ namespace infini
     }
 
     DataType CastObj::getOutputDataType() const
+    {
+        return getOutputDataType(castType);
+    }
+
+    DataType CastObj::getInputDataType() const
+    {
+        return getInputDataType(castType);
+    }
+
+    DataType CastObj::getOutputDataType(CastType castType)
     {
         switch (castType)
         {
@@ -148,4 +156,47 @@ namespace infini
             IT_TODO_HALT();
         }
     }
+
+    DataType CastObj::getInputDataType(CastType castType)
+    {
+        switch (castType)
+        {
+        case CastType::Float2Float16:
+        case CastType::Float2Int64:
+        case CastType::Float2Int32:
+        case CastType::Float2Int16:
+        case CastType::Float2Int8:
+        case CastType::Float2BFloat16:
+        case CastType::Float2Float:
+            return DataType::Float32;
+        case CastType::Int322Float:
+        case CastType::Int322Int8:
+        case CastType::Int322Int16:
+        case CastType::Int322Int64:
+            return DataType::Int32;
+        case CastType::Int162Float:
+        case CastType::Int162Int32:
+            return DataType::Int16;
+        case CastType::Int82Float:
+        case CastType::Int82Int16:
+        case CastType::Int82Int32:
+            return DataType::Int8;
+        case CastType::Uint82Float:
+        case CastType::Uint82Int32:
+        case CastType::Uint82Int64:
+            return DataType::UInt8;
+        case CastType::Int642Int32:
+        case CastType::Int642Uint32:
+        case CastType::Int642Float:
+            return DataType::Int64;
+        case CastType::Uint322Int64:
+            return DataType::UInt32;
+        case CastType::Float162Float:
+            return DataType::Float16;
+        case CastType::BFloat162Float:
+            return DataType::BFloat16;
+        default:
+            IT_TODO_HALT();
+        }
+    }
 }; // namespace infini
@@ -0,0 +1,143 @@
+#include "utils/broadcast.h"
+#include <cstring>
+
+namespace infini
+{
+    static vector<int64_t> denseStrides(const Shape &shape)
+    {
+        vector<int64_t> ret(shape.size());
+        int64_t acc = 1;
+        for (size_t i = shape.size(); i > 0; --i)
+        {
+            ret[i - 1] = acc;
+            acc *= shape[i - 1];
+        }
+        return ret;
+    }
+
+    BroadcastPlan::BroadcastPlan(const Shape &output, const vector<Shape> &inputs)
+    {
+        vector<vector<int64_t>> inputStrides;
+        for (auto &shape : inputs)
+            inputStrides.emplace_back(denseStrides(shape));
+        build(output, inputs, inputStrides);
+    }
+
+    BroadcastPlan::BroadcastPlan(const Shape &output, const vector<Shape> &inputs,
+                                 const vector<vector<int64_t>> &inputStrides)
+    {
+        build(output, inputs, inputStrides);
+    }
+
+    void BroadcastPlan::build(const Shape &output, const vector<Shape> &inputs,
+                              const vector<vector<int64_t>> &inputStrides)
+    {
+        IT_ASSERT(inputs.size() == inputStrides.size());
+        size_t rank = output.size(), nIn = inputs.size();
+
+        // right-align every operand and zero the stride of broadcast dims
+        vector<vector<int64_t>> aligned(nIn, vector<int64_t>(rank, 0));
+        for (size_t i = 0; i < nIn; ++i)
+        {
+            const auto &dims = inputs[i];
+            IT_ASSERT(dims.size() <= rank && inputStrides[i].size() == dims.size());
+            size_t pad = rank - dims.size();
+            for (size_t d = 0; d < dims.size(); ++d)
+            {
+                IT_ASSERT(dims[d] == output[d + pad] || dims[d] == 1);
+                aligned[i][d + pad] = dims[d] == 1 ? 0 : inputStrides[i][d];
+            }
+        }
+
+        shape.clear();
+        strides.assign(nIn, {});
+        for (size_t d = 0; d < rank; ++d)
+        {
+            if (output[d] == 1)
+                continue;
+            bool mergeable = !shape.empty();
+            for (size_t i = 0; mergeable && i < nIn; ++i)
+                mergeable = strides[i].back() == aligned[i][d] * output[d];
+            if (mergeable)
+            {
+                shape.back() *= output[d];
+                for (size_t i = 0; i < nIn; ++i)
+                    strides[i].back() = aligned[i][d];
+                continue;
+            }
+            shape.emplace_back(output[d]);
+            for (size_t i = 0; i < nIn; ++i)
+                strides[i].emplace_back(aligned[i][d]);
+        }
+        if (shape.empty())
+        {
+            // a single element
+            shape.emplace_back(1);
+            for (auto &s : strides)
+                s.emplace_back(0);
+        }
+
+        rows = 1;
+        for (size_t d = 0; d + 1 < shape.size(); ++d)
+            rows *= shape[d];
+        if (shape.back() == 0)
+            rows = 0;
+    }
+
+    void BroadcastPlan::rowOffsets(size_t row, int64_t *offsets) const
+    {
+        for (size_t i = 0; i < strides.size(); ++i)
+            offsets[i] = 0;
+        for (int d = (int)shape.size() - 2; d >= 0; --d)
+        {
+            int64_t idx = row % shape[d];
+            row /= shape[d];
+            for (size_t i = 0; i < strides.size(); ++i)
+                offsets[i] += idx * strides[i][d];
+        }
+    }
+
+    template <typename T>
+    static void copySegments(const BroadcastPlan &plan, T *dst, const T *src)
+    {
+        int64_t sd = plan.innerStride(0), ss = plan.innerStride(1);
+        plan.forEachSegment(
+            [&](int64_t, const int64_t *offsets, int64_t n)
+            {
+                T *to = dst + offsets[0];
+                const T *from = src + offsets[1];
+                if (sd == 1 && ss == 1)
+                    std::memcpy(to, from, n * sizeof(T));
+                else
+                    for (int64_t i = 0; i < n; ++i)
+                        to[i * sd] = from[i * ss];
+            });
+    }
+
+    void copyStrided(void *dst, const vector<int64_t> &dstStrides,
+                     const void *src, const vector<int64_t> &srcStrides,
+                     const Shape &shape, size_t elemSize)
+    {
+        // the destination is walked as the first operand of a plan over its
+        // own shape
+        BroadcastPlan plan(shape, {shape, shape}, {dstStrides, srcStrides});
+        switch (elemSize)
+        {
+        case 1:
+            return copySegments(plan, static_cast<uint8_t *>(dst),
+                                static_cast<const uint8_t *>(src));
+        case 2:
+            return copySegments(plan, static_cast<uint16_t *>(dst),
+                                static_cast<const uint16_t *>(src));
+        case 4:
+            return copySegments(plan, static_cast<uint32_t *>(dst),
+                                static_cast<const uint32_t *>(src));
+        case 8:
+            return copySegments(plan, static_cast<uint64_t *>(dst),
+                                static_cast<const uint64_t *>(src));
+        default:
+            IT_TODO_HALT();
+        }
+    }
+
+} // namespace infini
@@ -0,0 +1,98 @@
+#include "utils/cpu_isa.h"
+#include <cstdlib>
+#include <cstring>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+namespace infini
+{
+    static CpuFeatures detectCpuFeatures()
+    {
+        CpuFeatures f;
+#if defined(__x86_64__) || defined(__i386__)
+        unsigned eax, ebx, ecx, edx;
+        if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+            return f;
+        bool osxsave = ecx & bit_OSXSAVE;
+        bool avx = ecx & bit_AVX;
+        bool fma = ecx & bit_FMA;
+        bool f16c = ecx & bit_F16C;
+        if (!osxsave || !avx)
+            return f;
+
+        // the OS must save the YMM (and for AVX-512 the opmask/ZMM) state
+        unsigned xcr0Lo, xcr0Hi;
+        __asm__("xgetbv" : "=a"(xcr0Lo), "=d"(xcr0Hi) : "c"(0));
+        bool ymmState = (xcr0Lo & 0x6) == 0x6;
+        bool zmmState = (xcr0Lo & 0xe6) == 0xe6;
+        if (!ymmState)
+            return f;
+        f.fma = fma;
+        f.f16c = f16c;
+
+        if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+        {
+            f.avx2 = ebx & bit_AVX2;
+            if (zmmState)
+            {
+                f.avx512f = ebx & bit_AVX512F;
+                f.avx512bw = ebx & bit_AVX512BW;
+                f.avx512dq = ebx & bit_AVX512DQ;
+                f.avx512vl = ebx & bit_AVX512VL;
+            }
+        }
+#endif
+        return f;
+    }
+
+    const CpuFeatures &getCpuFeatures()
+    {
+        static const CpuFeatures features = detectCpuFeatures();
+        return features;
+    }
+
+    static CpuIsa detectCpuIsa()
+    {
+        const auto &f = getCpuFeatures();
+        CpuIsa isa = CpuIsa::Scalar;
+        if (f.avx2 && f.fma)
+            isa = CpuIsa::AVX2;
+        if (isa == CpuIsa::AVX2 && f.avx512f && f.avx512bw && f.avx512dq &&
+            f.avx512vl)
+            isa = CpuIsa::AVX512;
+
+        if (const char *cap = std::getenv("INFINI_CPU_ISA"))
+        {
+            CpuIsa limit = isa;
+            if (std::strcmp(cap, "scalar") == 0)
+                limit = CpuIsa::Scalar;
+            else if (std::strcmp(cap, "avx2") == 0)
+                limit = CpuIsa::AVX2;
+            isa = std::min(isa, limit);
+        }
+        return isa;
+    }
+
+    CpuIsa getCpuIsa()
+    {
+        static const CpuIsa isa = detectCpuIsa();
+        return isa;
+    }
+
+    const char *cpuIsaToString(CpuIsa isa)
+    {
+        switch (isa)
+        {
+        case CpuIsa::Scalar:
+            return "Scalar";
+        case CpuIsa::AVX2:
+            return "AVX2";
+        case CpuIsa::AVX512:
+            return "AVX512";
+        default:
+            IT_TODO_HALT();
+        }
+    }
+
+} // namespace infini
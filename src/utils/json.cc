@@ -0,0 +1,25 @@
+#include "utils/json.h"
+#include <cstdio>
+
+namespace infini
+{
+    string jsonEscape(const string &s)
+    {
+        string out;
+        for (char c : s)
+        {
+            if (c == '"' || c == '\\')
+                out += '\\';
+            if ((unsigned char)c < 0x20)
+            {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                out += buf;
+            }
+            else
+                out += c;
+        }
+        return out;
+    }
+
+} // namespace infini
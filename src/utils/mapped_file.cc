@@ -0,0 +1,35 @@
+#include "utils/mapped_file.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace infini
+{
+    MappedFile mapFile(const string &path)
+    {
+        int fd = open(path.c_str(), O_RDONLY);
+        IT_ASSERT(fd >= 0, "Cannot open " + path);
+        struct stat st;
+        bool statted = fstat(fd, &st) == 0;
+        if (!statted)
+            close(fd);
+        IT_ASSERT(statted, "Cannot stat " + path);
+        MappedFile file;
+        file.size = st.st_size;
+        if (file.size == 0)
+        {
+            close(fd);
+            return file;
+        }
+        void *addr = mmap(nullptr, file.size, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE, fd, 0);
+        close(fd);
+        IT_ASSERT(addr != MAP_FAILED, "Cannot map " + path);
+        file.data = static_cast<char *>(addr);
+        file.mapping = Ref<void>(addr, [size = file.size](void *p)
+                                 { munmap(p, size); });
+        return file;
+    }
+
+} // namespace infini
@@ -0,0 +1,164 @@
+#include "utils/profiler.h"
+#include "core/kernel.h"
+#include "operators/element_wise.h"
+#include "operators/matmul.h"
+#include "utils/json.h"
+#include <fstream>
+#include <iomanip>
+#include <map>
+
+namespace infini
+{
+    Profiler::Profiler(Device device)
+        : device(device),
+          epoch(std::chrono::steady_clock::now().time_since_epoch().count())
+    {
+    }
+
+    int64_t Profiler::now() const
+    {
+        using clock = std::chrono::steady_clock;
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   clock::now().time_since_epoch() - clock::duration(epoch))
+            .count();
+    }
+
+    void Profiler::record(const OperatorObj &op, int64_t begin, int64_t end,
+                          int thread)
+    {
+        OpProfile profile{op.getOpType(), op.getGuid(), "", begin, end, thread,
+                          0, 0, countFlops(op)};
+        auto attrs = KernelAttrs{device, op.getOpType().underlying()};
+        profile.kernel = std::get<1>(
+            KernelRegistry::getInstance().getKernelItem(attrs));
+        for (auto &input : op.getInputs())
+            profile.inputBytes += input->getBytes();
+        for (auto &output : op.getOutputs())
+            profile.outputBytes += output->getBytes();
+        std::lock_guard<std::mutex> lock(mutex);
+        records.emplace_back(std::move(profile));
+    }
+
+    vector<OpProfile> Profiler::getRecords() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return records;
+    }
+
+    void Profiler::clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        records.clear();
+        epoch = std::chrono::steady_clock::now().time_since_epoch().count();
+    }
+
+    double Profiler::countFlops(const OperatorObj &op)
+    {
+        double size = op.getOutputs().empty() ? 0 : op.getOutput()->size();
+        switch (op.getOpType().underlying())
+        {
+        case OpType::MatMul:
+        {
+            auto &matmul = dynamic_cast<const MatmulObj &>(op);
+            // a multiply and an add per k, then the epilogue per element
+            double flops = 2.0 * matmul.getK() * size;
+            if (matmul.getBias())
+                flops += size;
+            if (matmul.getActivation() != MatmulActivation::None)
+                flops += size;
+            return flops;
+        }
+        case OpType::FusedElementWise:
+            return size * dynamic_cast<const FusedElementWiseObj &>(op)
+                              .getSteps()
+                              .size();
+        case OpType::Add:
+        case OpType::Sub:
+        case OpType::Mul:
+        case OpType::Div:
+        case OpType::Relu:
+        case OpType::Clip:
+            return size;
+        default:
+            // data movement and conversions
+            return 0;
+        }
+    }
+
+    bool Profiler::writeChromeTrace(const string &path) const
+    {
+        std::ofstream file(path);
+        if (!file)
+            return false;
+        auto snapshot = getRecords();
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        file << std::fixed << std::setprecision(3);
+        for (size_t i = 0; i < snapshot.size(); ++i)
+        {
+            const auto &r = snapshot[i];
+            file << (i ? ",\n" : "\n");
+            file << "{\"name\":\"" << r.type.toString() << "\","
+                 << "\"cat\":\"" << jsonEscape(r.kernel) << "\","
+                 << "\"ph\":\"X\",\"pid\":0,\"tid\":" << r.thread << ","
+                 << "\"ts\":" << r.begin / 1e3 << ","
+                 << "\"dur\":" << (r.end - r.begin) / 1e3 << ","
+                 << "\"args\":{\"guid\":" << r.guid << ","
+                 << "\"kernel\":\"" << jsonEscape(r.kernel) << "\","
+                 << "\"inputBytes\":" << r.inputBytes << ","
+                 << "\"outputBytes\":" << r.outputBytes << ","
+                 << "\"flops\":" << r.flops << "}}";
+        }
+        file << "\n]}\n";
+        return bool(file);
+    }
+
+    string Profiler::summary() const
+    {
+        struct Row
+        {
+            size_t calls = 0;
+            int64_t time = 0;
+            double bytes = 0, flops = 0;
+        };
+        std::map<string, Row> rows;
+        int64_t total = 0;
+        for (const auto &r : getRecords())
+        {
+            auto &row = rows[r.type.toString()];
+            ++row.calls;
+            row.time += r.end - r.begin;
+            row.bytes += r.inputBytes + r.outputBytes;
+            row.flops += r.flops;
+            total += r.end - r.begin;
+        }
+        vector<std::pair<string, Row>> sorted(rows.begin(), rows.end());
+        std::stable_sort(sorted.begin(), sorted.end(),
+                         [](const auto &a, const auto &b)
+                         { return a.second.time > b.second.time; });
+
+        std::ostringstream os;
+        os << std::left << std::setw(18) << "OpType" << std::right
+           << std::setw(8) << "calls" << std::setw(12) << "total(ms)"
+           << std::setw(8) << "%" << std::setw(12) << "mean(us)"
+           << std::setw(10) << "GFLOP/s" << std::setw(10) << "GB/s" << "\n";
+        os << std::fixed;
+        for (const auto &[name, row] : sorted)
+        {
+            double seconds = row.time / 1e9;
+            os << std::left << std::setw(18) << name << std::right
+               << std::setw(8) << row.calls << std::setprecision(3)
+               << std::setw(12) << row.time / 1e6 << std::setprecision(1)
+               << std::setw(8) << (total ? 100.0 * row.time / total : 0.0)
+               << std::setw(12) << row.time / 1e3 / row.calls
+               << std::setprecision(2) << std::setw(10)
+               << (seconds > 0 ? row.flops / seconds / 1e9 : 0.0)
+               << std::setw(10)
+               << (seconds > 0 ? row.bytes / seconds / 1e9 : 0.0) << "\n";
+        }
+        os << std::left << std::setw(18) << "total" << std::right
+           << std::setw(8) << "" << std::setprecision(3) << std::setw(12)
+           << total / 1e6 << "\n";
+        return os.str();
+    }
+
+} // namespace infini
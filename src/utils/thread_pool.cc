@@ -0,0 +1,106 @@
+#include "utils/thread_pool.h"
+
+namespace infini
+{
+    namespace
+    {
+        // the pool and index of the worker running on this thread
+        thread_local const ThreadPool *currentPool = nullptr;
+        thread_local int currentIndex = -1;
+    } // namespace
+
+    ThreadPool::ThreadPool(int threads)
+    {
+        IT_ASSERT(threads > 0);
+        for (int i = 0; i < threads; ++i)
+            queues.emplace_back(std::make_unique<Queue>());
+        for (int i = 0; i < threads; ++i)
+            workers.emplace_back([this, i] { workerLoop(i); });
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wakeUp.notify_all();
+        for (auto &worker : workers)
+            worker.join();
+    }
+
+    int ThreadPool::workerIndex() const
+    {
+        return currentPool == this ? currentIndex : -1;
+    }
+
+    void ThreadPool::submit(Task task)
+    {
+        int index = workerIndex();
+        if (index < 0)
+            index = nextQueue.fetch_add(1, std::memory_order_relaxed) %
+                    queues.size();
+        {
+            std::lock_guard<std::mutex> lock(queues[index]->mutex);
+            queues[index]->tasks.emplace_back(std::move(task));
+        }
+        {
+            // counted under the sleep lock so a worker about to sleep either
+            // sees the task or gets the notification
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            ++queued;
+        }
+        wakeUp.notify_one();
+    }
+
+    bool ThreadPool::pop(int index, Task &task)
+    {
+        auto &queue = *queues[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty())
+            return false;
+        task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+        return true;
+    }
+
+    bool ThreadPool::steal(int index, Task &task)
+    {
+        int n = queues.size();
+        for (int k = 1; k < n; ++k)
+        {
+            auto &queue = *queues[(index + k) % n];
+            std::unique_lock<std::mutex> lock(queue.mutex, std::try_to_lock);
+            if (!lock.owns_lock() || queue.tasks.empty())
+                continue;
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            return true;
+        }
+        return false;
+    }
+
+    void ThreadPool::workerLoop(int index)
+    {
+        currentPool = this;
+        currentIndex = index;
+        Task task;
+        while (true)
+        {
+            if (pop(index, task) || steal(index, task))
+            {
+                --queued;
+                task();
+                task = nullptr;
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            // a try_lock in steal() may have skipped a busy queue, so only
+            // sleep when nothing is queued anywhere
+            wakeUp.wait(lock, [this] { return stopping || queued > 0; });
+            if (stopping && queued == 0)
+                return;
+        }
+    }
+
+} // namespace infini
@@ -71,4 +71,19 @@ namespace infini
         EXPECT_EQ(ptr1, ptr2);
     }
 
+    TEST(Allocator, testAllocDoesNotOverlapLiveBlocks)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Allocator allocator = Allocator(runtime);
+        size_t offsetA = allocator.alloc(64);
+        size_t offsetB = allocator.alloc(64);
+        // free a, then allocate something that does not fit into its hole
+        allocator.free(offsetA, 64);
+        size_t offsetC = allocator.alloc(128);
+        EXPECT_TRUE(offsetC >= offsetB + 64 || offsetC + 128 <= offsetB);
+        // the hole left by a is still usable
+        EXPECT_EQ(allocator.alloc(64), offsetA);
+        EXPECT_EQ(allocator.getPeak(), 256u);
+    }
+
 } // namespace infini
@@ -0,0 +1,216 @@
+#include "core/graph.h"
+#include "core/kernel.h"
+#include "core/plan.h"
+#include "core/runtime.h"
+#include "operators/concat.h"
+#include "operators/element_wise.h"
+#include "operators/matmul.h"
+#include "operators/transpose.h"
+#include "operators/unary.h"
+#include "utils/thread_pool.h"
+
+#include "test.h"
+
+namespace infini
+{
+    TEST(ThreadPool, RunsNestedTasks)
+    {
+        std::atomic<int> count{0};
+        {
+            ThreadPool pool(3);
+            for (int i = 0; i < 100; ++i)
+                pool.submit([&]
+                            {
+                                EXPECT_GE(pool.workerIndex(), 0);
+                                for (int j = 0; j < 10; ++j)
+                                    pool.submit([&] { ++count; });
+                                ++count; });
+            EXPECT_EQ(pool.workerIndex(), -1);
+            // the destructor drains the queues
+        }
+        EXPECT_EQ(count, 1100);
+    }
+
+    TEST(Executor, MemoryDependencies)
+    {
+        auto runtime = make_ref<NativeCpuRuntimeObj>();
+        runtime->setInterOpThreads(1); // planned in topological order
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor i = g->addTensor({8, 8}, DataType::Float32);
+        auto a = g->addOp<ReluObj>(i, nullptr);
+        auto b = g->addOp<TransposeObj>(a->getOutput(), nullptr, Shape{1, 0});
+        auto c = g->addOp<ReluObj>(i, nullptr);
+        g->dataMalloc();
+
+        // c only reads `i`, but its output reuses the block of a's output,
+        // which b is still reading
+        EXPECT_EQ(c->getOutput()->getRawDataPtr<void *>(),
+                  a->getOutput()->getRawDataPtr<void *>());
+        EXPECT_EQ(g->getMemoryDependencies(c.get()),
+                  vector<OperatorObj *>{b.get()});
+        EXPECT_TRUE(g->getMemoryDependencies(b.get()).empty());
+    }
+
+    TEST(Executor, InPlaceWaitsForReaders)
+    {
+        for (int threads : {1, 4})
+        {
+            auto runtime = make_ref<NativeCpuRuntimeObj>();
+            runtime->setInterOpThreads(threads);
+            Graph g = make_ref<GraphObj>(runtime);
+            Tensor i = g->addTensor({64}, DataType::Float32);
+            auto x = g->addOp<ReluObj>(i, nullptr)->getOutput();
+            auto a = g->addOp<ClipObj>(x, nullptr, 1.0f, 5.0f);
+            auto b = g->addOp<ReluObj>(x, nullptr);
+            g->dataMalloc();
+
+            auto *block = x->getRawDataPtr<void *>();
+            if (threads == 1)
+            {
+                // b is the last reader of x and overwrites it after a
+                EXPECT_EQ(b->getOutput()->getRawDataPtr<void *>(), block);
+                EXPECT_EQ(g->getMemoryDependencies(b.get()),
+                          vector<OperatorObj *>{a.get()});
+            }
+            else
+            {
+                // a and b are siblings of one level and run concurrently
+                EXPECT_NE(a->getOutput()->getRawDataPtr<void *>(), block);
+                EXPECT_NE(b->getOutput()->getRawDataPtr<void *>(), block);
+                EXPECT_TRUE(g->getMemoryDependencies(b.get()).empty());
+            }
+        }
+    }
+
+    // Inception-style: several independent branches of different depth
+    // joined by a Concat, so that both data and memory edges matter.
+    static Graph buildWideGraph(Runtime runtime, Tensor &input,
+                                Tensor &output)
+    {
+        Graph g = make_ref<GraphObj>(runtime);
+        input = g->addTensor({4, 32, 32}, DataType::Float32);
+        auto weight = g->addTensor({32, 32}, DataType::Float32);
+        TensorVec branches;
+        for (int b = 0; b < 6; ++b)
+        {
+            Tensor t = input;
+            for (int d = 0; d <= b; ++d)
+            {
+                if (d % 3 == 0)
+                    t = g->addOp<MatmulObj>(t, weight, nullptr)->getOutput();
+                else if (d % 3 == 1)
+                    t = g->addOp<TransposeObj>(t, nullptr, Shape{0, 2, 1})
+                            ->getOutput();
+                else
+                    t = g->addOp<ClipObj>(t, nullptr, -20.0f, 20.0f)
+                            ->getOutput();
+            }
+            t = g->addOp<AddObj>(t, input, nullptr)->getOutput();
+            branches.emplace_back(g->addOp<ReluObj>(t, nullptr)->getOutput());
+        }
+        output = g->addOp<ConcatObj>(branches, nullptr, 1)->getOutput();
+        g->dataMalloc();
+        input->setData([](void *data, size_t size, DataType)
+                       {
+                           auto ptr = reinterpret_cast<float *>(data);
+                           for (size_t k = 0; k < size; ++k)
+                               ptr[k] = float(int(k * 7 % 13) - 6) / 8; });
+        weight->setData([](void *data, size_t size, DataType)
+                        {
+                            auto ptr = reinterpret_cast<float *>(data);
+                            for (size_t k = 0; k < size; ++k)
+                                ptr[k] = float(int(k * 5 % 11) - 5) / 16; });
+        return g;
+    }
+
+    TEST(Executor, ParallelMatchesSequential)
+    {
+        auto sequential = make_ref<NativeCpuRuntimeObj>();
+        sequential->setInterOpThreads(1);
+        Tensor input, expected;
+        Graph ref = buildWideGraph(sequential, input, expected);
+        sequential->run(ref);
+
+        auto parallel = make_ref<NativeCpuRuntimeObj>();
+        parallel->setInterOpThreads(4);
+        Tensor output;
+        Graph g = buildWideGraph(parallel, input, output);
+        // planned level by level: memory only orders an operator after
+        // operators of earlier levels, never after a sibling
+        std::unordered_map<OperatorObj *, int> level;
+        for (auto &op : g->getOperators())
+        {
+            for (auto &pred : op->getPredecessors())
+                level[op.get()] =
+                    std::max(level[op.get()], level[pred.get()] + 1);
+            for (auto *dep : g->getMemoryDependencies(op.get()))
+                EXPECT_LT(level.at(dep), level[op.get()]);
+        }
+        for (int r = 0; r < 20; ++r)
+        {
+            parallel->run(g);
+            ASSERT_TRUE(output->equalData(expected));
+        }
+    }
+
+    TEST(Executor, CompiledPlan)
+    {
+        auto sequential = make_ref<NativeCpuRuntimeObj>();
+        sequential->setInterOpThreads(1);
+        Tensor input, expected;
+        Graph ref = buildWideGraph(sequential, input, expected);
+        sequential->run(ref);
+
+        for (int threads : {1, 4})
+        {
+            auto runtime = make_ref<NativeCpuRuntimeObj>();
+            runtime->setInterOpThreads(threads);
+            Tensor in, output;
+            Graph g = buildWideGraph(runtime, in, output);
+            auto plan = g->compile();
+            ASSERT_EQ(plan->size(), g->getOperators().size());
+            const auto &tape = plan->getInstructions();
+            for (size_t i = 0; i < tape.size(); ++i)
+            {
+                EXPECT_EQ(tape[i].op, g->getOperators()[i].get());
+                for (auto j : tape[i].successors)
+                    EXPECT_GT(j, i);
+            }
+            EXPECT_EQ(tape.front().numPredecessors, 0);
+            for (int r = 0; r < 5; ++r)
+            {
+                runtime->run(plan);
+                ASSERT_TRUE(output->equalData(expected));
+            }
+            // launches read the data in place, so new inputs are picked up
+            in->setData([](void *data, size_t size, DataType)
+                        { std::fill_n(reinterpret_cast<float *>(data), size,
+                                      0.f); });
+            runtime->run(plan);
+            EXPECT_TRUE(output->equalData(vector<float>(output->size(), 0)));
+            EXPECT_THROW(sequential->run(plan), Exception);
+
+            // run(graph) compiles once, until the memory plan changes
+            auto cached = g->getPlan();
+            runtime->run(g);
+            EXPECT_EQ(g->getPlan(), cached);
+            g->dataMalloc();
+            EXPECT_NE(g->getPlan(), cached);
+        }
+    }
+
+    TEST(Executor, ParallelRethrows)
+    {
+        auto runtime = make_ref<NativeCpuRuntimeObj>();
+        runtime->setInterOpThreads(2);
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor i = g->addTensor({8}, DataType::Float32);
+        g->addOp<ReluObj>(i, nullptr);
+        // no Relu kernel for Int32
+        Tensor j = g->addTensor({8}, DataType::Int32);
+        g->addOp<ReluObj>(j, nullptr);
+        g->dataMalloc();
+        EXPECT_THROW(runtime->run(g), Exception);
+    }
+
+} // namespace infini
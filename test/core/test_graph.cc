@@ -1,8 +1,12 @@
 #include "core/graph.h"
 #include "core/kernel.h"
+#include "core/rewrite.h"
 #include "core/runtime.h"
+#include "operators/concat.h"
+#include "operators/element_wise.h"
 #include "operators/matmul.h"
 #include "operators/transpose.h"
+#include "operators/unary.h"
 
 #include "test.h"
 
@@ -37,4 +41,563 @@ namespace infini
         EXPECT_EQ(op->getTransA(), false);
         EXPECT_EQ(op->getTransB(), true);
     }
-}
\ No newline at end of file
+
+    // Add -> Relu -> Clip -> Sub -> Mul with broadcast operands, next to a
+    // Relu whose output is read twice.
+    static TensorVec buildElementWiseChain(const Graph &g, DataType dtype,
+                                           Tensor &out, Tensor &side)
+    {
+        auto x = g->addTensor({4, 8, 200}, dtype);
+        auto bias = g->addTensor({200}, dtype);
+        auto y = g->addTensor({8, 1}, dtype);
+        auto scale = g->addTensor({4, 1, 1}, dtype);
+        auto t = g->addOp<AddObj>(x, bias, nullptr)->getOutput();
+        t = g->addOp<ReluObj>(t, nullptr)->getOutput();
+        t = g->addOp<ClipObj>(t, nullptr, 1.0f, 3000.0f)->getOutput();
+        t = g->addOp<SubObj>(y, t, nullptr)->getOutput();
+        out = g->addOp<MulObj>(t, scale, nullptr)->getOutput();
+        auto r = g->addOp<ReluObj>(x, nullptr)->getOutput();
+        side = g->addOp<MulObj>(r, r, nullptr)->getOutput();
+        return {out, side};
+    }
+
+    TEST(Graph, FuseElementWiseChains)
+    {
+        for (auto dtype : {DataType::Float32, DataType::UInt32})
+        {
+            Tensor out, side;
+            Graph g = expectOptimizeKeepsResults(
+                [&](const Graph &graph)
+                { return buildElementWiseChain(graph, dtype, out, side); });
+
+            ASSERT_EQ(g->getOperators().size(), 3u);
+            auto fused = as<FusedElementWiseObj>(out->getSource());
+            ASSERT_TRUE(fused);
+            EXPECT_EQ(fused->getOutput(), out);
+            EXPECT_EQ(fused->getInputs().size(), 4u);
+            ASSERT_EQ(fused->getSteps().size(), 5u);
+            EXPECT_TRUE(fused->getSteps()[3].reversed);
+            // the four intermediates are gone: 4 inputs, out, r and side
+            EXPECT_EQ(g->getTensors().size(), 7u);
+        }
+    }
+
+    // Two MLP layers: MatMul -> Add(bias) -> Relu, then MatMul -> Add(bias)
+    // -> Clip, whose result also feeds a Relu that stays separate.
+    static TensorVec buildMlp(const Graph &g, DataType dtype, Tensor &out)
+    {
+        auto x = g->addTensor({3, 20, 64}, dtype);
+        auto w1 = g->addTensor({64, 40}, dtype);
+        auto b1 = g->addTensor({40}, dtype);
+        auto w2 = g->addTensor({40, 24}, dtype);
+        auto b2 = g->addTensor({1, 24}, dtype);
+        auto t = g->addOp<MatmulObj>(x, w1, nullptr)->getOutput();
+        t = g->addOp<AddObj>(b1, t, nullptr)->getOutput();
+        t = g->addOp<ReluObj>(t, nullptr)->getOutput();
+        t = g->addOp<MatmulObj>(t, w2, nullptr)->getOutput();
+        t = g->addOp<AddObj>(t, b2, nullptr)->getOutput();
+        t = g->addOp<ClipObj>(t, nullptr, 2.0f, 90.0f)->getOutput();
+        out = g->addOp<ReluObj>(t, nullptr)->getOutput();
+        return {out};
+    }
+
+    TEST(Graph, FuseMatmulEpilogue)
+    {
+        for (auto dtype : {DataType::Float32, DataType::UInt32})
+        {
+            Tensor out;
+            Graph g = expectOptimizeKeepsResults(
+                [&](const Graph &graph) { return buildMlp(graph, dtype, out); },
+                [](void *data, size_t size, DataType dtype)
+                {
+                    for (size_t i = 0; i < size; ++i)
+                    {
+                        int v = int(i * 7 % 11) - 3;
+                        if (dtype == DataType::Float32)
+                            reinterpret_cast<float *>(data)[i] = v;
+                        else
+                            reinterpret_cast<uint32_t *>(data)[i] =
+                                v < 0 ? 0 : v;
+                    }
+                });
+
+            // the last Relu reads a fused MatMul, it is not an epilogue
+            ASSERT_EQ(g->getOperators().size(), 3u);
+            auto last = as<MatmulObj>(out->getSource()->getInputs(0)->getSource());
+            ASSERT_TRUE(last);
+            EXPECT_EQ(last->getActivation(), MatmulActivation::Clip);
+            EXPECT_EQ(last->getClipMin(), 2.0f);
+            ASSERT_TRUE(last->getBias());
+            auto first = as<MatmulObj>(last->getInputs(0)->getSource());
+            ASSERT_TRUE(first);
+            EXPECT_EQ(first->getActivation(), MatmulActivation::Relu);
+            EXPECT_EQ(first->getBias()->getDims(), Shape{40});
+            // x, 2 weights, 2 biases, 2 MatMul outputs and out
+            EXPECT_EQ(g->getTensors().size(), 8u);
+        }
+    }
+
+    TEST(Graph, DataMallocReusesDeadTensors)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor i = g->addTensor({2, 3, 4}, DataType::Float32);
+        // casts neither run in place nor read views, so each output needs a
+        // free block
+        auto cast = [&](Tensor t)
+        {
+            return g->addOp<CastObj>(t, nullptr, CastType::Float2Float)
+                ->getOutput();
+        };
+        auto t1 = cast(i), t2 = cast(t1), t3 = cast(t2), o = cast(t3);
+        g->dataMalloc();
+
+        // t1 is dead once t2 exists, so t3 lands in its slot; likewise o in t2
+        EXPECT_EQ(t3->getRawDataPtr<void *>(), t1->getRawDataPtr<void *>());
+        EXPECT_EQ(o->getRawDataPtr<void *>(), t2->getRawDataPtr<void *>());
+        EXPECT_NE(i->getRawDataPtr<void *>(), t1->getRawDataPtr<void *>());
+        EXPECT_NE(t1->getRawDataPtr<void *>(), t2->getRawDataPtr<void *>());
+
+        i->setData(IncrementalGenerator());
+        runtime->run(g);
+        vector<float> ans;
+        for (int v = 0; v < 24; ++v)
+            ans.emplace_back(v);
+        EXPECT_TRUE(o->equalData(ans));
+    }
+
+    TEST(Graph, DataMallocInPlace)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor i = g->addTensor({2, 3, 4}, DataType::Float32);
+        Tensor row = g->addTensor({4}, DataType::Float32);
+        auto t1 = g->addOp<ReluObj>(i, nullptr)->getOutput();
+        auto t2 = g->addOp<ClipObj>(t1, nullptr, 1.0f, 20.0f)->getOutput();
+        auto t3 = g->addOp<AddObj>(row, t2, nullptr)->getOutput();
+        auto t4 = g->addOp<MulObj>(t3, t3, nullptr)->getOutput();
+        auto t5 = g->addOp<ReluObj>(t4, nullptr)->getOutput();
+        // t5 is read again by the last Sub, so Div cannot overwrite it
+        auto t6 = g->addOp<DivObj>(row, t5, nullptr)->getOutput();
+        auto t7 = g->addOp<AddObj>(t6, row, nullptr)->getOutput();
+        auto o = g->addOp<SubObj>(t7, t5, nullptr)->getOutput();
+        g->dataMalloc();
+
+        // graph inputs are never overwritten, dead same-shape inputs are,
+        // also next to a broadcast operand
+        auto *base = t1->getRawDataPtr<void *>();
+        EXPECT_NE(i->getRawDataPtr<void *>(), base);
+        for (auto &t : {t2, t3, t4, t5})
+            EXPECT_EQ(t->getRawDataPtr<void *>(), base);
+        EXPECT_NE(t6->getRawDataPtr<void *>(), base);
+        EXPECT_EQ(t7->getRawDataPtr<void *>(), t6->getRawDataPtr<void *>());
+        EXPECT_EQ(o->getRawDataPtr<void *>(), t7->getRawDataPtr<void *>());
+
+        i->setData(IncrementalGenerator());
+        row->setData(IncrementalGenerator());
+        runtime->run(g);
+        vector<float> ans;
+        for (int v = 0; v < 24; ++v)
+        {
+            float r = v % 4, t = r + std::min(std::max(float(v), 1.f), 20.f);
+            ans.emplace_back(r / (t * t) + r - t * t);
+        }
+        EXPECT_TRUE(o->equalData(ans));
+    }
+
+    TEST(Graph, TransposeViews)
+    {
+        auto runtime = make_ref<NativeCpuRuntimeObj>();
+        runtime->setInterOpThreads(1);
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor x = g->addTensor({4, 6}, DataType::Float32);
+        Tensor w = g->addTensor({4, 5}, DataType::Float32);
+        Tensor y = g->addTensor({6, 4}, DataType::Float32);
+        Tensor z = g->addTensor({2, 3, 4}, DataType::Float32);
+        Tensor u = g->addTensor({3, 2, 4}, DataType::Float32);
+        auto xt = g->addOp<TransposeObj>(x, nullptr, Shape{1, 0})->getOutput();
+        auto mm = g->addOp<MatmulObj>(xt, w, nullptr)->getOutput();
+        // transposed back: a view again, dense this time
+        auto xtt = g->addOp<TransposeObj>(xt, nullptr, Shape{1, 0})
+                       ->getOutput();
+        auto sq = g->addOp<MulObj>(xtt, x, nullptr)->getOutput();
+        // Relu needs dense data, so this transpose copies from the view
+        auto t1 = g->addOp<TransposeObj>(xt, nullptr, Shape{1, 0})->getOutput();
+        auto r1 = g->addOp<ReluObj>(t1, nullptr)->getOutput();
+        // Add would read x column by column, so this one copies too
+        auto t2 = g->addOp<TransposeObj>(x, nullptr, Shape{1, 0})->getOutput();
+        auto sum = g->addOp<AddObj>(t2, y, nullptr)->getOutput();
+        // rows stay contiguous: a view for Add and Concat
+        auto zt = g->addOp<TransposeObj>(z, nullptr, Shape{1, 0, 2})
+                      ->getOutput();
+        auto zsum = g->addOp<AddObj>(zt, u, nullptr)->getOutput();
+        auto cat = g->addOp<ConcatObj>(TensorVec{u, zt}, nullptr, 2)
+                       ->getOutput();
+        g->dataMalloc();
+
+        auto *px = x->getRawDataPtr<float *>();
+        EXPECT_EQ(xt->getRawDataPtr<float *>(), px);
+        EXPECT_FALSE(xt->isContiguous());
+        EXPECT_EQ(xt->getStrides(), (vector<int64_t>{1, 6}));
+        EXPECT_EQ(xtt->getRawDataPtr<float *>(), px);
+        EXPECT_TRUE(xtt->isContiguous());
+        for (auto &t : {t1, t2})
+        {
+            EXPECT_TRUE(t->isContiguous());
+            EXPECT_NE(t->getRawDataPtr<float *>(), px);
+        }
+        EXPECT_EQ(zt->getRawDataPtr<float *>(), z->getRawDataPtr<float *>());
+        EXPECT_EQ(zt->getStrides(), (vector<int64_t>{4, 12, 1}));
+
+        x->setData(IncrementalGenerator());
+        w->setData(IncrementalGenerator());
+        y->setData(IncrementalGenerator());
+        z->setData(IncrementalGenerator());
+        u->setData(IncrementalGenerator());
+        for (auto plan : {false, true})
+        {
+            if (plan)
+                runtime->run(g->compile());
+            else
+                runtime->run(g);
+            // x[i][j] = 6i + j, w[i][j] = 5i + j, y[i][j] = 4i + j,
+            // z[i][j][k] = 12i + 4j + k, u[i][j][k] = 8i + 4j + k
+            vector<float> ansMm, ansSum, ansSq, ansZsum, ansCat;
+            for (int i = 0; i < 6; ++i)
+                for (int j = 0; j < 5; ++j)
+                {
+                    float acc = 0;
+                    for (int k = 0; k < 4; ++k)
+                        acc += float(6 * k + i) * float(5 * k + j);
+                    ansMm.emplace_back(acc);
+                }
+            for (int i = 0; i < 6; ++i)
+                for (int j = 0; j < 4; ++j)
+                    ansSum.emplace_back(6 * j + i + 4 * i + j);
+            for (int v = 0; v < 24; ++v)
+                ansSq.emplace_back(float(v) * v);
+            for (int i = 0; i < 3; ++i)
+                for (int j = 0; j < 2; ++j)
+                {
+                    for (int k = 0; k < 4; ++k)
+                        ansZsum.emplace_back(12 * j + 4 * i + k +
+                                             8 * i + 4 * j + k);
+                    for (int k = 0; k < 8; ++k)
+                        ansCat.emplace_back(k < 4 ? 8 * i + 4 * j + k
+                                                  : 12 * j + 4 * i + k - 4);
+                }
+            EXPECT_TRUE(mm->equalData(ansMm));
+            EXPECT_TRUE(sum->equalData(ansSum));
+            EXPECT_TRUE(sq->equalData(ansSq));
+            vector<float> ansX(24);
+            std::iota(ansX.begin(), ansX.end(), 0.f);
+            EXPECT_TRUE(r1->equalData(ansX));
+            EXPECT_TRUE(zsum->equalData(ansZsum));
+            EXPECT_TRUE(cat->equalData(ansCat));
+        }
+    }
+
+    TEST(Graph, ConcatSlices)
+    {
+        for (int threads : {1, 4})
+        {
+            auto runtime = make_ref<NativeCpuRuntimeObj>();
+            runtime->setInterOpThreads(threads);
+            Graph g = make_ref<GraphObj>(runtime);
+            Tensor a = g->addTensor({1, 2, 3}, DataType::Float32);
+            Tensor b = g->addTensor({1, 4, 3}, DataType::Float32);
+            Tensor c = g->addTensor({2, 2, 3}, DataType::Float32);
+            auto ra = g->addOp<ReluObj>(a, nullptr)->getOutput();
+            auto sb = g->addOp<AddObj>(b, b, nullptr)->getOutput();
+            // a graph input is copied, a computed input is written in place
+            auto inner = g->addOp<ConcatObj>(TensorVec{ra, a}, nullptr, 1)
+                             ->getOutput();
+            auto out = g->addOp<ConcatObj>(TensorVec{sb, inner}, nullptr, 1)
+                           ->getOutput();
+            // the dims before the axis are not all 1: copied
+            auto rc = g->addOp<ReluObj>(c, nullptr)->getOutput();
+            auto wide = g->addOp<ConcatObj>(TensorVec{rc, c}, nullptr, 2)
+                            ->getOutput();
+            g->dataMalloc();
+
+            auto *po = out->getRawDataPtr<float *>();
+            EXPECT_EQ(sb->getRawDataPtr<float *>(), po);
+            EXPECT_EQ(inner->getRawDataPtr<float *>(), po + 12);
+            EXPECT_EQ(ra->getRawDataPtr<float *>(), po + 12);
+            EXPECT_NE(rc->getRawDataPtr<float *>(),
+                      wide->getRawDataPtr<float *>());
+
+            a->setData(IncrementalGenerator());
+            b->setData(IncrementalGenerator());
+            c->setData(IncrementalGenerator());
+            for (auto plan : {false, true})
+            {
+                if (plan)
+                    runtime->run(g->compile());
+                else
+                    runtime->run(g);
+                vector<float> ansOut, ansWide;
+                for (int v = 0; v < 12; ++v)
+                    ansOut.emplace_back(2 * v);
+                for (int k = 0; k < 2; ++k)
+                    for (int v = 0; v < 6; ++v)
+                        ansOut.emplace_back(v);
+                for (int i = 0; i < 2; ++i)
+                    for (int j = 0; j < 2; ++j)
+                        for (int k = 0; k < 6; ++k)
+                            ansWide.emplace_back(6 * i + 3 * j + k % 3);
+                EXPECT_TRUE(out->equalData(ansOut));
+                EXPECT_TRUE(wide->equalData(ansWide));
+            }
+        }
+    }
+
+    TEST(Graph, UpdateInputShapes)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor x = g->addTensor({2, 8}, DataType::Float32);
+        Tensor w = g->addTensor({8, 4}, DataType::Float32);
+        Tensor z = g->addTensor({3}, DataType::Float32);
+        auto mm = g->addOp<MatmulObj>(x, w, nullptr)->getOutput();
+        // t is planned as a view, as its reader is a Transpose
+        auto t = g->addOp<TransposeObj>(mm, nullptr, Shape{1, 0})->getOutput();
+        auto tt = g->addOp<TransposeObj>(t, nullptr, Shape{1, 0})->getOutput();
+        auto y = g->addOp<ReluObj>(tt, nullptr)->getOutput();
+        auto zr = g->addOp<ReluObj>(z, nullptr)->getOutput();
+        g->dataMalloc();
+        ASSERT_FALSE(t->isContiguous());
+
+        EXPECT_EQ(g->getTensor(x->getFuid()), x);
+        EXPECT_THROW(g->updateInputShapes({{mm->getFuid(), {5, 4}}}),
+                     Exception);
+        auto changed = g->updateInputShapes({{x->getFuid(), {5, 8}}});
+        EXPECT_EQ(std::set<Tensor>(changed.begin(), changed.end()),
+                  (std::set<Tensor>{x, mm, t, tt, y}));
+        EXPECT_EQ(y->getDims(), (Shape{5, 4}));
+        EXPECT_EQ(zr->getDims(), (Shape{3}));
+        EXPECT_TRUE(g->updateInputShapes({{x->getFuid(), {5, 8}}}).empty());
+
+        g->dataMalloc();
+        x->setData(IncrementalGenerator());
+        w->setData(IncrementalGenerator());
+        z->setData(IncrementalGenerator());
+        runtime->run(g);
+        vector<float> ans;
+        for (int i = 0; i < 5; ++i)
+            for (int j = 0; j < 4; ++j)
+            {
+                float acc = 0;
+                for (int k = 0; k < 8; ++k)
+                    acc += float(8 * i + k) * float(4 * k + j);
+                ans.emplace_back(acc);
+            }
+        EXPECT_TRUE(y->equalData(ans));
+
+        g->removeTensor(z);
+        EXPECT_EQ(g->getTensor(z->getFuid()), nullptr);
+    }
+
+    TEST(Graph, TopoSortAndRemoval)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor x = g->addTensor({2, 2}), a = g->addTensor({2, 2}),
+               b = g->addTensor({2, 2}), c = g->addTensor({2, 2});
+        // added last first
+        auto opC = g->addOpWithOutputs<AddObj>(b, x, c);
+        auto opB = g->addOpWithOutputs<ReluObj>(a, b);
+        auto opA = g->addOpWithOutputs<ReluObj>(x, a);
+        ASSERT_TRUE(g->topo_sort());
+        EXPECT_EQ(g->getOperators(), (OpVec{opA, opB, opC}));
+        EXPECT_EQ(g->getOperator(opB->getGuid()), opB);
+        EXPECT_TRUE(g->checkValid());
+
+        // an operator reading its own output has no place in any order
+        Graph cyclic = make_ref<GraphObj>(runtime);
+        Tensor p = cyclic->addTensor(Shape{2}), q = cyclic->addTensor(Shape{2});
+        cyclic->addOpWithOutputs<ReluObj>(p, q);
+        cyclic->addOpWithOutputs<ReluObj>(q, p);
+        EXPECT_FALSE(cyclic->topo_sort());
+
+        g->removeOperator(opB);
+        g->removeTensor(a);
+        EXPECT_EQ(g->getOperator(opB->getGuid()), nullptr);
+        EXPECT_EQ(g->getOperators(), (OpVec{opA, opC}));
+        EXPECT_EQ(g->getTensors(), (TensorVec{x, b, c}));
+        EXPECT_EQ(g->getTensor(c->getFuid()), c);
+    }
+
+    TEST(Graph, Rewrite)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor x = g->addTensor({2, 2});
+        auto r1 = g->addOp<ReluObj>(x, nullptr);
+        auto r2 = g->addOp<ReluObj>(r1->getOutput(), nullptr);
+        auto r3 = g->addOp<ReluObj>(r2->getOutput(), nullptr);
+        auto r4 = g->addOp<ReluObj>(r3->getOutput(), nullptr);
+        auto s = g->addOp<SubObj>(r2->getOutput(), x, nullptr);
+        // relu(relu(x)) reads relu(x) instead; the rule matches again at
+        // every operator it rewires
+        vector<RewriteRule> rules{
+            {"relu-relu",
+             Pattern(OpType::Relu).input(0, Pattern(OpType::Relu)),
+             [](GraphObj &, const OpVec &m) -> optional<Rewrite>
+             { return Rewrite{{}, {{m[0]->getOutput(), m[1]->getOutput()}}}; }},
+        };
+        EXPECT_EQ(applyRewrites(*g, rules), 2u);
+        // r4 writes a graph output, which keeps its producer
+        EXPECT_EQ(g->getOperators(), (OpVec{r1, r4, s}));
+        EXPECT_EQ(r4->getInputs(0), r1->getOutput());
+        EXPECT_EQ(s->getInputs(0), r1->getOutput());
+        EXPECT_EQ(g->getTensors().size(), 4u);
+        EXPECT_TRUE(g->checkValid());
+
+        // a Transpose read by something else stays next to the MatMul it
+        // was folded into
+        Graph h = make_ref<GraphObj>(runtime);
+        Tensor a = h->addTensor({3, 2}), w = h->addTensor({3, 4});
+        auto t = h->addOp<TransposeObj>(a, nullptr, Shape{1, 0});
+        auto mm = h->addOp<MatmulObj>(t->getOutput(), w, nullptr);
+        auto relu = h->addOp<ReluObj>(t->getOutput(), nullptr);
+        h->optimize();
+        ASSERT_EQ(h->getOperators().size(), 3u);
+        auto folded = as<MatmulObj>(mm->getOutput()->getSource());
+        EXPECT_NE(folded, mm);
+        EXPECT_EQ(folded->getInputs(0), a);
+        EXPECT_TRUE(folded->getTransA());
+        EXPECT_EQ(t->getOutput()->getTargets(), (OpVec{relu}));
+        EXPECT_TRUE(h->checkValid());
+    }
+
+    // x -> permute chain that composes to {1, 0, 2} -> Cast Float2Float ->
+    // single-input Concat -> Relu
+    static TensorVec buildNoOpChain(const Graph &g, Tensor &x, Tensor &out)
+    {
+        x = g->addTensor({2, 3, 4});
+        auto t = g->addOp<TransposeObj>(x, nullptr, Shape{1, 2, 0})
+                     ->getOutput();
+        t = g->addOp<TransposeObj>(t, nullptr, Shape{2, 0, 1})->getOutput();
+        t = g->addOp<TransposeObj>(t, nullptr, Shape{2, 0, 1})->getOutput();
+        t = g->addOp<TransposeObj>(t, nullptr, Shape{0, 2, 1})->getOutput();
+        t = g->addOp<TransposeObj>(t, nullptr, Shape{1, 2, 0})->getOutput();
+        t = g->addOp<CastObj>(t, nullptr, CastType::Float2Float)->getOutput();
+        t = g->addOp<ConcatObj>(TensorVec{t}, nullptr, 1)->getOutput();
+        out = g->addOp<ReluObj>(t, nullptr)->getOutput();
+        return {out};
+    }
+
+    TEST(Graph, SimplifyChains)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Tensor x, out;
+        Graph g = expectOptimizeKeepsResults(
+            [&](const Graph &graph) { return buildNoOpChain(graph, x, out); });
+        ASSERT_EQ(g->getOperators().size(), 2u);
+        auto transpose = as<TransposeObj>(g->getOperators()[0]);
+        ASSERT_TRUE(transpose);
+        EXPECT_EQ(transpose->getInputs(0), x);
+        EXPECT_EQ(transpose->getPermute(), (vector<int>{1, 0, 2}));
+        EXPECT_EQ(out->getSource()->getInputs(0), transpose->getOutput());
+        EXPECT_EQ(g->getTensors().size(), 3u);
+        EXPECT_TRUE(g->checkValid());
+
+        // a chain ending in a graph output keeps an identity Transpose
+        Graph h = make_ref<GraphObj>(runtime);
+        Tensor y = h->addTensor({2, 3});
+        auto u = h->addOp<TransposeObj>(y, nullptr, Shape{1, 0})->getOutput();
+        h->addOp<TransposeObj>(u, nullptr, Shape{1, 0});
+        h->optimize();
+        ASSERT_EQ(h->getOperators().size(), 1u);
+        EXPECT_EQ(h->getOperators()[0]->getInputs(0), y);
+        EXPECT_EQ(as<TransposeObj>(h->getOperators()[0])->getPermute(),
+                  (vector<int>{0, 1}));
+    }
+
+    // relu(x concat(wᵀ, wᵀ) + relu(b)) with constant w and b
+    static TensorVec buildConstantWeights(const Graph &g, Tensor &out)
+    {
+        auto x = g->addTensor({2, 8});
+        auto w = g->addTensor({3, 4}), b = g->addTensor(Shape{3});
+        w->setConstant(IncrementalGenerator());
+        b->setConstant(ValGenerator<-2>());
+        auto t = g->addOp<TransposeObj>(w, nullptr, Shape{1, 0})->getOutput();
+        auto c = g->addOp<ConcatObj>(TensorVec{t, t}, nullptr, 0)->getOutput();
+        auto rb = g->addOp<ReluObj>(b, nullptr)->getOutput();
+        auto mm = g->addOp<MatmulObj>(x, c, nullptr)->getOutput();
+        out = g->addOp<AddObj>(mm, rb, nullptr)->getOutput();
+        return {out};
+    }
+
+    TEST(Graph, FoldConstants)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Tensor out;
+        Graph g = expectOptimizeKeepsResults(
+            [&](const Graph &graph)
+            { return buildConstantWeights(graph, out); });
+        // the Add of the folded bias is a MatMul epilogue
+        ASSERT_EQ(g->getOperators().size(), 1u);
+        auto matmul = as<MatmulObj>(g->getOperators()[0]);
+        ASSERT_TRUE(matmul);
+        auto c = matmul->getInputs(1);
+        EXPECT_TRUE(c->isConstant());
+        EXPECT_EQ(c->getDims(), (Shape{8, 3}));
+        ASSERT_TRUE(matmul->getBias());
+        EXPECT_TRUE(matmul->getBias()->isConstant());
+        // x, the concatenation, the bias and out
+        EXPECT_EQ(g->getTensors().size(), 4u);
+        EXPECT_TRUE(g->checkValid());
+        // constants stay out of the arena
+        EXPECT_TRUE(c->hasExternalData());
+
+        // an operator writing a graph output is not folded away
+        Graph h = make_ref<GraphObj>(runtime);
+        Tensor k = h->addTensor(Shape{4});
+        k->setConstant(ValGenerator<-1>());
+        auto relu = h->addOp<ReluObj>(k, nullptr);
+        h->optimize();
+        EXPECT_EQ(h->getOperators(), (OpVec{relu}));
+        EXPECT_EQ(h->getOutputs(), (TensorVec{relu->getOutput()}));
+        EXPECT_TRUE(h->checkValid());
+    }
+
+    // concat(clip(xᵀ w, 0, 5), clip(xᵀ w, 0, 6), clip(xᵀ w, 0, 5)), every
+    // operator but the Concat computed once per use
+    static TensorVec buildDuplicates(const Graph &g, Tensor &out)
+    {
+        auto x = g->addTensor({3, 2}), w = g->addTensor({3, 4});
+        TensorVec parts;
+        for (float max : {5.f, 6.f, 5.f})
+        {
+            auto t = g->addOp<TransposeObj>(x, nullptr, Shape{1, 0});
+            auto mm = g->addOp<MatmulObj>(t->getOutput(), w, nullptr);
+            parts.emplace_back(
+                g->addOp<ClipObj>(mm->getOutput(), nullptr, 0.f, max)
+                    ->getOutput());
+        }
+        out = g->addOp<ConcatObj>(parts, nullptr, 0)->getOutput();
+        return {out};
+    }
+
+    TEST(Graph, EliminateCommonSubexpressions)
+    {
+        Tensor out;
+        Graph g = expectOptimizeKeepsResults(
+            [&](const Graph &graph) { return buildDuplicates(graph, out); });
+        // one MatMul, read by the two different Clips
+        ASSERT_EQ(g->getOperators().size(), 4u);
+        auto concat = out->getSource();
+        auto first = concat->getInputs(0)->getSource();
+        EXPECT_EQ(concat->getInputs(2), concat->getInputs(0));
+        EXPECT_NE(concat->getInputs(1), concat->getInputs(0));
+        auto matmul = as<MatmulObj>(first->getInputs(0)->getSource());
+        ASSERT_TRUE(matmul);
+        EXPECT_TRUE(matmul->getTransA());
+        EXPECT_EQ(concat->getInputs(1)->getSource()->getInputs(0),
+                  matmul->getOutput());
+        EXPECT_EQ(matmul->getOutput()->getTargets().size(), 2u);
+        EXPECT_TRUE(g->checkValid());
+    }
+}
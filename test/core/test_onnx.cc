@@ -0,0 +1,251 @@
+#include "core/graph.h"
+#include "core/onnx.h"
+#include "core/runtime.h"
+#include "operators/matmul.h"
+#include "operators/unary.h"
+
+#include "test.h"
+#include <cstdio>
+#include <fstream>
+
+namespace infini
+{
+    // Just enough protobuf writing to build ONNX models by hand.
+    struct Proto
+    {
+        string buf;
+
+        Proto &varint(uint64_t v)
+        {
+            for (; v >= 0x80; v >>= 7)
+                buf += char(v | 0x80);
+            buf += char(v);
+            return *this;
+        }
+        Proto &i(int field, int64_t v)
+        {
+            return varint(field << 3).varint(v);
+        }
+        Proto &s(int field, const string &v)
+        {
+            varint(field << 3 | 2).varint(v.size());
+            buf += v;
+            return *this;
+        }
+        Proto &m(int field, const Proto &msg) { return s(field, msg.buf); }
+        Proto &f(int field, float v)
+        {
+            varint(field << 3 | 5);
+            buf.append(reinterpret_cast<const char *>(&v), sizeof(v));
+            return *this;
+        }
+        Proto &floats(int field, const vector<float> &v)
+        {
+            return s(field, string(reinterpret_cast<const char *>(v.data()),
+                                   v.size() * sizeof(float)));
+        }
+        Proto &ints(int field, const vector<int64_t> &v)
+        {
+            Proto packed;
+            for (auto x : v)
+                packed.varint(x);
+            return m(field, packed);
+        }
+    };
+
+    static Proto tensorProto(const string &name, int dtype,
+                             const vector<int64_t> &dims)
+    {
+        Proto t;
+        t.ints(1, dims).i(2, dtype).s(8, name);
+        return t;
+    }
+
+    static Proto valueInfo(const string &name, int dtype,
+                           const vector<string> &dims)
+    {
+        Proto shape;
+        for (auto &d : dims)
+        {
+            Proto dim;
+            if (std::isdigit(d[0]))
+                dim.i(1, std::stoll(d));
+            else
+                dim.s(2, d);
+            shape.m(1, dim);
+        }
+        Proto tensor, type, value;
+        tensor.i(1, dtype).m(2, shape);
+        type.m(1, tensor);
+        return value.s(1, name).m(2, type);
+    }
+
+    static Proto node(const string &op, const vector<string> &inputs,
+                      const vector<string> &outputs,
+                      const vector<Proto> &attributes = {},
+                      const string &domain = "")
+    {
+        Proto n;
+        for (auto &in : inputs)
+            n.s(1, in);
+        for (auto &out : outputs)
+            n.s(2, out);
+        n.s(4, op);
+        for (auto &a : attributes)
+            n.m(5, a);
+        if (!domain.empty())
+            n.s(7, domain);
+        return n;
+    }
+
+    static Proto attribute(const string &name) { return Proto().s(1, name); }
+
+    static string writeModel(const string &file, const Proto &graph)
+    {
+        Proto model;
+        model.i(1, 8).m(7, graph);
+        string path = ::testing::TempDir() + file;
+        std::ofstream(path, std::ios::binary | std::ios::trunc)
+            .write(model.buf.data(), model.buf.size());
+        return path;
+    }
+
+    TEST(Onnx, ImportAndRun)
+    {
+        const int FLOAT = 1, INT64 = 7;
+        vector<float> w(12);
+        for (int v = 0; v < 12; ++v)
+            w[v] = 0.5f * v;
+        Proto scalar5 = tensorProto("", FLOAT, {});
+        scalar5.floats(9, {5.f});
+        Proto q = tensorProto("q", INT64, {1, 3});
+        q.ints(7, {1, -2, 3});
+
+        Proto graph;
+        graph.m(1, node("Gemm", {"x", "w", "b"}, {"g"}))
+            .m(1, node("Constant", {}, {"lo"},
+                       {attribute("value_float").f(2, 0.f)}))
+            .m(1, node("Constant", {}, {"hi"},
+                       {attribute("value").m(5, scalar5)}))
+            .m(1, node("Clip", {"g", "lo", "hi"}, {"c"}))
+            .m(1, node("Cast", {"q"}, {"qf"}, {attribute("to").i(3, FLOAT)}))
+            .m(1, node("Add", {"c", "qf"}, {"a"}))
+            .m(1, node("Transpose", {"a"}, {"t"}))
+            .m(1, node("Identity", {"t"}, {"ti"}))
+            .m(1, node("MatMul", {"ti", "x"}, {"mm"}))
+            .m(1, node("Concat", {"mm", "mm"}, {"cat"},
+                       {attribute("axis").i(3, 0)}))
+            .m(1, node("Cast", {"cat"}, {"y"}, {attribute("to").i(3, FLOAT)}))
+            .m(1, node("Sub", {"a", "qf"}, {"s"}))
+            .m(1, node("Relu", {"s"}, {"r"}))
+            .m(5, tensorProto("w", FLOAT, {4, 3}).floats(9, w))
+            .m(5, tensorProto("b", FLOAT, {3}).floats(4, {1.f, 2.f, 3.f}))
+            .m(5, q)
+            .m(5, tensorProto("unused", FLOAT, {2}).floats(9, {1.f, 2.f}))
+            .m(11, valueInfo("x", FLOAT, {"N", "4"}))
+            .m(11, valueInfo("w", FLOAT, {"4", "3"}))
+            .m(11, valueInfo("dead", FLOAT, {"2"}))
+            .m(12, valueInfo("y", FLOAT, {"6", "4"}))
+            .m(12, valueInfo("r", FLOAT, {"N", "3"}));
+        string path = writeModel("onnx_import.onnx", graph);
+
+        EXPECT_TRUE(unsupportedOnnxOps(path).empty());
+        EXPECT_THROW(importOnnx(NativeCpuRuntimeObj::getInstance(), path),
+                     Exception); // N has no value
+        auto model =
+            importOnnx(NativeCpuRuntimeObj::getInstance(), path, {{"N", 2}});
+        Graph g = model.graph;
+        ASSERT_EQ(model.inputs.size(), 1u);
+        EXPECT_EQ(model.inputs[0].first, "x");
+        Tensor x = model.inputs[0].second;
+        EXPECT_EQ(x->getDims(), (Shape{2, 4}));
+        ASSERT_EQ(model.outputs.size(), 2u);
+        Tensor y = model.outputs[0].second, r = model.outputs[1].second;
+        EXPECT_EQ(y->getDims(), (Shape{6, 4}));
+
+        // Gemm took b as its bias, the Float-to-Float Cast and Identity
+        // vanished, and the unused initializer was never added
+        int matmuls = 0, casts = 0, weights = 0;
+        for (auto &op : g->getOperators())
+        {
+            if (auto mm = as<MatmulObj>(op); mm && mm->getBias())
+            {
+                EXPECT_EQ(mm->getBias()->getDims(), (Shape{3}));
+            }
+            matmuls += op->getOpType() == OpType::MatMul;
+            casts += op->getOpType() == OpType::Cast;
+        }
+        for (auto &t : g->getTensors())
+            weights += t->isWeight();
+        EXPECT_EQ(matmuls, 2);
+        EXPECT_EQ(casts, 1);
+        EXPECT_EQ(weights, 3);
+
+        g->dataMalloc();
+        x->setData(IncrementalGenerator());
+        NativeCpuRuntimeObj::getInstance()->run(g);
+
+        vector<float> qf{1, -2, 3}, c(6), a(6), ansY, ansR;
+        for (int i = 0; i < 2; ++i)
+            for (int j = 0; j < 3; ++j)
+            {
+                float acc = j + 1;
+                for (int k = 0; k < 4; ++k)
+                    acc += float(4 * i + k) * w[3 * k + j];
+                c[3 * i + j] = std::min(std::max(acc, 0.f), 5.f);
+                a[3 * i + j] = c[3 * i + j] + qf[j];
+                ansR.emplace_back(c[3 * i + j]);
+            }
+        for (int rep = 0; rep < 2; ++rep)
+            for (int j = 0; j < 3; ++j)
+                for (int k = 0; k < 4; ++k)
+                    ansY.emplace_back(a[j] * float(k) +
+                                      a[3 + j] * float(4 + k));
+        EXPECT_TRUE(y->equalData(ansY));
+        EXPECT_TRUE(r->equalData(ansR));
+        std::remove(path.c_str());
+    }
+
+    TEST(Onnx, ReportsUnsupportedOperators)
+    {
+        const int FLOAT = 1;
+        Proto graph;
+        graph.m(1, node("Conv", {"x", "k"}, {"c1"}))
+            .m(1, node("Relu", {"c1"}, {"r"}))
+            .m(1, node("Conv", {"r", "k"}, {"c2"}))
+            .m(1, node("Softmax", {"c2"}, {"s"}))
+            .m(1, node("Gelu", {"s"}, {"y"}, {}, "com.microsoft"))
+            .m(11, valueInfo("x", FLOAT, {"1", "3", "8", "8"}))
+            .m(12, valueInfo("y", FLOAT, {"1", "3", "8", "8"}));
+        string path = writeModel("onnx_unsupported.onnx", graph);
+
+        auto counts = unsupportedOnnxOps(path);
+        EXPECT_EQ(counts, (map<string, int>{{"Conv", 2},
+                                             {"Softmax", 1},
+                                             {"com.microsoft:Gelu", 1}}));
+        try
+        {
+            importOnnx(NativeCpuRuntimeObj::getInstance(), path);
+            FAIL() << "importOnnx accepted unsupported operators";
+        }
+        catch (const Exception &e)
+        {
+            EXPECT_NE(string(e.what()).find("Conv x2"), string::npos);
+        }
+        std::remove(path.c_str());
+    }
+
+    TEST(Onnx, RejectsMalformedProtobuf)
+    {
+        // Field 3 with wire type 7, which protobuf does not define
+        Proto model;
+        model.i(1, 8).varint(3 << 3 | 7);
+        string path = ::testing::TempDir() + "onnx_malformed.onnx";
+        std::ofstream(path, std::ios::binary | std::ios::trunc)
+            .write(model.buf.data(), model.buf.size());
+        EXPECT_THROW(unsupportedOnnxOps(path), Exception);
+        EXPECT_THROW(importOnnx(NativeCpuRuntimeObj::getInstance(), path),
+                     Exception);
+        std::remove(path.c_str());
+    }
+} // namespace infini
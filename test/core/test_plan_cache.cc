@@ -0,0 +1,193 @@
+#include "core/graph.h"
+#include "core/plan_cache.h"
+#include "core/runtime.h"
+#include "operators/concat.h"
+#include "operators/element_wise.h"
+#include "operators/matmul.h"
+#include "operators/transpose.h"
+#include "operators/unary.h"
+
+#include "test.h"
+#include <cstdio>
+#include <fstream>
+
+namespace infini
+{
+    struct Model
+    {
+        Graph g;
+        Tensor x, w, b, z, y;
+    };
+
+    // relu(x w + b), transposed, added to z, clipped and concatenated with
+    // the transpose
+    static Model build(int rows = 4, float clipMax = 6.f)
+    {
+        Model m;
+        m.g = make_ref<GraphObj>(NativeCpuRuntimeObj::getInstance());
+        auto &g = m.g;
+        m.x = g->addTensor({rows, 8}, DataType::Float32);
+        m.w = g->addTensor({8, 6}, DataType::Float32);
+        m.b = g->addTensor({6}, DataType::Float32);
+        m.z = g->addTensor({6, rows}, DataType::Float32);
+        m.w->setWeight();
+        m.b->setWeight();
+        auto mm = g->addOp<MatmulObj>(m.x, m.w, nullptr)->getOutput();
+        auto a = g->addOp<AddObj>(mm, m.b, nullptr)->getOutput();
+        auto r = g->addOp<ReluObj>(a, nullptr)->getOutput();
+        auto t = g->addOp<TransposeObj>(r, nullptr, Shape{1, 0})->getOutput();
+        auto u = g->addOp<AddObj>(t, m.z, nullptr)->getOutput();
+        auto c = g->addOp<ClipObj>(u, nullptr, 0.f, clipMax)->getOutput();
+        m.y = g->addOp<ConcatObj>(TensorVec{c, t}, nullptr, 0)->getOutput();
+        return m;
+    }
+
+    static void run(const Model &m)
+    {
+        m.x->setData(IncrementalGenerator());
+        m.w->setData(IncrementalGenerator());
+        m.b->setData(ValGenerator<-100>());
+        m.z->setData(ValGenerator<-1>());
+        m.g->getRuntime()->run(m.g);
+    }
+
+    static void expectSamePlan(const Model &a, const Model &e)
+    {
+        auto &ta = a.g->getTensors(), &te = e.g->getTensors();
+        ASSERT_EQ(ta.size(), te.size());
+        for (size_t i = 0; i < ta.size(); ++i)
+        {
+            EXPECT_EQ(ta[i]->getDims(), te[i]->getDims());
+            ASSERT_EQ(ta[i]->hasData(), te[i]->hasData());
+            if (!ta[i]->hasData())
+                continue;
+            EXPECT_EQ(ta[i]->getStrides(), te[i]->getStrides());
+            EXPECT_EQ(ta[i]->getRawDataPtr<char *>() -
+                          a.x->getRawDataPtr<char *>(),
+                      te[i]->getRawDataPtr<char *>() -
+                          e.x->getRawDataPtr<char *>());
+        }
+        auto &oa = a.g->getOperators(), &oe = e.g->getOperators();
+        ASSERT_EQ(oa.size(), oe.size());
+        for (size_t i = 0; i < oa.size(); ++i)
+        {
+            EXPECT_EQ(oa[i]->getOpType(), oe[i]->getOpType());
+            EXPECT_EQ(a.g->getMemoryDependencies(oa[i].get()).size(),
+                      e.g->getMemoryDependencies(oe[i].get()).size());
+        }
+    }
+
+    TEST(PlanCache, HashesStructure)
+    {
+        auto h = hashGraph(build().g);
+        EXPECT_EQ(hashGraph(build().g), h);
+        EXPECT_NE(hashGraph(build(5).g), h);
+        EXPECT_NE(hashGraph(build(4, 5.f).g), h);
+
+        // the same operators wired differently
+        auto wired = [](bool swap)
+        {
+            Graph g = make_ref<GraphObj>(NativeCpuRuntimeObj::getInstance());
+            Tensor p = g->addTensor({2, 2}), q = g->addTensor({2, 2});
+            auto s = g->addOp<SubObj>(p, q, nullptr)->getOutput();
+            g->addOp<SubObj>(swap ? p : s, swap ? s : p, nullptr);
+            return hashGraph(g);
+        };
+        EXPECT_EQ(wired(false), wired(false));
+        EXPECT_NE(wired(false), wired(true));
+    }
+
+    TEST(PlanCache, ReusesPlans)
+    {
+        auto &cache = PlanCache::getInstance();
+        cache.clear();
+        auto cold = build();
+        EXPECT_FALSE(cache.prepare(cold.g));
+        EXPECT_EQ(cache.size(), 1u);
+        run(cold);
+
+        auto warm = build();
+        EXPECT_TRUE(cache.prepare(warm.g));
+        EXPECT_EQ(cache.size(), 1u);
+        expectSamePlan(cold, warm);
+        EXPECT_TRUE(warm.g->checkValid());
+        run(warm);
+        EXPECT_TRUE(warm.y->equalData(cold.y));
+
+        // another shape is another entry
+        EXPECT_FALSE(cache.prepare(build(5).g));
+        EXPECT_EQ(cache.size(), 2u);
+
+        string path = ::testing::TempDir() + "plan_cache.itp";
+        cache.save(path);
+        cache.clear();
+        EXPECT_EQ(cache.load(path), 2u);
+        EXPECT_EQ(cache.load(path), 0u); // already there
+        auto loaded = build();
+        EXPECT_TRUE(cache.prepare(loaded.g));
+        expectSamePlan(cold, loaded);
+        run(loaded);
+        EXPECT_TRUE(loaded.y->equalData(cold.y));
+
+        std::ofstream(path, std::ios::binary | std::ios::in)
+            .write("ITPLANC\0\x07", 9);
+        EXPECT_THROW(cache.load(path), Exception);
+        std::remove(path.c_str());
+        cache.clear();
+    }
+
+    // x · wᵀ with a constant w, whose Transpose optimize() folds
+    static Graph buildFolded(int scale, Tensor &x, Tensor &y)
+    {
+        Graph g = make_ref<GraphObj>(NativeCpuRuntimeObj::getInstance());
+        x = g->addTensor({2, 3}, DataType::Float32);
+        auto w = g->addTensor({4, 3}, DataType::Float32);
+        w->setConstant([scale](void *data, size_t size, DataType)
+                       {
+                           for (size_t i = 0; i < size; ++i)
+                               static_cast<float *>(data)[i] = scale * i;
+                       });
+        auto t = g->addOp<TransposeObj>(w, nullptr, Shape{1, 0})->getOutput();
+        y = g->addOp<MatmulObj>(x, t, nullptr)->getOutput();
+        return g;
+    }
+
+    TEST(PlanCache, FoldsConstants)
+    {
+        auto &cache = PlanCache::getInstance();
+        cache.clear();
+        auto run = [](int scale, bool hit)
+        {
+            Tensor x, y;
+            Graph g = buildFolded(scale, x, y);
+            EXPECT_EQ(PlanCache::getInstance().prepare(g), hit);
+            EXPECT_EQ(g->getOperators().size(), 1u);
+            x->setData(IncrementalGenerator());
+            g->getRuntime()->run(g);
+            vector<float> expected;
+            for (int r = 0; r < 2; ++r)
+                for (int c = 0; c < 4; ++c)
+                {
+                    float sum = 0;
+                    for (int k = 0; k < 3; ++k)
+                        sum += (r * 3 + k) * scale * (c * 3 + k);
+                    expected.emplace_back(sum);
+                }
+            EXPECT_TRUE(y->equalData(expected));
+        };
+        run(1, false);
+        run(1, true);
+        // other weights fold to another result
+        run(2, false);
+        EXPECT_EQ(cache.size(), 2u);
+
+        string path = ::testing::TempDir() + "plan_cache_folded.itp";
+        cache.save(path);
+        cache.clear();
+        EXPECT_EQ(cache.load(path), 2u);
+        run(2, true);
+        run(1, true);
+        std::remove(path.c_str());
+        cache.clear();
+    }
+} // namespace infini
@@ -0,0 +1,105 @@
+#include "core/graph.h"
+#include "core/kernel.h"
+#include "core/plan.h"
+#include "core/runtime.h"
+#include "operators/element_wise.h"
+#include "operators/matmul.h"
+#include "operators/transpose.h"
+#include "operators/unary.h"
+#include "utils/profiler.h"
+
+#include "test.h"
+
+#include <cstdio>
+#include <fstream>
+
+namespace infini
+{
+    TEST(Profiler, RecordsEveryOperator)
+    {
+        auto runtime = make_ref<NativeCpuRuntimeObj>();
+        runtime->setInterOpThreads(1);
+        EXPECT_EQ(runtime->getProfiler(), nullptr);
+        Graph g = make_ref<GraphObj>(runtime);
+        auto a = g->addTensor({2, 8, 16}, DataType::Float32);
+        auto b = g->addTensor({16, 4}, DataType::Float32);
+        auto matmul = g->addOp<MatmulObj>(a, b, nullptr);
+        auto relu = g->addOp<ReluObj>(matmul->getOutput(), nullptr);
+        g->addOp<TransposeObj>(relu->getOutput(), nullptr, Shape{0, 2, 1});
+        g->dataMalloc();
+        runtime->run(g); // not recorded
+
+        runtime->setProfiling(true);
+        auto *profiler = runtime->getProfiler();
+        ASSERT_NE(profiler, nullptr);
+        runtime->run(g);
+        runtime->run(g->compile());
+        auto records = profiler->getRecords();
+        ASSERT_EQ(records.size(), 6u);
+        for (size_t i = 0; i < records.size(); ++i)
+        {
+            const auto &r = records[i];
+            const auto &op = g->getOperators()[i % 3];
+            EXPECT_EQ(r.guid, op->getGuid());
+            EXPECT_EQ(r.type, op->getOpType());
+            EXPECT_LE(r.begin, r.end);
+            // one after another on the calling thread
+            EXPECT_EQ(r.thread, 0);
+            EXPECT_GE(r.begin, i > 0 ? records[i - 1].end : 0);
+        }
+        EXPECT_EQ(records[0].kernel, "MatmulPacked_CPU");
+        EXPECT_EQ(records[0].flops, 2.0 * 2 * 8 * 4 * 16);
+        EXPECT_EQ(records[0].inputBytes, (2 * 8 * 16 + 16 * 4) * 4u);
+        EXPECT_EQ(records[0].outputBytes, 2 * 8 * 4 * 4u);
+        EXPECT_EQ(records[1].flops, 2 * 8 * 4);
+        EXPECT_EQ(records[2].flops, 0);
+
+        auto summary = profiler->summary();
+        for (auto name : {"MatMul", "Relu", "Transpose", "total"})
+            EXPECT_NE(summary.find(name), string::npos) << summary;
+
+        string path = "test_profiler_trace.json";
+        ASSERT_TRUE(profiler->writeChromeTrace(path));
+        std::ifstream file(path);
+        string trace((std::istreambuf_iterator<char>(file)),
+                     std::istreambuf_iterator<char>());
+        std::remove(path.c_str());
+        EXPECT_EQ(trace.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["),
+                  0u);
+        EXPECT_NE(trace.find("\"name\":\"MatMul\",\"cat\":\"MatmulPacked_CPU\""),
+                  string::npos);
+        EXPECT_EQ(trace.substr(trace.size() - 4), "\n]}\n");
+
+        profiler->clear();
+        EXPECT_TRUE(profiler->getRecords().empty());
+        runtime->setProfiling(false);
+        runtime->run(g);
+        EXPECT_EQ(runtime->getProfiler(), nullptr);
+    }
+
+    TEST(Profiler, ParallelRun)
+    {
+        auto runtime = make_ref<NativeCpuRuntimeObj>();
+        runtime->setInterOpThreads(3);
+        runtime->setProfiling(true);
+        Graph g = make_ref<GraphObj>(runtime);
+        auto x = g->addTensor({64, 64}, DataType::Float32);
+        TensorVec branches;
+        for (int i = 0; i < 4; ++i)
+            branches.emplace_back(g->addOp<ReluObj>(x, nullptr)->getOutput());
+        g->addOp<AddObj>(branches[0], branches[1], nullptr);
+        g->addOp<MulObj>(branches[2], branches[3], nullptr);
+        g->dataMalloc();
+        runtime->run(g);
+
+        auto records = runtime->getProfiler()->getRecords();
+        ASSERT_EQ(records.size(), 6u);
+        for (auto &r : records)
+        {
+            // run on the pool's workers
+            EXPECT_GE(r.thread, 1);
+            EXPECT_LE(r.thread, 3);
+        }
+    }
+
+} // namespace infini
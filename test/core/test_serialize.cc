@@ -0,0 +1,146 @@
+#include "core/graph.h"
+#include "core/runtime.h"
+#include "core/serialize.h"
+#include "operators/concat.h"
+#include "operators/element_wise.h"
+#include "operators/matmul.h"
+#include "operators/transpose.h"
+#include "operators/unary.h"
+
+#include "test.h"
+#include <cstdio>
+#include <fstream>
+
+namespace infini
+{
+    static size_t indexOf(const Graph &g, const Tensor &tensor)
+    {
+        auto &tensors = g->getTensors();
+        return std::find(tensors.begin(), tensors.end(), tensor) -
+               tensors.begin();
+    }
+
+    TEST(Serialize, RoundTrip)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor x = g->addTensor({2, 4}, DataType::Float32);
+        Tensor w = g->addTensor({4, 3}, DataType::Float32);
+        Tensor b = g->addTensor({1, 3}, DataType::Float32);
+        Tensor k = g->addTensor({1, 2}, DataType::Float32);
+        for (auto &t : {w, b, k})
+            t->setWeight();
+        auto mm = g->addOp<MatmulObj>(x, w, nullptr, false, false, b,
+                                      MatmulActivation::Clip, -1.0f, 50.0f)
+                      ->getOutput();
+        auto t = g->addOp<TransposeObj>(mm, nullptr, Shape{1, 0})->getOutput();
+        auto c = g->addOp<CastObj>(t, nullptr, CastType::Float2Float)
+                     ->getOutput();
+        auto cl = g->addOp<ClipObj>(c, nullptr, 0.0f, std::nullopt)
+                      ->getOutput();
+        auto cat = g->addOp<ConcatObj>(TensorVec{cl, t}, nullptr, 0)
+                       ->getOutput();
+        vector<FusedStep> steps{{OpType::Sub, 1, true, {}, {}},
+                                {OpType::Relu, -1, false, {}, {}}};
+        auto out =
+            g->addOp<FusedElementWiseObj>(TensorVec{cat, k}, nullptr, steps)
+                ->getOutput();
+        g->dataMalloc();
+        x->setData(IncrementalGenerator());
+        w->setData(IncrementalGenerator());
+        b->setData(ValGenerator<1>());
+        k->setData(ValGenerator<40>());
+
+        string path = ::testing::TempDir() + "serialize_round_trip.itg";
+        saveGraph(g, path);
+        Graph h = loadGraph(runtime, path);
+
+        ASSERT_EQ(h->getTensors().size(), g->getTensors().size());
+        ASSERT_EQ(h->getOperators().size(), g->getOperators().size());
+        for (size_t i = 0; i < g->getTensors().size(); ++i)
+        {
+            auto &a = g->getTensors()[i], &e = h->getTensors()[i];
+            EXPECT_EQ(a->getDims(), e->getDims());
+            EXPECT_EQ(a->getDType(), e->getDType());
+            EXPECT_EQ(a->isWeight(), e->isWeight());
+        }
+        for (size_t i = 0; i < g->getOperators().size(); ++i)
+            EXPECT_EQ(g->getOperators()[i]->getOpType(),
+                      h->getOperators()[i]->getOpType());
+        auto hmm = as<MatmulObj>(h->getTensors()[indexOf(g, mm)]->getSource());
+        ASSERT_TRUE(hmm);
+        EXPECT_EQ(hmm->getActivation(), MatmulActivation::Clip);
+        EXPECT_EQ(hmm->getClipMin(), -1.0f);
+        EXPECT_EQ(hmm->getClipMax(), 50.0f);
+        EXPECT_EQ(hmm->getBias(), h->getTensors()[indexOf(g, b)]);
+        auto hcl = as<ClipObj>(h->getTensors()[indexOf(g, cl)]->getSource());
+        ASSERT_TRUE(hcl);
+        EXPECT_EQ(hcl->getMin(), 0.0f);
+        EXPECT_FALSE(hcl->getMax());
+        auto hout = h->getTensors()[indexOf(g, out)];
+        auto hsteps = as<FusedElementWiseObj>(hout->getSource())->getSteps();
+        ASSERT_EQ(hsteps.size(), 2u);
+        EXPECT_EQ(hsteps[0].type, OpType::Sub);
+        EXPECT_TRUE(hsteps[0].reversed);
+        EXPECT_EQ(hsteps[1].type, OpType::Relu);
+
+        // weights are bound into the mapping, aligned, and stay there
+        vector<float *> bound;
+        for (auto &tensor : {w, b, k})
+        {
+            auto loaded = h->getTensors()[indexOf(g, tensor)];
+            auto *p = loaded->getRawDataPtr<float *>();
+            EXPECT_EQ(reinterpret_cast<uintptr_t>(p) % 64, 0u);
+            EXPECT_TRUE(loaded->equalData(tensor));
+            bound.emplace_back(p);
+        }
+        h->dataMalloc();
+        TensorVec weights{w, b, k};
+        for (size_t i = 0; i < weights.size(); ++i)
+            EXPECT_EQ(h->getTensors()[indexOf(g, weights[i])]
+                          ->getRawDataPtr<float *>(),
+                      bound[i]);
+
+        h->getTensors()[indexOf(g, x)]->setData(IncrementalGenerator());
+        runtime->run(g);
+        runtime->run(h);
+        EXPECT_TRUE(hout->equalData(out));
+        std::remove(path.c_str());
+    }
+
+    TEST(Serialize, RejectsBadFiles)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor x = g->addTensor({2, 3}, DataType::Float32);
+        g->addOp<ReluObj>(x, nullptr);
+        string path = ::testing::TempDir() + "serialize_bad.itg";
+        saveGraph(g, path);
+
+        string bytes;
+        {
+            std::ifstream file(path, std::ios::binary);
+            bytes.assign(std::istreambuf_iterator<char>(file), {});
+        }
+        auto rewrite = [&](const string &content)
+        {
+            std::ofstream(path, std::ios::binary | std::ios::trunc)
+                .write(content.data(), content.size());
+        };
+        EXPECT_NO_THROW(loadGraph(runtime, path));
+        auto newer = bytes;
+        newer[8] = GRAPH_FILE_VERSION + 1;
+        rewrite(newer);
+        EXPECT_THROW(loadGraph(runtime, path), Exception);
+        rewrite(bytes.substr(0, 40));
+        EXPECT_THROW(loadGraph(runtime, path), Exception);
+        rewrite("not a graph file, not at all, not even close");
+        EXPECT_THROW(loadGraph(runtime, path), Exception);
+
+        // A weight must have data before it can be saved
+        Graph h = make_ref<GraphObj>(runtime);
+        h->addTensor({2, 3}, DataType::Float32)->setWeight();
+        EXPECT_THROW(saveGraph(h, path), Exception);
+        std::remove(path.c_str());
+    }
+} // namespace infini
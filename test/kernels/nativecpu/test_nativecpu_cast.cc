@@ -0,0 +1,198 @@
+#include "core/graph.h"
+#include "core/kernel.h"
+#include "core/runtime.h"
+#include "kernels/cpu/cast_simd.h"
+#include "operators/unary.h"
+
+#include "test.h"
+
+#include <cstring>
+
+namespace infini {
+
+static uint32_t bitsOf(float x) {
+    uint32_t u;
+    std::memcpy(&u, &x, sizeof(u));
+    return u;
+}
+
+static float fromBits(uint32_t u) {
+    float x;
+    std::memcpy(&x, &u, sizeof(x));
+    return x;
+}
+
+TEST(Cast, NativeCpu) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    Graph g = make_ref<GraphObj>(runtime);
+    auto input = g->addTensor({2, 3, 1000}, DataType::Float32);
+    auto half = g->addOp<CastObj>(input, nullptr, CastType::Float2Float16);
+    auto back = g->addOp<CastObj>(half->getOutput(), nullptr,
+                                  CastType::Float162Float);
+    auto toInt = g->addOp<CastObj>(input, nullptr, CastType::Float2Int32);
+    g->dataMalloc();
+    // integers up to 2048 are exact in Float16
+    input->setData([](void *data, size_t size, DataType) {
+        auto ptr = reinterpret_cast<float *>(data);
+        for (size_t i = 0; i < size; ++i)
+            ptr[i] = float(int(i % 4096) - 2048);
+    });
+    runtime->run(g);
+
+    EXPECT_EQ(half->getOutput()->getDType(), DataType::Float16);
+    vector<float> ans(input->size());
+    vector<int32_t> ansInt(input->size());
+    for (size_t i = 0; i < ans.size(); ++i)
+        ans[i] = ansInt[i] = int(i % 4096) - 2048;
+    EXPECT_TRUE(back->getOutput()->equalData(ans));
+    EXPECT_TRUE(toInt->getOutput()->equalData(ansInt));
+}
+
+// Every 16-bit pattern through halfToFloat and back is the identity, except
+// that NaN payloads may be quieted.
+TEST(Cast, HalfRoundTrip) {
+    for (uint32_t h = 0; h < 0x10000; ++h) {
+        float f = halfToFloat(h);
+        if ((h & 0x7fff) > 0x7c00) {
+            EXPECT_TRUE(std::isnan(f));
+            EXPECT_EQ(floatToHalf(f) & 0x7e00, 0x7e00);
+            continue;
+        }
+        ASSERT_EQ(floatToHalf(f), h) << std::hex << h;
+    }
+}
+
+TEST(Cast, RoundToNearestEven) {
+    // 1 + 2^-11 lies halfway between 1 and the next half, 1 + 2^-10
+    EXPECT_EQ(floatToHalf(1.f + 0x1p-11f), 0x3c00);
+    EXPECT_EQ(floatToHalf(1.f + 3 * 0x1p-11f), 0x3c02);
+    EXPECT_EQ(floatToHalf(1.f + 0x1p-11f + 0x1p-20f), 0x3c01);
+    EXPECT_EQ(floatToHalf(65504.f), 0x7bff);
+    EXPECT_EQ(floatToHalf(65519.f), 0x7bff);
+    EXPECT_EQ(floatToHalf(65520.f), 0x7c00);
+    EXPECT_EQ(floatToHalf(-0x1p-25f), 0x8000);              // tie to zero
+    EXPECT_EQ(floatToHalf(0x1p-25f + 0x1p-30f), 0x0001);    // min subnormal
+    EXPECT_EQ(floatToHalf(3 * 0x1p-25f), 0x0002);           // tie to even
+
+    EXPECT_EQ(floatToBFloat16(fromBits(0x3f808000)), 0x3f80); // tie to even
+    EXPECT_EQ(floatToBFloat16(fromBits(0x3f818000)), 0x3f82);
+    EXPECT_EQ(floatToBFloat16(fromBits(0x3f808001)), 0x3f81);
+    EXPECT_EQ(floatToBFloat16(fromBits(0x7f7fffff)), 0x7f80); // to Inf
+    EXPECT_EQ(floatToBFloat16(fromBits(0x7f800001)) & 0x7fc0, 0x7fc0);
+    EXPECT_EQ(bitsOf(bfloat16ToFloat(0xc0a1)), 0xc0a10000u);
+}
+
+// Values that stress the rounding: ties, subnormals, overflow, Inf, NaN.
+static vector<float> floatPatterns(int64_t n) {
+    vector<float> x(n);
+    for (int64_t i = 0; i < n; ++i) {
+        uint32_t u = uint32_t(i) * 2654435761u;
+        switch (i % 6) {
+        case 0: // any float
+            x[i] = fromBits(u);
+            break;
+        case 1: // half ties
+            x[i] = fromBits((u & 0x87ffe000) | 0x38001000);
+            break;
+        case 2: // bfloat16 ties
+            x[i] = fromBits((u & 0xffff0000) | 0x8000);
+            break;
+        case 3: // half subnormals
+            x[i] = fromBits((u & 0x803fffff) | 0x33000000);
+            break;
+        case 4: // around the half overflow
+            x[i] = fromBits((u & 0x80001fff) | 0x477fe000);
+            break;
+        default:
+            x[i] = float(int(u % 2001) - 1000) / 8;
+        }
+    }
+    return x;
+}
+
+static bool sameBits(float a, float b) {
+    return bitsOf(a) == bitsOf(b) || (std::isnan(a) && std::isnan(b));
+}
+
+TEST(Cast, SimdKernels) {
+    const int64_t n = 4096 + 37; // leaves a tail after every vector width
+    auto x = floatPatterns(n);
+    vector<uint16_t> h(n);
+    vector<float> y(n);
+    for (auto isa : {CpuIsa::Scalar, CpuIsa::AVX2, CpuIsa::AVX512}) {
+        getCastKernel(CastType::Float2Float16, isa)(x.data(), h.data(), n);
+        for (int64_t i = 0; i < n; ++i) {
+            if (std::isnan(x[i]))
+                ASSERT_EQ(h[i] & 0x7e00, 0x7e00);
+            else
+                ASSERT_EQ(h[i], floatToHalf(x[i]))
+                    << cpuIsaToString(isa) << " at " << i;
+        }
+        getCastKernel(CastType::Float162Float, isa)(h.data(), y.data(), n);
+        for (int64_t i = 0; i < n; ++i)
+            ASSERT_TRUE(sameBits(y[i], halfToFloat(h[i])))
+                << cpuIsaToString(isa) << " at " << i;
+
+        getCastKernel(CastType::Float2BFloat16, isa)(x.data(), h.data(), n);
+        for (int64_t i = 0; i < n; ++i)
+            ASSERT_EQ(h[i], floatToBFloat16(x[i]))
+                << cpuIsaToString(isa) << " at " << i;
+        getCastKernel(CastType::BFloat162Float, isa)(h.data(), y.data(), n);
+        for (int64_t i = 0; i < n; ++i)
+            ASSERT_EQ(bitsOf(y[i]), uint32_t(h[i]) << 16);
+    }
+
+    // the scalar conversions agree with F16C where the machine has it
+    if (getCpuFeatures().f16c && getCpuIsa() >= CpuIsa::AVX2) {
+        getCastKernel(CastType::Float2Float16, CpuIsa::AVX2)(x.data(), h.data(),
+                                                             n);
+        for (int64_t i = 0; i < n; ++i) {
+            if (std::isnan(x[i]))
+                continue;
+            ASSERT_EQ(h[i], floatToHalf(x[i])) << x[i];
+        }
+    }
+}
+
+template <typename S, typename D>
+static void testIntegerCast(CastType type) {
+    const int64_t n = 1000 + 37;
+    vector<S> x(n);
+    vector<D> y(n);
+    for (int64_t i = 0; i < n; ++i)
+        x[i] = S(int64_t(i * 37 % 251) - 120);
+    for (auto isa : {CpuIsa::Scalar, CpuIsa::AVX2, CpuIsa::AVX512}) {
+        auto fn = getCastKernel(type, isa);
+        ASSERT_NE(fn, nullptr);
+        fn(x.data(), y.data(), n);
+        for (int64_t i = 0; i < n; ++i)
+            ASSERT_EQ(y[i], static_cast<D>(x[i]))
+                << cpuIsaToString(isa) << " at " << i;
+    }
+}
+
+TEST(Cast, AllTypes) {
+    testIntegerCast<float, int64_t>(CastType::Float2Int64);
+    testIntegerCast<float, int32_t>(CastType::Float2Int32);
+    testIntegerCast<float, int16_t>(CastType::Float2Int16);
+    testIntegerCast<float, int8_t>(CastType::Float2Int8);
+    testIntegerCast<int32_t, float>(CastType::Int322Float);
+    testIntegerCast<int32_t, int8_t>(CastType::Int322Int8);
+    testIntegerCast<int32_t, int16_t>(CastType::Int322Int16);
+    testIntegerCast<int32_t, int64_t>(CastType::Int322Int64);
+    testIntegerCast<int16_t, float>(CastType::Int162Float);
+    testIntegerCast<int16_t, int32_t>(CastType::Int162Int32);
+    testIntegerCast<int8_t, float>(CastType::Int82Float);
+    testIntegerCast<int8_t, int16_t>(CastType::Int82Int16);
+    testIntegerCast<int8_t, int32_t>(CastType::Int82Int32);
+    testIntegerCast<uint8_t, float>(CastType::Uint82Float);
+    testIntegerCast<uint8_t, int32_t>(CastType::Uint82Int32);
+    testIntegerCast<uint8_t, int64_t>(CastType::Uint82Int64);
+    testIntegerCast<int64_t, int32_t>(CastType::Int642Int32);
+    testIntegerCast<int64_t, uint32_t>(CastType::Int642Uint32);
+    testIntegerCast<int64_t, float>(CastType::Int642Float);
+    testIntegerCast<uint32_t, int64_t>(CastType::Uint322Int64);
+    testIntegerCast<float, float>(CastType::Float2Float);
+}
+
+} // namespace infini
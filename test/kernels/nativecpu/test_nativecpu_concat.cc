@@ -25,4 +25,51 @@ TEST(Concat, NativeCpu) {
                       6, 7, 8, 1, 1, 1, 9, 10, 11, 1, 1, 1}));
 }
 
+// Input i holds i * 1000000 + its own flat index; checked element by element.
+static void testConcatNativeCpu(const vector<Shape> &shapes, int dim) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    Graph g = make_ref<GraphObj>(runtime);
+    TensorVec inputs;
+    for (auto &shape : shapes)
+        inputs.emplace_back(g->addTensor(shape, DataType::Float32));
+    auto op = g->addOp<ConcatObj>(inputs, nullptr, dim);
+    g->dataMalloc();
+    for (size_t i = 0; i < inputs.size(); ++i)
+        inputs[i]->setData([i](void *data, size_t size, DataType) {
+            auto ptr = reinterpret_cast<float *>(data);
+            for (size_t j = 0; j < size; ++j)
+                ptr[j] = float(i * 1000000 + j);
+        });
+    runtime->run(g);
+
+    auto output = op->getOutput();
+    const auto &outDim = output->getDims();
+    size_t outer = 1, inner = 1;
+    for (int d = 0; d < dim; ++d)
+        outer *= outDim[d];
+    for (size_t d = dim + 1; d < outDim.size(); ++d)
+        inner *= outDim[d];
+    vector<float> ans;
+    for (size_t o = 0; o < outer; ++o)
+        for (size_t i = 0; i < shapes.size(); ++i) {
+            size_t block = shapes[i][dim] * inner;
+            for (size_t j = 0; j < block; ++j)
+                ans.emplace_back(float(i * 1000000 + o * block + j));
+        }
+    EXPECT_TRUE(output->equalData(ans));
+}
+
+TEST(Concat, NativeCpuBlocks) {
+    testConcatNativeCpu({{3, 5, 7}, {3, 5, 7}}, 0);
+    testConcatNativeCpu({{3, 5, 7}, {3, 1, 7}, {3, 9, 7}}, 1);
+    testConcatNativeCpu({{3, 5, 7}, {3, 5, 1}, {3, 5, 2}}, 2);
+    // many tiny inputs
+    vector<Shape> many(37, Shape{64, 1, 3});
+    testConcatNativeCpu(many, 1);
+    // few large blocks, split across threads
+    testConcatNativeCpu({{1, 300000}, {1, 100001}}, 1);
+    // large enough to take the streaming store path
+    testConcatNativeCpu({{4, 300000}, {4, 300001}, {4, 1000003}}, 1);
+}
+
 } // namespace infini
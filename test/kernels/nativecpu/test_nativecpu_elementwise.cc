@@ -1,6 +1,8 @@
 #include "core/graph.h"
 #include "core/runtime.h"
+#include "kernels/cpu/binary_simd.h"
 #include "operators/element_wise.h"
+#include "utils/operator_utils.h"
 
 #include "test.h"
 
@@ -41,4 +43,94 @@ TEST(ElementWise, NativeCpu) {
         Shape{2, 1, 1}, ExpectOutput{0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11});
 }
 
+// Checks Add against an index-by-index reference on larger shapes.
+static void testBroadcastAdd(const Shape &shape1, const Shape &shape2) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    Graph g = make_ref<GraphObj>(runtime);
+    auto t1 = g->addTensor(shape1, DataType::Float32);
+    auto t2 = g->addTensor(shape2, DataType::Float32);
+    auto op = g->addOp<AddObj>(t1, t2, nullptr);
+    g->dataMalloc();
+    t1->setData(IncrementalGenerator());
+    t2->setData(IncrementalGenerator());
+    runtime->run(g);
+
+    auto out = op->getOutput()->getDims();
+    auto rank = out.size();
+    Shape a(rank, 1), b(rank, 1);
+    std::copy(shape1.begin(), shape1.end(), a.begin() + (rank - shape1.size()));
+    std::copy(shape2.begin(), shape2.end(), b.begin() + (rank - shape2.size()));
+    auto getStride = [&](const Shape &shape) {
+        int p = 1;
+        Shape stride(rank);
+        for (auto i = rank; i > 0; --i) {
+            stride[i - 1] = p;
+            p = p * shape[i - 1];
+        }
+        return stride;
+    };
+    Shape strideA = getStride(a), strideB = getStride(b);
+    ExpectOutput ans(op->getOutput()->size());
+    for (size_t i = 0; i < ans.size(); ++i) {
+        auto index = locate_index(i, out);
+        ans[i] = float(delocate_index(index, a, strideA)) +
+                 float(delocate_index(index, b, strideB));
+    }
+    EXPECT_TRUE(op->getOutput()->equalData(ans));
+}
+
+TEST(ElementWise, NativeCpuBroadcastPatterns) {
+    testBroadcastAdd({4, 33, 65}, {4, 33, 65}); // same shape
+    testBroadcastAdd({4, 33, 65}, {});          // scalar
+    testBroadcastAdd({1}, {4, 33, 65});         // scalar on the left
+    testBroadcastAdd({4, 33, 65}, {65});        // row broadcast
+    testBroadcastAdd({4, 33, 65}, {33, 1});     // column broadcast
+    testBroadcastAdd({4, 1, 65}, {1, 33, 1});   // both operands broadcast
+    testBroadcastAdd({3, 1, 5, 1}, {2, 1, 7});  // strided in the middle
+    testBroadcastAdd({300000}, {300000});       // split into segments
+}
+
+template <typename T> static void testBinarySimdKernels(DataType dtype) {
+    const int64_t n = 1000 + 37; // leaves a tail after every vector width
+    vector<T> a(n), b(n), c(n);
+    for (int64_t i = 0; i < n; ++i) {
+        a[i] = T(i * 13 % 1000 + 1);
+        b[i] = T(i % 17 + 1);
+    }
+    for (auto type : {OpType::Add, OpType::Sub, OpType::Mul, OpType::Div}) {
+        auto scalar = [&](T x, T y) -> T {
+            switch (type) {
+            case OpType::Add:
+                return x + y;
+            case OpType::Sub:
+                return x - y;
+            case OpType::Mul:
+                return x * y;
+            default:
+                return x / y;
+            }
+        };
+        for (auto isa : {CpuIsa::Scalar, CpuIsa::AVX2, CpuIsa::AVX512}) {
+            for (auto pattern :
+                 {BinaryPattern::VV, BinaryPattern::VS, BinaryPattern::SV}) {
+                auto fn = getBinarySimdKernel(type, dtype, pattern, isa);
+                ASSERT_NE(fn, nullptr);
+                fn(a.data(), b.data(), c.data(), n);
+                for (int64_t i = 0; i < n; ++i) {
+                    T x = pattern == BinaryPattern::SV ? a[0] : a[i];
+                    T y = pattern == BinaryPattern::VS ? b[0] : b[i];
+                    ASSERT_EQ(c[i], scalar(x, y))
+                        << OpType(type).toString() << " "
+                        << cpuIsaToString(isa) << " at " << i;
+                }
+            }
+        }
+    }
+}
+
+TEST(ElementWise, SimdKernels) {
+    testBinarySimdKernels<float>(DataType::Float32);
+    testBinarySimdKernels<uint32_t>(DataType::UInt32);
+}
+
 } // namespace infini
@@ -0,0 +1,161 @@
+#include "core/graph.h"
+#include "core/kernel.h"
+#include "core/runtime.h"
+#include "operators/matmul.h"
+
+#include "test.h"
+
+namespace infini
+{
+    // Small integers keep every partial sum exact in float.
+    static void patternGenerator(void *data, size_t size, DataType dataType)
+    {
+        IT_ASSERT(dataType == DataType::Float32);
+        auto ptr = reinterpret_cast<float *>(data);
+        for (size_t i = 0; i < size; ++i)
+            ptr[i] = float(int(i * 7 % 11) - 5);
+    }
+
+    // C = op(A) * op(B) with the leading dims broadcast like numpy.
+    static vector<float> referenceMatmul(const Tensor &A, const Tensor &B,
+                                         const Shape &outDims, bool transA,
+                                         bool transB)
+    {
+        auto dimsA = A->getDims(), dimsB = B->getDims();
+        int rankA = dimsA.size(), rankB = dimsB.size(), rank = outDims.size();
+        int m = outDims[rank - 2], n = outDims[rank - 1];
+        int k = transA ? dimsA[rankA - 2] : dimsA[rankA - 1];
+        auto a = A->getRawDataPtr<float *>(), b = B->getRawDataPtr<float *>();
+        size_t batch = 1;
+        for (int i = 0; i < rank - 2; ++i)
+            batch *= outDims[i];
+        vector<float> ans(batch * m * n, 0.f);
+        for (size_t bt = 0; bt < batch; ++bt)
+        {
+            size_t offA = 0, offB = 0, rest = bt, sA = 1, sB = 1;
+            for (int i = rank - 3; i >= 0; --i)
+            {
+                size_t idx = rest % outDims[i];
+                rest /= outDims[i];
+                int ia = i - (rank - rankA), ib = i - (rank - rankB);
+                if (ia >= 0)
+                {
+                    offA += (dimsA[ia] == 1 ? 0 : idx) * sA;
+                    sA *= dimsA[ia];
+                }
+                if (ib >= 0)
+                {
+                    offB += (dimsB[ib] == 1 ? 0 : idx) * sB;
+                    sB *= dimsB[ib];
+                }
+            }
+            offA *= dimsA[rankA - 1] * dimsA[rankA - 2];
+            offB *= dimsB[rankB - 1] * dimsB[rankB - 2];
+            for (int i = 0; i < m; ++i)
+                for (int j = 0; j < n; ++j)
+                {
+                    float sum = 0;
+                    for (int p = 0; p < k; ++p)
+                        sum += a[offA + (transA ? p * m + i : i * k + p)] *
+                               b[offB + (transB ? j * k + p : p * n + j)];
+                    ans[(bt * m + i) * n + j] = sum;
+                }
+        }
+        return ans;
+    }
+
+    static void testMatmulNativeCpu(const Shape &shapeA, const Shape &shapeB,
+                                    bool transA, bool transB)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        auto A = g->addTensor(shapeA, DataType::Float32);
+        auto B = g->addTensor(shapeB, DataType::Float32);
+        auto op = g->addOp<MatmulObj>(A, B, nullptr, transA, transB);
+        g->dataMalloc();
+        A->setData(patternGenerator);
+        B->setData(patternGenerator);
+
+        runtime->run(g);
+        auto C = op->getOutput();
+        EXPECT_TRUE(C->equalData(
+            referenceMatmul(A, B, C->getDims(), transA, transB)));
+    }
+
+    TEST(Matmul, NativeCpu)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        auto A = g->addTensor({1, 2, 3}, DataType::Float32);
+        auto B = g->addTensor({1, 3, 4}, DataType::Float32);
+        auto op = g->addOp<MatmulObj>(A, B, nullptr);
+        g->dataMalloc();
+        A->setData(IncrementalGenerator());
+        B->setData(IncrementalGenerator());
+
+        runtime->run(g);
+        EXPECT_TRUE(op->getOutput()->equalData(
+            vector<float>{20, 23, 26, 29, 56, 68, 80, 92}));
+    }
+
+    TEST(Matmul, NativeCpuTransposeAndBroadcast)
+    {
+        for (bool transA : {false, true})
+            for (bool transB : {false, true})
+            {
+                Shape a = transA ? Shape{2, 1, 37, 45} : Shape{2, 1, 45, 37};
+                Shape b = transB ? Shape{3, 29, 37} : Shape{3, 37, 29};
+                testMatmulNativeCpu(a, b, transA, transB);
+            }
+        // Spans several register tiles and K blocks.
+        testMatmulNativeCpu({157, 300}, {300, 1100}, false, false);
+        testMatmulNativeCpu({300, 157}, {70, 300}, true, true);
+    }
+
+    static void testEpilogueNativeCpu(const Shape &shapeA, const Shape &shapeB,
+                                      MatmulActivation act)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        auto A = g->addTensor(shapeA, DataType::Float32);
+        auto B = g->addTensor(shapeB, DataType::Float32);
+        auto bias = g->addTensor({1, shapeB.back()}, DataType::Float32);
+        auto op = g->addOp<MatmulObj>(A, B, nullptr, false, false, bias, act,
+                                      -20.0f, 30.0f);
+        g->dataMalloc();
+        A->setData(patternGenerator);
+        B->setData(patternGenerator);
+        bias->setData([](void *data, size_t size, DataType)
+                      {
+                          auto ptr = reinterpret_cast<float *>(data);
+                          for (size_t i = 0; i < size; ++i)
+                              ptr[i] = float(int(i % 13) - 6); });
+
+        runtime->run(g);
+        auto C = op->getOutput();
+        auto ans = referenceMatmul(A, B, C->getDims(), false, false);
+        auto b = bias->getRawDataPtr<float *>();
+        for (size_t i = 0; i < ans.size(); ++i)
+        {
+            float v = ans[i] + b[i % shapeB.back()];
+            if (act == MatmulActivation::Relu)
+                v = std::max(0.f, v);
+            else if (act == MatmulActivation::Clip)
+                v = std::min(std::max(v, -20.f), 30.f);
+            ans[i] = v;
+        }
+        EXPECT_TRUE(C->equalData(ans));
+    }
+
+    TEST(Matmul, NativeCpuEpilogue)
+    {
+        for (auto act : {MatmulActivation::None, MatmulActivation::Relu,
+                         MatmulActivation::Clip})
+        {
+            // edge tiles and two K blocks; then only full register tiles
+            testEpilogueNativeCpu({2, 37, 300}, {300, 50}, act);
+            testEpilogueNativeCpu({48, 64}, {64, 96}, act);
+        }
+    }
+
+} // namespace infini
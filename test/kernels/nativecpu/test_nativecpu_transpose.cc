@@ -24,4 +24,51 @@ TEST(Transpose, NativeCpu) {
                                                           8, 9, 10, 11, 20, 21, 22, 23}));
 }
 
+// Output dim j is input dim permute[j]; checked element by element.
+static void testTransposeNativeCpu(const Shape &shape, const Shape &permute,
+                                   DataType dtype = DataType::Float32) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    Graph g = make_ref<GraphObj>(runtime);
+    auto input = g->addTensor(shape, dtype);
+    auto op = g->addOp<TransposeObj>(input, nullptr, permute);
+    g->dataMalloc();
+    input->setData(IncrementalGenerator());
+    runtime->run(g);
+
+    auto output = op->getOutput();
+    int rank = shape.size();
+    auto outShape = output->getDims();
+    for (int j = 0; j < rank; ++j)
+        ASSERT_EQ(outShape[j], shape[permute[j]]);
+    vector<size_t> inStride(rank, 1);
+    for (int d = rank - 2; d >= 0; --d)
+        inStride[d] = inStride[d + 1] * shape[d + 1];
+    vector<float> ans(output->size());
+    for (size_t i = 0; i < ans.size(); ++i) {
+        size_t rest = i, src = 0;
+        for (int j = rank - 1; j >= 0; --j) {
+            src += rest % outShape[j] * inStride[permute[j]];
+            rest /= outShape[j];
+        }
+        ans[i] = float(src);
+    }
+    if (dtype == DataType::Float32)
+        EXPECT_TRUE(output->equalData(ans));
+    else
+        EXPECT_TRUE(output->equalData(vector<uint32_t>(ans.begin(), ans.end())));
+}
+
+TEST(Transpose, NativeCpuPermutations) {
+    testTransposeNativeCpu({2, 3, 4, 5}, {0, 2, 3, 1});
+    testTransposeNativeCpu({2, 3, 4, 5}, {3, 0, 2, 1});
+    testTransposeNativeCpu({4, 5, 6}, {2, 0, 1});
+    testTransposeNativeCpu({4, 5, 6}, {1, 0, 2});    // innermost dim stays
+    testTransposeNativeCpu({3, 1, 4, 1}, {3, 2, 1, 0}); // size-1 dims
+    testTransposeNativeCpu({2, 3, 4}, {0, 1, 2});    // identity
+    // last-two-dims swap of attention scores, with partial tiles
+    testTransposeNativeCpu({2, 3, 67, 41}, {0, 1, 3, 2});
+    testTransposeNativeCpu({2, 3, 67, 41}, {0, 1, 3, 2}, DataType::UInt32);
+    testTransposeNativeCpu({130, 70}, {1, 0});
+}
+
 } // namespace infini